@@ -57,6 +57,14 @@ class AddProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "AddProcessor"; };
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher& hasher) override
+    {
+        hasher.add(myGainLevels);
+        return true;
+    }
+
     void setGainLevels(const std::vector<float> gainLevels)
     {
         myGainLevels = gainLevels;
@@ -29,17 +29,26 @@ class CompressorProcessor : public ProcessorBase
         // auto posInfo = getPlayHead()->getPosition();
 
         juce::dsp::AudioBlock<float> block(buffer);
-        juce::dsp::ProcessContextReplacing<float> context(block);
-        myCompressor.process(context);
+        processWithAutomation(
+            buffer.getNumSamples(),
+            [&](int start, int numSamples)
+            {
+                auto subBlock = block.getSubBlock((size_t)start, (size_t)numSamples);
+                juce::dsp::ProcessContextReplacing<float> context(subBlock);
+                myCompressor.process(context);
+            });
         ProcessorBase::processBlock(buffer, midiBuffer);
     }
 
+    bool canAutomateWithinBlock() override { return true; }
+
     void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) override
     {
         myCompressor.setThreshold(getAutomationVal("threshold", posInfo));
         myCompressor.setRatio(getAutomationVal("ratio", posInfo));
         myCompressor.setAttack(getAutomationVal("attack", posInfo));
-        myCompressor.setRelease(getAutomationVal("release", posInfo));
+        myReleaseMs = getAutomationVal("release", posInfo);
+        myCompressor.setRelease(myReleaseMs);
     }
 
     void reset() override
@@ -50,6 +59,13 @@ class CompressorProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "CompressorProcessor"; };
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher&) override { return true; }
+    // The envelope falls by about 54 dB per release time, so after three it's
+    // below the level that silence skipping treats as silent.
+    double getTailLengthSeconds() const override { return 3. * myReleaseMs * .001; }
+
     void setThreshold(float threshold) { setAutomationVal("threshold", threshold); }
     float getThreshold() const { return getAutomationAtZero("threshold"); }
 
@@ -85,6 +101,7 @@ class CompressorProcessor : public ProcessorBase
 
   private:
     juce::dsp::Compressor<float> myCompressor;
+    float myReleaseMs = 0.f;
 
   public:
     void createParameterLayout()
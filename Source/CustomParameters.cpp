@@ -18,9 +18,10 @@ bool AutomateParameter::setAutomation(nb::ndarray<float> input, std::uint32_t ne
     {
         auto numSamples = input.shape(0);
 
-        myAutomation = std::vector<float>(numSamples, 0.f);
+        std::vector<float> values(numSamples, 0.f);
 
-        memcpy(myAutomation.data(), input.data(), numSamples * sizeof(float));
+        memcpy(values.data(), input.data(), numSamples * sizeof(float));
+        myAutomation = std::make_shared<const std::vector<float>>(std::move(values));
         m_hasAutomation = numSamples > 1;
     }
     catch (const std::exception& e)
@@ -32,22 +33,41 @@ bool AutomateParameter::setAutomation(nb::ndarray<float> input, std::uint32_t ne
     return true;
 }
 
+void AutomateParameter::setAutomation(const std::vector<float>& values, std::uint32_t newPPQN)
+{
+    if (values.empty())
+    {
+        throw std::runtime_error("Error: setAutomation: the automation must not be empty.");
+    }
+
+    m_ppqn = newPPQN;
+    myAutomation = std::make_shared<const std::vector<float>>(values);
+    m_hasAutomation = values.size() > 1;
+}
+
 void AutomateParameter::setAutomation(const float val)
 {
-    myAutomation.clear();
-    myAutomation.push_back(val);
+    myAutomation = std::make_shared<const std::vector<float>>(1, val);
     m_hasAutomation = false;
 }
 
+void AutomateParameter::shareAutomation(const AutomateParameter& other)
+{
+    myAutomation = other.myAutomation;
+    m_ppqn = other.m_ppqn;
+    m_hasAutomation = other.m_hasAutomation;
+}
+
 std::vector<float> AutomateParameter::getAutomation()
 {
-    return myAutomation;
+    return *myAutomation;
 }
 
 float AutomateParameter::sample(AudioPlayHead::PositionInfo& posInfo)
 {
+    const auto& automation = *myAutomation;
     size_t i;
-    auto numSamples = myAutomation.size();
+    auto numSamples = automation.size();
     if (numSamples == 0)
     {
         throw std::runtime_error("Can't sample parameter with no samples.");
@@ -62,5 +82,76 @@ float AutomateParameter::sample(AudioPlayHead::PositionInfo& posInfo)
     }
 
     i = std::max((size_t)0, i);
-    return myAutomation.at(i);
+    return automation.at(i);
+}
+
+int AutomateParameter::getSamplesUntilChange(AudioPlayHead::PositionInfo& posInfo, int maxSamples,
+                                             const TempoMap& tempoMap, double sampleRate)
+{
+    const auto& automation = *myAutomation;
+    const size_t numValues = automation.size();
+    const int64_t start = *posInfo.getTimeInSamples();
+
+    if (m_ppqn > 0)
+    {
+        return getSamplesUntilValueChange(automation.data(), numValues, m_ppqn, tempoMap, start,
+                                          sampleRate, maxSamples);
+    }
+
+    // Past the end, sample() holds the last value.
+    if (start < 0 || start + 1 >= (int64_t)numValues)
+    {
+        return maxSamples;
+    }
+
+    const float value = automation[(size_t)start];
+    const int64_t end = std::min<int64_t>(start + maxSamples, (int64_t)numValues);
+    for (int64_t i = start + 1; i < end; i++)
+    {
+        if (isStep(automation.data(), numValues, (size_t)i, value))
+        {
+            return (int)(i - start);
+        }
+    }
+    return maxSamples;
+}
+
+int getSamplesUntilValueChange(const float* values, size_t numValues, std::uint32_t ppqn,
+                               const TempoMap& tempoMap, int64_t timeInSamples, double sampleRate,
+                               int maxSamples)
+{
+    auto indexAfter = [&](int numSamples)
+    {
+        const double sample = double(timeInSamples + numSamples);
+        return (size_t)std::max(0., tempoMap.getBeatAtSample(sample, sampleRate) * ppqn);
+    };
+
+    const size_t start = indexAfter(0);
+    if (start + 1 >= numValues)
+    {
+        return maxSamples;
+    }
+
+    const float value = values[start];
+    const size_t end = std::min(numValues, indexAfter(maxSamples) + 1);
+    for (size_t i = start + 1; i < end; i++)
+    {
+        if (isStep(values, numValues, i, value))
+        {
+            // The first sample at which the playhead reads index i, allowing
+            // for rounding in the conversion.
+            const double sample = tempoMap.getSampleAtBeat(double(i) / ppqn, sampleRate);
+            int numSamples = std::clamp((int)std::floor(sample - timeInSamples), 1, maxSamples);
+            while (numSamples < maxSamples && indexAfter(numSamples) < i)
+            {
+                numSamples++;
+            }
+            while (numSamples > 1 && indexAfter(numSamples - 1) >= i)
+            {
+                numSamples--;
+            }
+            return numSamples;
+        }
+    }
+    return maxSamples;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "TempoMap.h"
 #include "custom_nanobind_wrappers.h"
 
 using juce::AbstractFifo;
@@ -111,6 +112,23 @@ using juce::VST3PluginFormat;
 using juce::VSTPluginFormat;
 using juce::WildcardFileFilter;
 
+// The number of samples, at most `maxSamples`, until a playhead at
+// `timeInSamples` that follows `tempoMap` reaches an index of `values` (with
+// `ppqn` values per quarter note) where the values step to a new value and
+// hold it (see isStep).
+int getSamplesUntilValueChange(const float* values, size_t numValues, std::uint32_t ppqn,
+                               const TempoMap& tempoMap, int64_t timeInSamples, double sampleRate,
+                               int maxSamples);
+
+// Whether values[i] differs from `value` and is held for at least one more
+// index. Ramps and LFOs change at every index, so they only step where they
+// level off; splitting blocks at each of their values would process them one
+// sample at a time.
+inline bool isStep(const float* values, size_t numValues, size_t i, float value)
+{
+    return values[i] != value && (i + 1 == numValues || values[i + 1] == values[i]);
+}
+
 class AutomateParameter
 {
   public:
@@ -118,19 +136,34 @@ class AutomateParameter
 
     bool setAutomation(nb::ndarray<float> input, std::uint32_t newPPQN);
 
+    void setAutomation(const std::vector<float>& values, std::uint32_t newPPQN);
+
     void setAutomation(const float val);
 
+    // Use the same automation as `other`. The values are shared, not copied,
+    // since automation is never modified in place.
+    void shareAutomation(const AutomateParameter& other);
+
     std::vector<float> getAutomation();
+    const std::vector<float>& getAutomationValues() const { return *myAutomation; }
+
+    std::uint32_t getPPQN() const { return m_ppqn; }
 
     float sample(AudioPlayHead::PositionInfo& posInfo);
 
+    // The number of samples, at most `maxSamples`, from `posInfo` until
+    // sample() steps to a different value (see isStep).
+    int getSamplesUntilChange(AudioPlayHead::PositionInfo& posInfo, int maxSamples,
+                              const TempoMap& tempoMap, double sampleRate);
+
     ~AutomateParameter() {}
 
     bool isAutomated() { return m_hasAutomation; }
 
   protected:
     bool m_hasAutomation = false;
-    std::vector<float> myAutomation;
+    std::shared_ptr<const std::vector<float>> myAutomation =
+        std::make_shared<const std::vector<float>>();
     std::uint32_t m_ppqn = 0;
 };
 
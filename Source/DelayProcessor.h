@@ -62,12 +62,26 @@ class DelayProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "DelayProcessor"; };
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher& hasher) override
+    {
+        hasher.add(myRule);
+        return true;
+    }
+    double getTailLengthSeconds() const override
+    {
+        return myDelay.getMaximumDelayInSamples() / mySampleRate;
+    }
+
     void setDelay(float newDelaySize) { setAutomationVal("delay", newDelaySize); }
     float getDelay() const { return getAutomationAtZero("delay"); }
 
     void setWet(float newWet) { setAutomationVal("wet_level", newWet); }
     float getWet() const { return getAutomationAtZero("wet_level"); }
 
+    std::string getRule() const { return myRule; }
+
     nb::dict getPickleState()
     {
         nb::dict state;
@@ -2,9 +2,14 @@
 
 #ifdef BUILD_DAWDREAMER_FAUST
 
+#include <algorithm>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <list>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "faust/midi/RtMidi.cpp"
 
@@ -13,6 +18,222 @@
 // FaustProcessor instance is serialized with this process-wide mutex.
 static std::mutex faustCompileMutex;
 
+namespace
+{
+
+// The cache key holds the code and the -I paths but not the libraries the code
+// imports, so a cached factory also keeps the size and modification time of
+// every file it imported and is compiled again once any of them changes.
+std::string fingerprintLibraries(const std::vector<std::string>& paths)
+{
+    std::string fingerprint;
+    for (const auto& path : paths)
+    {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+        fingerprint += path + "\t" + std::to_string(file.getSize()) + "\t" +
+                       std::to_string(file.getLastModificationTime().toMilliseconds()) + "\n";
+    }
+    return fingerprint;
+}
+
+// Factories compiled from source are shared by every FaustProcessor with the
+// same code and compile options, so identical processors only pay for one
+// compile and just create their own DSP instance. A factory stays cached while
+// any processor uses it, and up to kMaxIdleFactories released factories are
+// kept around for reuse. Everything here is guarded by faustCompileMutex.
+template <typename Factory> class FaustFactoryCache
+{
+  public:
+    explicit FaustFactoryCache(std::function<void(Factory*)> destroy) : m_destroy{destroy} {}
+
+    // Return the factory for `key` and count one more user, or nullptr. A
+    // factory whose imported libraries changed is retired instead.
+    Factory* acquire(const std::string& key)
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            return nullptr;
+        }
+
+        if (fingerprintLibraries(it->second.libraries) != it->second.fingerprint)
+        {
+            retire(it);
+            return nullptr;
+        }
+
+        if (it->second.numUsers++ == 0)
+        {
+            m_idleKeys.remove(key);
+        }
+        return it->second.factory;
+    }
+
+    // Cache a new factory whose one user is the caller. `libraries` are the
+    // files its code imported.
+    void add(const std::string& key, Factory* factory, const std::vector<std::string>& libraries)
+    {
+        m_entries[key] = {factory, 1, libraries, fingerprintLibraries(libraries)};
+        m_keys[factory] = key;
+    }
+
+    // Return false if the factory didn't come from the cache, in which case the
+    // caller still owns it.
+    bool release(Factory* factory)
+    {
+        auto it = m_keys.find(factory);
+        if (it == m_keys.end())
+        {
+            return false;
+        }
+
+        if (--m_entries[it->second].numUsers == 0)
+        {
+            m_idleKeys.push_back(it->second);
+            evictIdle(kMaxIdleFactories);
+        }
+        return true;
+    }
+
+    void clearIdle() { evictIdle(0); }
+
+  private:
+    static constexpr size_t kMaxIdleFactories = 32;
+
+    struct Entry
+    {
+        Factory* factory = nullptr;
+        int numUsers = 0;
+        std::vector<std::string> libraries;
+        std::string fingerprint;
+    };
+
+    // Take a stale factory out of the cache. Processors still using it keep it
+    // under a key that's never looked up, until they release it.
+    void retire(typename std::unordered_map<std::string, Entry>::iterator it)
+    {
+        if (it->second.numUsers == 0)
+        {
+            m_idleKeys.remove(it->first);
+            m_keys.erase(it->second.factory);
+            m_destroy(it->second.factory);
+            m_entries.erase(it);
+            return;
+        }
+
+        auto retiredKey = "\n" + std::to_string(m_numRetired++) + "\n" + it->first;
+        auto entry = std::move(it->second);
+        m_entries.erase(it);
+        m_keys[entry.factory] = retiredKey;
+        m_entries[retiredKey] = std::move(entry);
+    }
+
+    void evictIdle(size_t maxIdle)
+    {
+        while (m_idleKeys.size() > maxIdle)
+        {
+            auto it = m_entries.find(m_idleKeys.front());
+            m_idleKeys.pop_front();
+            m_keys.erase(it->second.factory);
+            m_destroy(it->second.factory);
+            m_entries.erase(it);
+        }
+    }
+
+    std::function<void(Factory*)> m_destroy;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::unordered_map<Factory*, std::string> m_keys;
+    std::list<std::string> m_idleKeys; // least recently released first
+    uint64_t m_numRetired = 0;
+};
+
+FaustFactoryCache<llvm_dsp_factory>& getFactoryCache()
+{
+    static FaustFactoryCache<llvm_dsp_factory> cache{[](llvm_dsp_factory* factory)
+                                                     { deleteDSPFactory(factory); }};
+    return cache;
+}
+
+FaustFactoryCache<llvm_dsp_poly_factory>& getPolyFactoryCache()
+{
+    static FaustFactoryCache<llvm_dsp_poly_factory> cache{[](llvm_dsp_poly_factory* factory)
+                                                          { delete factory; }};
+    return cache;
+}
+
+// Where non-polyphonic factories are saved as LLVM bitcode, or empty to only
+// cache in memory.
+std::string factoryCacheDirectory;
+
+juce::File getFactoryCacheFile(const std::string& key)
+{
+    juce::SHA256 sha(key.data(), key.size());
+    return juce::File(factoryCacheDirectory).getChildFile(sha.toHexString() + ".bc");
+}
+
+// Cache files hold this line, the fingerprint of the imported libraries, an
+// empty line and then the bitcode.
+const std::string kFactoryCacheFileHeader = "DawDreamer Faust factory 1\n";
+
+void writeFactoryCacheFile(const juce::File& cacheFile, const std::string& bitcode,
+                           const std::vector<std::string>& libraries)
+{
+    auto contents = kFactoryCacheFileHeader + fingerprintLibraries(libraries) + "\n" + bitcode;
+
+    cacheFile.getParentDirectory().createDirectory();
+    // Write to a temporary file first so that other processes sharing the
+    // directory never read a partial file.
+    juce::TemporaryFile tempFile(cacheFile);
+    if (tempFile.getFile().replaceWithData(contents.data(), contents.size()))
+    {
+        tempFile.overwriteTargetFileWithTemporary();
+    }
+}
+
+// Return the bitcode in `cacheFile` and the libraries it imported, or an empty
+// string if the file is missing, from another format, or one of the libraries
+// changed since it was written.
+std::string readFactoryCacheFile(const juce::File& cacheFile, std::vector<std::string>& libraries)
+{
+    juce::MemoryBlock data;
+    if (!cacheFile.loadFileAsData(data))
+    {
+        return {};
+    }
+    std::string contents((const char*)data.getData(), data.getSize());
+    if (contents.compare(0, kFactoryCacheFileHeader.size(), kFactoryCacheFileHeader) != 0)
+    {
+        return {};
+    }
+
+    auto fingerprintStart = kFactoryCacheFileHeader.size();
+    auto lineStart = fingerprintStart;
+    while (true)
+    {
+        auto lineEnd = contents.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            return {};
+        }
+        if (lineEnd == lineStart)
+        {
+            break;
+        }
+        auto pathEnd = contents.find('\t', lineStart);
+        libraries.push_back(contents.substr(lineStart, std::min(pathEnd, lineEnd) - lineStart));
+        lineStart = lineEnd + 1;
+    }
+
+    if (fingerprintLibraries(libraries) !=
+        contents.substr(fingerprintStart, lineStart - fingerprintStart))
+    {
+        return {};
+    }
+    return contents.substr(lineStart + 1);
+}
+
+} // namespace
+
 #ifdef WIN32
 __declspec(selectany) std::list<GUI*> GUI::fGuiList;
 __declspec(selectany) ztimedmap GUI::gTimedZoneMap;
@@ -143,8 +364,23 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
     {
         if (m_dsp != NULL)
         {
-            m_dsp->compute(buffer.getNumSamples(), (float**)buffer.getArrayOfReadPointers(),
-                           (float**)buffer.getArrayOfWritePointers());
+            const int numChannels = buffer.getNumChannels();
+            m_subBlockReadPtrs.resize((size_t)numChannels);
+            m_subBlockWritePtrs.resize((size_t)numChannels);
+
+            processWithAutomation(
+                buffer.getNumSamples(),
+                [&](int start, int numSamples)
+                {
+                    for (int chan = 0; chan < numChannels; chan++)
+                    {
+                        m_subBlockReadPtrs[(size_t)chan] =
+                            (float*)buffer.getReadPointer(chan, start);
+                        m_subBlockWritePtrs[(size_t)chan] = buffer.getWritePointer(chan, start);
+                    }
+                    m_dsp->compute(numSamples, m_subBlockReadPtrs.data(),
+                                   m_subBlockWritePtrs.data());
+                });
         }
         else
         {
@@ -155,19 +391,39 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
     {
         auto start = *posInfo->getTimeInSamples();
 
-        auto pulseStart = std::floor(*posInfo->getPpqPosition() * PPQN);
-        auto pulseStep = (*posInfo->getBpm() * PPQN) / (mySampleRate * 60.);
+        // The tempo map gives the exact sample of each event in beats.
+        auto eventSampleQN = getSampleAtPulse(myMidiMessagePositionQN);
 
-        // render one sample at a time because we want accurate timing of
-        // keyOn/keyOff.
+        // keyOn/keyOff have to happen at the exact sample of their MIDI event,
+        // so compute the block in runs that end wherever an event is due.
+
+        const int numSamples = buffer.getNumSamples();
+
+        // compute() may write its outputs before reading all of its inputs, so
+        // it reads from a copy.
+        m_polyInputBuffer.setSize(m_numInputChannels, numSamples, false, false, true);
+        for (int chan = 0; chan < m_numInputChannels; chan++)
+        {
+            m_polyInputBuffer.copyFrom(chan, 0, buffer, chan, 0, numSamples);
+        }
 
-        auto oneSampReadPtrs = (float**)oneSampleInBuffer.getArrayOfReadPointers();
-        auto oneSampWritePtrs = (float**)oneSampleOutBuffer.getArrayOfWritePointers();
         const int midiChannel = 0;
-        int chan = 0;
+        int runStart = 0;
 
-        for (int i = 0; i < buffer.getNumSamples(); i++)
+        for (int i = 0; i < numSamples; i++, start++)
         {
+            const bool isEventDueSec = myMidiEventsDoRemainSec &&
+                                       myMidiMessagePositionSec >= start &&
+                                       myMidiMessagePositionSec < start + 1;
+            const bool isEventDueQN = myMidiEventsDoRemainQN && eventSampleQN <= start;
+            if (!isEventDueSec && !isEventDueQN)
+            {
+                continue;
+            }
+
+            computePolyphonic(buffer, runStart, i - runStart);
+            runStart = i;
+
             {
                 myIsMessageBetweenSec =
                     myMidiMessagePositionSec >= start && myMidiMessagePositionSec < start + 1;
@@ -193,6 +449,12 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
                         m_dsp_poly->keyOff(midiChannel, myMidiMessageSec.getNoteNumber(),
                                            myMidiMessageSec.getVelocity());
                     }
+                    else if (myMidiMessageSec.isAllNotesOff() || myMidiMessageSec.isAllSoundOff())
+                    {
+                        // Releases every voice.
+                        m_dsp_poly->ctrlChange(midiChannel,
+                                               myMidiMessageSec.getControllerNumber(), 0);
+                    }
 
                     myMidiEventsDoRemainSec =
                         myMidiIteratorSec.getNextEvent(myMidiMessageSec, myMidiMessagePositionSec);
@@ -202,8 +464,7 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
             }
 
             {
-                myIsMessageBetweenQN = myMidiMessagePositionQN >= pulseStart &&
-                                       myMidiMessagePositionQN < pulseStart + 1;
+                myIsMessageBetweenQN = eventSampleQN <= start;
                 while (myIsMessageBetweenQN && myMidiEventsDoRemainQN)
                 {
                     // steps for saving midi to file output
@@ -226,30 +487,23 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
                         m_dsp_poly->keyOff(midiChannel, myMidiMessageQN.getNoteNumber(),
                                            myMidiMessageQN.getVelocity());
                     }
+                    else if (myMidiMessageQN.isAllNotesOff() || myMidiMessageQN.isAllSoundOff())
+                    {
+                        // Releases every voice.
+                        m_dsp_poly->ctrlChange(midiChannel,
+                                               myMidiMessageQN.getControllerNumber(), 0);
+                    }
 
                     myMidiEventsDoRemainQN =
                         myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
 
-                    myIsMessageBetweenQN = myMidiMessagePositionQN >= pulseStart &&
-                                           myMidiMessagePositionQN < pulseStart + 1;
+                    eventSampleQN = getSampleAtPulse(myMidiMessagePositionQN);
+                    myIsMessageBetweenQN = eventSampleQN <= start;
                 }
             }
-
-            for (chan = 0; chan < m_numInputChannels; chan++)
-            {
-                oneSampleInBuffer.setSample(chan, 0, buffer.getSample(chan, i));
-            }
-
-            m_dsp_poly->compute(1, oneSampReadPtrs, oneSampWritePtrs);
-
-            for (chan = 0; chan < m_numOutputChannels; chan++)
-            {
-                buffer.setSample(chan, i, oneSampleOutBuffer.getSample(chan, 0));
-            }
-
-            start += 1;
-            pulseStart += pulseStep;
         }
+
+        computePolyphonic(buffer, runStart, numSamples - runStart);
     }
     else
     {
@@ -259,6 +513,29 @@ void FaustProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuf
     ProcessorBase::processBlock(buffer, midiBuffer);
 }
 
+void FaustProcessor::computePolyphonic(juce::AudioSampleBuffer& buffer, int startSample,
+                                       int numSamples)
+{
+    if (numSamples <= 0)
+    {
+        return;
+    }
+
+    m_subBlockReadPtrs.resize((size_t)m_numInputChannels);
+    m_subBlockWritePtrs.resize((size_t)m_numOutputChannels);
+
+    for (int chan = 0; chan < m_numInputChannels; chan++)
+    {
+        m_subBlockReadPtrs[(size_t)chan] = m_polyInputBuffer.getWritePointer(chan, startSample);
+    }
+    for (int chan = 0; chan < m_numOutputChannels; chan++)
+    {
+        m_subBlockWritePtrs[(size_t)chan] = buffer.getWritePointer(chan, startSample);
+    }
+
+    m_dsp_poly->compute(numSamples, m_subBlockReadPtrs.data(), m_subBlockWritePtrs.data());
+}
+
 bool hasEnding(std::string const& fullString, std::string const& ending)
 {
     if (fullString.length() >= ending.length())
@@ -286,15 +563,13 @@ void FaustProcessor::automateParameters(AudioPlayHead::PositionInfo& posInfo, in
 
     bool anyAutomation = false;
     int i = 0;
-    for (auto* parameter : getParameters())
+    for (auto* theParameter : getAutomationParameters())
     {
-        int faustIndex = m_map_juceIndex_to_faustIndex[i];
-        auto theParameter = (AutomateParameterFloat*)parameter;
-
         bool hasAutomation = theParameter->isAutomated();
         anyAutomation |= hasAutomation;
         if (hasAutomation)
         {
+            int faustIndex = m_map_juceIndex_to_faustIndex[i];
             m_ui->setParamValue(faustIndex, theParameter->sample(posInfo));
         }
         i++;
@@ -313,6 +588,40 @@ void FaustProcessor::automateParameters(AudioPlayHead::PositionInfo& posInfo, in
     }
 }
 
+bool FaustProcessor::hashConfiguration(ConfigurationHasher& hasher)
+{
+    if (m_compileState != kMono && m_compileState != kPoly)
+    {
+        return false;
+    }
+
+    hasher.add(m_autoImport);
+    hasher.add(m_code);
+    for (const auto* paths : {&m_faustLibrariesPaths, &m_faustAssetsPaths, &m_compileFlags})
+    {
+        hasher.add(paths->size());
+        for (const auto& path : *paths)
+        {
+            hasher.add(path);
+        }
+    }
+    hasher.add(m_nvoices);
+    hasher.add(m_dynamicVoices);
+    hasher.add(m_groupVoices);
+    hasher.add(m_releaseLengthSec);
+
+    for (const auto& [name, buffers] : m_SoundfileMap)
+    {
+        hasher.add(name);
+        for (const auto& buffer : buffers)
+        {
+            hasher.add(buffer);
+        }
+    }
+
+    return true;
+}
+
 void FaustProcessor::reset()
 {
     if (m_dsp)
@@ -355,11 +664,11 @@ void FaustProcessor::reset()
         }
     }
 
-    myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN);
+    myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN, getRenderStartPulse());
     myMidiEventsDoRemainQN =
         myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
 
-    myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec);
+    myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec, getRenderStartSample());
     myMidiEventsDoRemainSec =
         myMidiIteratorSec.getNextEvent(myMidiMessageSec, myMidiMessagePositionSec);
 
@@ -401,8 +710,16 @@ void FaustProcessor::clear()
         SAFE_DELETE(m_dsp);
     }
 
-    SAFE_DELETE(m_poly_factory);
-    deleteDSPFactory(m_factory);
+    if (m_poly_factory && !getPolyFactoryCache().release(m_poly_factory))
+    {
+        delete m_poly_factory;
+    }
+    m_poly_factory = nullptr;
+
+    if (m_factory && !getFactoryCache().release(m_factory))
+    {
+        deleteDSPFactory(m_factory);
+    }
     m_factory = nullptr;
 
     m_compileState = kNotCompiled;
@@ -512,8 +829,52 @@ bool FaustProcessor::compile()
 
     auto target = getTarget();
 
-    // create new factory
     bool is_polyphonic = m_nvoices > 0;
+
+    // Everything that affects the compiled factory. The number of voices and
+    // how they're grouped only matter when creating the DSP instance. The
+    // libfaust version keeps bitcode cached by another build from being read.
+    std::string cacheKey = std::string(getCLibFaustVersion()) + "\n" + target + "\n" +
+                           std::to_string(m_llvmOptLevel) + "\n" +
+                           (is_polyphonic ? "poly" : "mono") + "\n";
+    for (int i = 0; i < args.argc(); i++)
+    {
+        cacheKey += std::string(args.argv()[i]) + "\n";
+    }
+    cacheKey += theCode;
+
+    // Reuse a factory compiled from the same code and options.
+    if (is_polyphonic)
+    {
+        m_poly_factory = getPolyFactoryCache().acquire(cacheKey);
+    }
+    else
+    {
+        m_factory = getFactoryCache().acquire(cacheKey);
+
+        if (!m_factory && !factoryCacheDirectory.empty())
+        {
+            std::vector<std::string> libraries;
+            auto bitcode = readFactoryCacheFile(getFactoryCacheFile(cacheKey), libraries);
+            if (!bitcode.empty())
+            {
+                std::string error_msg;
+                // A corrupt file just means compiling from source.
+                m_factory = readDSPFactoryFromBitcode(bitcode, target, error_msg, m_llvmOptLevel);
+                if (m_factory)
+                {
+                    getFactoryCache().add(cacheKey, m_factory, libraries);
+                }
+            }
+        }
+    }
+
+    if (m_factory || m_poly_factory)
+    {
+        return initFromFactory();
+    }
+
+    // create new factory
     if (is_polyphonic)
     {
         m_poly_factory = createPolyDSPFactoryFromString(
@@ -550,9 +911,44 @@ bool FaustProcessor::compile()
                                  pathToFaustLibraries);
     }
 
+    if (is_polyphonic)
+    {
+        getPolyFactoryCache().add(cacheKey, m_poly_factory, m_poly_factory->getLibraryList());
+    }
+    else
+    {
+        auto libraries = m_factory->getLibraryList();
+        getFactoryCache().add(cacheKey, m_factory, libraries);
+
+        if (!factoryCacheDirectory.empty())
+        {
+            writeFactoryCacheFile(getFactoryCacheFile(cacheKey),
+                                  writeDSPFactoryToBitcode(m_factory), libraries);
+        }
+    }
+
     return initFromFactory();
 }
 
+void FaustProcessor::setFactoryCacheDirectory(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(faustCompileMutex);
+    factoryCacheDirectory = path;
+}
+
+std::string FaustProcessor::getFactoryCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(faustCompileMutex);
+    return factoryCacheDirectory;
+}
+
+void FaustProcessor::clearFactoryCache()
+{
+    std::lock_guard<std::mutex> lock(faustCompileMutex);
+    getFactoryCache().clearIdle();
+    getPolyFactoryCache().clearIdle();
+}
+
 bool FaustProcessor::compileFromBitcode(const std::string& bitcode)
 {
     std::lock_guard<std::mutex> lock(faustCompileMutex);
@@ -573,6 +969,38 @@ bool FaustProcessor::compileFromBitcode(const std::string& bitcode)
     return initFromFactory();
 }
 
+void FaustProcessor::copyCompiledFrom(FaustProcessor& other)
+{
+    m_code = other.m_code;
+    m_autoImport = other.m_autoImport;
+    m_faustLibrariesPaths = other.m_faustLibrariesPaths;
+    m_faustAssetsPaths = other.m_faustAssetsPaths;
+    m_compileFlags = other.m_compileFlags;
+    m_nvoices = other.m_nvoices;
+    m_groupVoices = other.m_groupVoices;
+    m_dynamicVoices = other.m_dynamicVoices;
+    m_llvmOptLevel = other.m_llvmOptLevel;
+    m_releaseLengthSec = other.m_releaseLengthSec;
+    m_SoundfileMap = other.m_SoundfileMap;
+    m_compileState = kNotCompiled;
+
+    switch (other.m_compileState)
+    {
+    case kNotCompiled:
+        break;
+    case kMono:
+    case kPoly:
+        compile();
+        break;
+    case kSignalMono:
+        compileFromBitcode(writeDSPFactoryToBitcode(other.m_factory));
+        break;
+    case kSignalPoly:
+        throw std::runtime_error("Polyphonic Faust processors compiled from signals or boxes "
+                                 "can't be copied.");
+    }
+}
+
 bool FaustProcessor::initFromFactory()
 {
     // Create DSP instance from the factory (either mono or poly).
@@ -634,9 +1062,6 @@ bool FaustProcessor::initFromFactory()
         {
             m_midi_handler = rt_midi("my_midi");
             m_midi_handler.addMidiIn(m_dsp_poly);
-
-            oneSampleInBuffer.setSize(m_numInputChannels, 1);
-            oneSampleOutBuffer.setSize(m_numOutputChannels, 1);
         }
 
         m_ui = new APIUI();
@@ -742,9 +1167,6 @@ bool FaustProcessor::compileSignals(std::vector<SigWrapper>& wrappers)
     {
         m_midi_handler = rt_midi("my_midi");
         m_midi_handler.addMidiIn(m_dsp_poly);
-
-        oneSampleInBuffer.setSize(m_numInputChannels, 1);
-        oneSampleOutBuffer.setSize(m_numOutputChannels, 1);
     }
 
     m_ui = new APIUI();
@@ -838,9 +1260,6 @@ bool FaustProcessor::compileSignals(std::vector<SigWrapper>& wrappers,
     {
         m_midi_handler = rt_midi("my_midi");
         m_midi_handler.addMidiIn(m_dsp_poly);
-
-        oneSampleInBuffer.setSize(m_numInputChannels, 1);
-        oneSampleOutBuffer.setSize(m_numOutputChannels, 1);
     }
 
     m_ui = new APIUI();
@@ -923,9 +1342,6 @@ bool FaustProcessor::compileBox(BoxWrapper& box)
     {
         m_midi_handler = rt_midi("my_midi");
         m_midi_handler.addMidiIn(m_dsp_poly);
-
-        oneSampleInBuffer.setSize(m_numInputChannels, 1);
-        oneSampleOutBuffer.setSize(m_numOutputChannels, 1);
     }
 
     m_ui = new APIUI();
@@ -1009,9 +1425,6 @@ bool FaustProcessor::compileBox(BoxWrapper& box, const std::vector<std::string>&
     {
         m_midi_handler = rt_midi("my_midi");
         m_midi_handler.addMidiIn(m_dsp_poly);
-
-        oneSampleInBuffer.setSize(m_numInputChannels, 1);
-        oneSampleOutBuffer.setSize(m_numOutputChannels, 1);
     }
 
     m_ui = new APIUI();
@@ -191,7 +191,21 @@ class FaustProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "FaustProcessor"; }
 
+    // Effects and polyphonic instruments. A non-polyphonic DSP without inputs
+    // is a generator.
+    bool isSilentWithoutInput() override
+    {
+        return m_nvoices > 0 || getTotalNumInputChannels() > 0;
+    }
+
+    // Only DSPs compiled from code can be hashed.
+    bool hashConfiguration(ConfigurationHasher& hasher) override;
+
     void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) override;
+    bool canAutomateWithinBlock() override
+    {
+        return m_compileState == kMono || m_compileState == kSignalMono;
+    }
     bool setAutomation(std::string& parameterName, nb::ndarray<float> input,
                        std::uint32_t ppqn) override;
 
@@ -200,6 +214,10 @@ class FaustProcessor : public ProcessorBase
     bool compile();
     bool compileFromBitcode(const std::string& bitcode);
     bool initFromFactory();
+    // Take the code and compile options of `other` and compile them if `other`
+    // is compiled. Processors compiled from source share `other`'s factory
+    // through the factory cache instead of compiling it again.
+    void copyCompiledFrom(FaustProcessor& other);
     bool setDSPString(const std::string& code);
     bool setDSPFile(const std::string& path);
     bool setParamWithIndex(const int index, float p);
@@ -208,6 +226,20 @@ class FaustProcessor : public ProcessorBase
     std::string code();
     bool isCompiled() { return bool(m_compileState); };
 
+    // compile() shares factories between processors with the same code and
+    // options. With a cache directory, non-polyphonic factories are also saved
+    // there as LLVM bitcode so that other processes can skip compiling.
+    static void setFactoryCacheDirectory(const std::string& path);
+    static std::string getFactoryCacheDirectory();
+    // Delete the cached factories that no processor is using.
+    static void clearFactoryCache();
+
+    // prepareToPlay compiles, which can change the number of channels.
+    bool needsPrepareToPlay() override
+    {
+        return !m_compileState || ProcessorBase::needsPrepareToPlay();
+    }
+
     nb::list getPluginParametersDescription();
 
     void setNumVoices(int numVoices);
@@ -229,7 +261,10 @@ class FaustProcessor : public ProcessorBase
     int getNumMidiEvents();
 
     bool addMidiNote(const uint8 midiNote, const uint8 midiVelocity, const double noteStart,
-                     const double noteLength, bool isBeats);
+                     const double noteLength, bool isBeats) override;
+
+    juce::MidiBuffer* getMidiBufferSec() override { return &myMidiBufferSec; }
+    juce::MidiBuffer* getMidiBufferQN() override { return &myMidiBufferQN; }
 
     void setSoundfiles(nb::dict);
 
@@ -558,8 +593,16 @@ class FaustProcessor : public ProcessorBase
     bool myMidiEventsDoRemainQN = false;
     bool myMidiEventsDoRemainSec = false;
 
-    juce::AudioSampleBuffer oneSampleInBuffer;
-    juce::AudioSampleBuffer oneSampleOutBuffer;
+    // Run the polyphonic DSP over samples [startSample, startSample + numSamples)
+    // of the block, reading from m_polyInputBuffer and writing to `buffer`.
+    void computePolyphonic(juce::AudioSampleBuffer& buffer, int startSample, int numSamples);
+
+    // A copy of the block's input for polyphonic compute().
+    juce::AudioSampleBuffer m_polyInputBuffer;
+
+    // Channel pointers offset to the start of a sub-block.
+    std::vector<float*> m_subBlockReadPtrs;
+    std::vector<float*> m_subBlockWritePtrs;
 
     std::map<int, int> m_map_juceIndex_to_faustIndex;
     std::map<int, std::string> m_map_juceIndex_to_parAddress;
@@ -33,8 +33,13 @@ void FilterProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 void FilterProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuffer& midiBuffer)
 {
     juce::dsp::AudioBlock<float> block(buffer);
-    juce::dsp::ProcessContextReplacing<float> context(block);
-    myFilter.process(context);
+    processWithAutomation(buffer.getNumSamples(),
+                          [&](int start, int numSamples)
+                          {
+                              auto subBlock = block.getSubBlock((size_t)start, (size_t)numSamples);
+                              juce::dsp::ProcessContextReplacing<float> context(subBlock);
+                              myFilter.process(context);
+                          });
     ProcessorBase::processBlock(buffer, midiBuffer);
 }
 
@@ -25,10 +25,20 @@ class FilterProcessor : public ProcessorBase
 
     void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) override;
 
+    bool canAutomateWithinBlock() override { return true; }
+
     void reset() override;
 
     const juce::String getName() const override { return "FilterProcessor"; }
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher& hasher) override
+    {
+        hasher.add(myMode);
+        return true;
+    }
+
     void setMode(std::string mode);
     std::string getMode();
 
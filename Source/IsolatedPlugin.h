@@ -0,0 +1,905 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hosting a plugin in a helper process (see
+// RenderEngine::makePluginProcessor's `isolated`). The helper runs
+// PluginProcessor::runIsolatedHost and loads the plugin as usual. In this
+// process, IsolatedPluginInstance stands in for the plugin, so PluginProcessor
+// drives it like any other AudioPluginInstance. Every call is a request sent
+// over a named pipe, answered by the helper with a reply that starts with
+// whether it succeeded. Processed audio and MIDI go through a shared file
+// instead (see SharedBlock). A crash in the plugin ends the helper, and the next
+// request throws instead of taking down this process.
+namespace IsolatedPlugin
+{
+
+enum class Request : int
+{
+    load = 1,
+    prepare,
+    release,
+    reset,
+    process,
+    getState,
+    setState,
+    loadPreset,
+    loadVST3Preset,
+    getParameterText,
+    getParameterValueForText,
+    isLayoutSupported,
+    setLayout,
+    // Ends the helper. Not answered.
+    quit,
+    // Sent by the host every kPingIntervalMs, and not answered. The helper
+    // exits when they stop, since the pipe doesn't reliably report that this
+    // process is gone.
+    ping
+};
+
+constexpr int kPingIntervalMs = 500;
+constexpr int kPingTimeoutMs = 10000;
+
+// How long the host waits for a reply before it stops a helper that hangs.
+// Loading may scan the plugin and read large sample libraries.
+constexpr int kReplyTimeoutMs = 60000;
+constexpr int kLoadTimeoutMs = 600000;
+
+inline void writeChannelSet(juce::MemoryOutputStream& out, const juce::AudioChannelSet& set)
+{
+    auto types = set.getChannelTypes();
+    out.writeInt(types.size());
+    for (auto type : types)
+    {
+        out.writeInt((int)type);
+    }
+}
+
+inline juce::AudioChannelSet readChannelSet(juce::MemoryInputStream& in)
+{
+    juce::Array<juce::AudioChannelSet::ChannelType> types;
+    for (int i = in.readInt(); i > 0; i--)
+    {
+        types.add((juce::AudioChannelSet::ChannelType)in.readInt());
+    }
+    return juce::AudioChannelSet::channelSetWithChannels(types);
+}
+
+inline void writeLayout(juce::MemoryOutputStream& out,
+                        const juce::AudioProcessor::BusesLayout& layout)
+{
+    for (auto* buses : {&layout.inputBuses, &layout.outputBuses})
+    {
+        out.writeInt(buses->size());
+        for (auto& set : *buses)
+        {
+            writeChannelSet(out, set);
+        }
+    }
+}
+
+inline juce::AudioProcessor::BusesLayout readLayout(juce::MemoryInputStream& in)
+{
+    juce::AudioProcessor::BusesLayout layout;
+    for (auto* buses : {&layout.inputBuses, &layout.outputBuses})
+    {
+        for (int i = in.readInt(); i > 0; i--)
+        {
+            buses->add(readChannelSet(in));
+        }
+    }
+    return layout;
+}
+
+inline void writePosition(juce::MemoryOutputStream& out,
+                          const juce::AudioPlayHead::PositionInfo& position)
+{
+    out.writeBool(position.getIsPlaying());
+    out.writeBool(position.getIsRecording());
+    out.writeInt64(position.getTimeInSamples().orFallback(0));
+    out.writeDouble(position.getTimeInSeconds().orFallback(0.));
+    out.writeDouble(position.getPpqPosition().orFallback(0.));
+    out.writeDouble(position.getPpqPositionOfLastBarStart().orFallback(0.));
+    out.writeDouble(position.getBpm().orFallback(120.));
+    auto signature = position.getTimeSignature().orFallback(juce::AudioPlayHead::TimeSignature{});
+    out.writeInt(signature.numerator);
+    out.writeInt(signature.denominator);
+}
+
+inline juce::AudioPlayHead::PositionInfo readPosition(juce::MemoryInputStream& in)
+{
+    juce::AudioPlayHead::PositionInfo position;
+    position.setIsPlaying(in.readBool());
+    position.setIsRecording(in.readBool());
+    position.setTimeInSamples(in.readInt64());
+    position.setTimeInSeconds(in.readDouble());
+    position.setPpqPosition(in.readDouble());
+    position.setPpqPositionOfLastBarStart(in.readDouble());
+    position.setBpm(in.readDouble());
+    juce::AudioPlayHead::TimeSignature signature;
+    signature.numerator = in.readInt();
+    signature.denominator = in.readInt();
+    position.setTimeSignature(signature);
+    return position;
+}
+
+inline void writeMidi(juce::MemoryOutputStream& out, const juce::MidiBuffer& midi)
+{
+    out.writeInt(midi.getNumEvents());
+    for (const auto metadata : midi)
+    {
+        out.writeInt(metadata.samplePosition);
+        out.writeInt(metadata.numBytes);
+        out.write(metadata.data, (size_t)metadata.numBytes);
+    }
+}
+
+inline void readMidi(juce::MemoryInputStream& in, juce::MidiBuffer& midi)
+{
+    midi.clear();
+    juce::HeapBlock<juce::uint8> data;
+    for (int i = in.readInt(); i > 0; i--)
+    {
+        const int samplePosition = in.readInt();
+        const int numBytes = in.readInt();
+        data.realloc((size_t)numBytes);
+        in.read(data, numBytes);
+        midi.addEvent(data, numBytes, samplePosition);
+    }
+}
+
+// Audio and MIDI of processed blocks go through a memory-mapped file that the
+// host shares with the helper, so the pipe only carries the process request
+// itself: the block's size, position and parameter changes. Every block waits
+// for its output, so one block is in flight at a time and the file holds just
+// that one: its audio, channel after channel, then the size and bytes of its
+// MidiBuffer. Both processes run the same build, so MidiBuffer's raw data is
+// copied as is. The helper processes the audio in place, and sends its output
+// MIDI through the pipe instead only if it doesn't fit.
+class SharedBlock
+{
+  public:
+    // The host's side. Make sure the file fits `numBytes`, replacing it with a
+    // larger one if it doesn't. Returns true if the helper must open it again.
+    bool reserve(size_t numBytes)
+    {
+        if (m_map && m_map->getSize() >= numBytes)
+        {
+            return false;
+        }
+
+        // Leave room for larger blocks and for the helper's MIDI output.
+        numBytes = std::max(numBytes * 2, kMinSize);
+        m_map.reset();
+        m_file = std::make_unique<juce::TemporaryFile>(".ddblock");
+        {
+            juce::FileOutputStream out(m_file->getFile());
+            if (out.failedToOpen() || !out.setPosition((juce::int64)numBytes - 1) ||
+                !out.writeByte(0))
+            {
+                throw std::runtime_error("Unable to create the audio file shared with an "
+                                         "isolated plugin.");
+            }
+        }
+        open(m_file->getFile());
+        return true;
+    }
+
+    juce::File getFile() const { return m_file->getFile(); }
+
+    // The helper's side: open the file the host made.
+    void open(const juce::File& file)
+    {
+        m_map = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite);
+        if (!m_map->getData())
+        {
+            m_map.reset();
+            throw std::runtime_error("Unable to map the audio file shared with an isolated "
+                                     "plugin.");
+        }
+    }
+
+    static size_t getAudioSize(int numChannels, int numSamples)
+    {
+        return sizeof(float) * (size_t)numChannels * (size_t)numSamples;
+    }
+
+    float* getChannel(int chan, int numSamples)
+    {
+        return (float*)m_map->getData() + (size_t)chan * (size_t)numSamples;
+    }
+
+    void writeAudio(const juce::AudioBuffer<float>& buffer)
+    {
+        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        {
+            juce::FloatVectorOperations::copy(getChannel(chan, buffer.getNumSamples()),
+                                              buffer.getReadPointer(chan), buffer.getNumSamples());
+        }
+    }
+
+    void readAudio(juce::AudioBuffer<float>& buffer)
+    {
+        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        {
+            juce::FloatVectorOperations::copy(buffer.getWritePointer(chan),
+                                              getChannel(chan, buffer.getNumSamples()),
+                                              buffer.getNumSamples());
+        }
+    }
+
+    // Write `midi` after `audioSize` bytes of audio. Returns false, leaving a
+    // size of -1, if it doesn't fit.
+    bool writeMidi(size_t audioSize, const juce::MidiBuffer& midi)
+    {
+        auto* size = (juce::int32*)((char*)m_map->getData() + audioSize);
+        const auto numBytes = (size_t)midi.data.size();
+        if (audioSize + sizeof(juce::int32) + numBytes > m_map->getSize())
+        {
+            *size = -1;
+            return false;
+        }
+        *size = (juce::int32)numBytes;
+        std::memcpy(size + 1, midi.data.begin(), numBytes);
+        return true;
+    }
+
+    // Read what writeMidi wrote, or return false if it didn't fit.
+    bool readMidi(size_t audioSize, juce::MidiBuffer& midi)
+    {
+        const auto* size = (const juce::int32*)((const char*)m_map->getData() + audioSize);
+        if (*size < 0)
+        {
+            return false;
+        }
+        midi.data.clearQuick();
+        midi.data.addArray((const juce::uint8*)(size + 1), *size);
+        return true;
+    }
+
+  private:
+    static constexpr size_t kMinSize = 1 << 20;
+
+    std::unique_ptr<juce::TemporaryFile> m_file;
+    std::unique_ptr<juce::MemoryMappedFile> m_map;
+};
+
+// A pipe connection that queues the messages it receives until
+// waitForMessage takes them. Pings are counted instead of queued.
+class Connection : public juce::InterprocessConnection
+{
+  public:
+    Connection() : juce::InterprocessConnection(false) {}
+    ~Connection() override { disconnect(); }
+
+    // Wait up to `timeoutMs` (or forever if negative) for the next message.
+    // Returns false on a timeout or once the connection is lost and every
+    // message has been taken.
+    bool waitForMessage(juce::MemoryBlock& message, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto isReady = [this] { return !m_messages.empty() || m_lost; };
+        if (timeoutMs < 0)
+        {
+            m_received.wait(lock, isReady);
+        }
+        else
+        {
+            m_received.wait_for(lock, std::chrono::milliseconds(timeoutMs), isReady);
+        }
+        if (m_messages.empty())
+        {
+            return false;
+        }
+        message = std::move(m_messages.front());
+        m_messages.pop_front();
+        return true;
+    }
+
+    // Pings are sent from another thread, so sends mustn't interleave.
+    bool send(const juce::MemoryBlock& message)
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        return sendMessage(message);
+    }
+
+    bool isLost()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lost;
+    }
+
+    juce::uint32 getMillisecondsSincePing()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return juce::Time::getMillisecondCounter() - m_lastPing;
+    }
+
+  private:
+    void connectionMade() override {}
+
+    void connectionLost() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lost = true;
+        m_received.notify_all();
+    }
+
+    void messageReceived(const juce::MemoryBlock& message) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (message.getSize() == sizeof(int) &&
+            *(const int*)message.getData() == (int)Request::ping)
+        {
+            m_lastPing = juce::Time::getMillisecondCounter();
+            return;
+        }
+        m_messages.push_back(message);
+        m_received.notify_all();
+    }
+
+    std::mutex m_sendMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_received;
+    std::deque<juce::MemoryBlock> m_messages;
+    bool m_lost = false;
+    juce::uint32 m_lastPing = juce::Time::getMillisecondCounter();
+};
+
+// A running helper process and the pipe to it. A thread watches the process
+// and, once the plugin is loaded, pings it.
+class Helper
+{
+  public:
+    explicit Helper(const juce::StringArray& command)
+    {
+        const auto pipeName = "dawdreamer_" + juce::Uuid().toDashedString();
+        if (!m_connection.createPipe(pipeName, -1, true))
+        {
+            throw std::runtime_error("Unable to create a pipe for an isolated plugin.");
+        }
+
+        auto arguments = command;
+        arguments.add(pipeName);
+        if (!m_process.start(arguments, 0))
+        {
+            throw std::runtime_error("Unable to start the isolated plugin process.");
+        }
+
+        m_thread = std::thread([this] { watch(); });
+    }
+
+    ~Helper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+
+        const int quit = (int)Request::quit;
+        m_connection.send(juce::MemoryBlock(&quit, sizeof(quit)));
+        m_connection.disconnect(1000);
+        if (!m_process.waitForProcessToFinish(2000))
+        {
+            m_process.kill();
+        }
+    }
+
+    void startPinging() { m_isPinging = true; }
+
+    // Send a request and wait up to `timeoutMs` for its reply, which starts
+    // with whether the request succeeded, followed by an error message if it
+    // didn't. A helper that doesn't reply in time is stopped.
+    juce::MemoryBlock call(const juce::MemoryBlock& request, int timeoutMs = kReplyTimeoutMs)
+    {
+        std::lock_guard<std::mutex> lock(m_callMutex);
+        juce::MemoryBlock reply;
+        if (!m_connection.send(request))
+        {
+            throw std::runtime_error("The isolated plugin process stopped unexpectedly.");
+        }
+        if (!m_connection.waitForMessage(reply, timeoutMs))
+        {
+            if (m_connection.isLost())
+            {
+                throw std::runtime_error("The isolated plugin process stopped unexpectedly.");
+            }
+            // Later calls then fail right away instead of waiting again.
+            m_process.kill();
+            m_connection.disconnect(0);
+            throw std::runtime_error("The isolated plugin process didn't reply within " +
+                                     std::to_string(timeoutMs / 1000) +
+                                     " seconds and was stopped.");
+        }
+
+        juce::MemoryInputStream in(reply, false);
+        if (!in.readInt())
+        {
+            throw std::runtime_error(in.readString().toStdString());
+        }
+        return reply;
+    }
+
+  private:
+    void watch()
+    {
+        const int ping = (int)Request::ping;
+        juce::MemoryBlock message(&ping, sizeof(ping));
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_condition.wait_for(lock, std::chrono::milliseconds(kPingIntervalMs),
+                                         [this] { return m_isStopping; }))
+                {
+                    return;
+                }
+            }
+
+            if (!m_process.isRunning())
+            {
+                // This ends a call that's waiting for a reply, or for the
+                // helper to open the pipe.
+                m_connection.disconnect(0);
+                return;
+            }
+            if (m_isPinging)
+            {
+                m_connection.send(message);
+            }
+        }
+    }
+
+    Connection m_connection;
+    juce::ChildProcess m_process;
+    std::mutex m_callMutex;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isStopping = false;
+    std::atomic<bool> m_isPinging{false};
+};
+
+class Instance;
+
+// Mirrors one of the hosted plugin's parameters. Values are sent to the helper
+// with the next processed block instead of one request per change.
+class RemoteParameter : public juce::HostedAudioProcessorParameter
+{
+  public:
+    RemoteParameter(Instance& owner, int index, juce::MemoryInputStream& in)
+        : m_owner(owner), m_index(index)
+    {
+        m_name = in.readString();
+        m_label = in.readString();
+        m_id = in.readString();
+        m_defaultValue = in.readFloat();
+        m_numSteps = in.readInt();
+        m_isDiscrete = in.readBool();
+        m_isBoolean = in.readBool();
+        m_isAutomatable = in.readBool();
+        m_value = in.readFloat();
+    }
+
+    float getValue() const override { return m_value; }
+    void setValue(float newValue) override
+    {
+        if (newValue != m_value)
+        {
+            m_value = newValue;
+            m_isDirty = true;
+        }
+    }
+    // Take a value the helper reported, which it already has.
+    void setValueFromHost(float newValue)
+    {
+        m_value = newValue;
+        m_isDirty = false;
+    }
+    bool takeDirty() { return std::exchange(m_isDirty, false); }
+
+    float getDefaultValue() const override { return m_defaultValue; }
+    juce::String getName(int maximumStringLength) const override
+    {
+        return m_name.substring(0, maximumStringLength);
+    }
+    juce::String getLabel() const override { return m_label; }
+    juce::String getParameterID() const override { return m_id; }
+    int getNumSteps() const override { return m_numSteps; }
+    bool isDiscrete() const override { return m_isDiscrete; }
+    bool isBoolean() const override { return m_isBoolean; }
+    bool isAutomatable() const override { return m_isAutomatable; }
+
+    juce::String getText(float value, int maximumStringLength) const override;
+    float getValueForText(const juce::String& text) const override;
+
+  private:
+    Instance& m_owner;
+    const int m_index;
+    juce::String m_name, m_label, m_id;
+    float m_defaultValue = 0.f;
+    int m_numSteps = 0;
+    bool m_isDiscrete = false, m_isBoolean = false, m_isAutomatable = true;
+    float m_value = 0.f;
+    bool m_isDirty = false;
+};
+
+// The plugin as seen from this process. See the comment at the top.
+class Instance : public juce::AudioPluginInstance
+{
+  public:
+    // Start a helper with `command` followed by the pipe's name and load the
+    // plugin there.
+    static std::unique_ptr<Instance> create(const juce::StringArray& command,
+                                            const std::string& path, double sampleRate,
+                                            int samplesPerBlock)
+    {
+        auto helper = std::make_unique<Helper>(command);
+
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::load);
+        request.writeString(path);
+        request.writeDouble(sampleRate);
+        request.writeInt(samplesPerBlock);
+        auto reply = helper->call(request.getMemoryBlock(), kLoadTimeoutMs);
+
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        return std::unique_ptr<Instance>(new Instance(std::move(helper), in));
+    }
+
+    const juce::String getName() const override { return m_description.name; }
+    void fillInPluginDescription(juce::PluginDescription& description) const override
+    {
+        description = m_description;
+    }
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::prepare);
+        request.writeDouble(sampleRate);
+        request.writeInt(samplesPerBlock);
+        readInfo(call(request));
+    }
+
+    void releaseResources() override
+    {
+        // Called while destroying the processor, so a helper that's gone is
+        // not an error here.
+        try
+        {
+            call(Request::release);
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    void reset() override { call(Request::reset); }
+
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override
+    {
+        const auto audioSize =
+            SharedBlock::getAudioSize(buffer.getNumChannels(), buffer.getNumSamples());
+        const bool isNewFile =
+            m_shared.reserve(audioSize + sizeof(juce::int32) + (size_t)midi.data.size());
+        m_shared.writeAudio(buffer);
+        m_shared.writeMidi(audioSize, midi);
+
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::process);
+        // The path of a new shared file, or an empty string.
+        request.writeString(isNewFile ? m_shared.getFile().getFullPathName() : juce::String());
+        request.writeInt(buffer.getNumChannels());
+        request.writeInt(buffer.getNumSamples());
+        request.writeBool(isNonRealtime());
+
+        juce::AudioPlayHead::PositionInfo position;
+        if (auto* playHead = getPlayHead())
+        {
+            position = playHead->getPosition().orFallback(position);
+        }
+        writePosition(request, position);
+        writeParameters(request);
+
+        auto reply = call(request);
+        m_shared.readAudio(buffer);
+        if (!m_shared.readMidi(audioSize, midi))
+        {
+            juce::MemoryInputStream in(reply, false);
+            in.readInt();
+            readMidi(in, midi);
+        }
+    }
+    using juce::AudioPluginInstance::processBlock;
+
+    double getTailLengthSeconds() const override { return m_tailSeconds; }
+    bool acceptsMidi() const override { return m_acceptsMidi; }
+    bool producesMidi() const override { return m_producesMidi; }
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::getState);
+        writeParameters(request);
+        auto reply = call(request);
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        destData.setSize((size_t)in.readInt64());
+        in.read(destData.getData(), (int)destData.getSize());
+    }
+
+    void setStateInformation(const void* data, int sizeInBytes) override
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::setState);
+        request.writeInt64(sizeInBytes);
+        request.write(data, (size_t)sizeInBytes);
+        readInfo(call(request));
+    }
+
+    // Load a preset file in the helper, like PluginProcessor::loadPreset or
+    // loadVST3Preset.
+    bool loadPreset(const std::string& path, bool isVST3)
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)(isVST3 ? Request::loadVST3Preset : Request::loadPreset));
+        request.writeString(path);
+        auto reply = call(request);
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        const bool result = in.readBool();
+        readInfo(in);
+        return result;
+    }
+
+    juce::String getParameterText(int index, float value)
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::getParameterText);
+        request.writeInt(index);
+        request.writeFloat(value);
+        auto reply = call(request);
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        return in.readString();
+    }
+
+    float getParameterValueForText(int index, const juce::String& text)
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::getParameterValueForText);
+        request.writeInt(index);
+        request.writeString(text);
+        auto reply = call(request);
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        return in.readFloat();
+    }
+
+  protected:
+    bool isBusesLayoutSupported(const BusesLayout& layout) const override
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::isLayoutSupported);
+        writeLayout(request, layout);
+        auto reply = m_helper->call(request.getMemoryBlock());
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        return in.readBool();
+    }
+
+    bool applyBusLayouts(const BusesLayout& layout) override
+    {
+        juce::MemoryOutputStream request;
+        request.writeInt((int)Request::setLayout);
+        writeLayout(request, layout);
+        auto reply = call(request);
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        const bool result = in.readBool();
+        readInfo(in);
+        return result;
+    }
+
+  private:
+    Instance(std::unique_ptr<Helper> helper, juce::MemoryInputStream& in)
+        : juce::AudioPluginInstance(readBuses(in)), m_helper(std::move(helper))
+    {
+        if (auto xml = juce::parseXML(in.readString()))
+        {
+            m_description.loadFromXml(*xml);
+        }
+        m_acceptsMidi = in.readBool();
+        m_producesMidi = in.readBool();
+
+        const int numParameters = in.readInt();
+        for (int i = 0; i < numParameters; i++)
+        {
+            auto parameter = std::make_unique<RemoteParameter>(*this, i, in);
+            m_parameters.push_back(parameter.get());
+            addHostedParameter(std::move(parameter));
+        }
+        readInfo(in);
+
+        m_helper->startPinging();
+    }
+
+    // The layout of the helper's buses, for the constructor.
+    static BusesProperties readBuses(juce::MemoryInputStream& in)
+    {
+        BusesProperties buses;
+        for (bool isInput : {true, false})
+        {
+            for (int i = in.readInt(); i > 0; i--)
+            {
+                auto name = in.readString();
+                auto layout = readChannelSet(in);
+                const bool isEnabled = in.readBool();
+                buses.addBus(isInput, name, layout, isEnabled);
+            }
+        }
+        return buses;
+    }
+
+    // Take what a request may have changed: the bus layout, latency, tail and
+    // parameter values.
+    void readInfo(const juce::MemoryBlock& reply)
+    {
+        juce::MemoryInputStream in(reply, false);
+        in.readInt();
+        readInfo(in);
+    }
+
+    void readInfo(juce::MemoryInputStream& in)
+    {
+        auto layout = readLayout(in);
+        if (layout != getBusesLayout())
+        {
+            AudioProcessor::applyBusLayouts(layout);
+        }
+        setLatencySamples(in.readInt());
+        m_tailSeconds = in.readDouble();
+        for (auto* parameter : m_parameters)
+        {
+            parameter->setValueFromHost(in.readFloat());
+        }
+    }
+
+    void writeParameters(juce::MemoryOutputStream& out)
+    {
+        juce::MemoryOutputStream changes;
+        int numChanges = 0;
+        for (int i = 0; i < (int)m_parameters.size(); i++)
+        {
+            if (m_parameters[(size_t)i]->takeDirty())
+            {
+                changes.writeInt(i);
+                changes.writeFloat(m_parameters[(size_t)i]->getValue());
+                numChanges++;
+            }
+        }
+        out.writeInt(numChanges);
+        out << changes.getMemoryBlock();
+    }
+
+    juce::MemoryBlock call(Request request)
+    {
+        juce::MemoryOutputStream out;
+        out.writeInt((int)request);
+        return call(out);
+    }
+
+    juce::MemoryBlock call(const juce::MemoryOutputStream& request)
+    {
+        return m_helper->call(request.getMemoryBlock());
+    }
+
+    std::unique_ptr<Helper> m_helper;
+    SharedBlock m_shared;
+
+    juce::PluginDescription m_description;
+    bool m_acceptsMidi = false;
+    bool m_producesMidi = false;
+    double m_tailSeconds = 0.;
+    std::vector<RemoteParameter*> m_parameters;
+};
+
+inline juce::String RemoteParameter::getText(float value, int maximumStringLength) const
+{
+    return m_owner.getParameterText(m_index, value).substring(0, maximumStringLength);
+}
+
+inline float RemoteParameter::getValueForText(const juce::String& text) const
+{
+    return m_owner.getParameterValueForText(m_index, text);
+}
+
+// The helper's side of the protocol, for the plugin loaded in `plugin`.
+
+inline void writeBuses(juce::MemoryOutputStream& out, juce::AudioProcessor& plugin)
+{
+    for (bool isInput : {true, false})
+    {
+        out.writeInt(plugin.getBusCount(isInput));
+        for (int i = 0; i < plugin.getBusCount(isInput); i++)
+        {
+            auto* bus = plugin.getBus(isInput, i);
+            out.writeString(bus->getName());
+            writeChannelSet(out, bus->getLastEnabledLayout());
+            out.writeBool(bus->isEnabled());
+        }
+    }
+}
+
+inline void writeParameterInfo(juce::MemoryOutputStream& out, juce::AudioProcessor& plugin)
+{
+    out.writeInt(plugin.getParameters().size());
+    for (auto* parameter : plugin.getParameters())
+    {
+        auto* hosted = dynamic_cast<juce::HostedAudioProcessorParameter*>(parameter);
+        out.writeString(parameter->getName(DAW_PARAMETER_MAX_NAME_LENGTH));
+        out.writeString(parameter->getLabel());
+        out.writeString(hosted ? hosted->getParameterID()
+                               : juce::String(parameter->getParameterIndex()));
+        out.writeFloat(parameter->getDefaultValue());
+        out.writeInt(parameter->getNumSteps());
+        out.writeBool(parameter->isDiscrete());
+        out.writeBool(parameter->isBoolean());
+        out.writeBool(parameter->isAutomatable());
+        out.writeFloat(parameter->getValue());
+    }
+}
+
+// What Instance::readInfo reads.
+inline void writeInfo(juce::MemoryOutputStream& out, juce::AudioProcessor& plugin)
+{
+    writeLayout(out, plugin.getBusesLayout());
+    out.writeInt(plugin.getLatencySamples());
+    out.writeDouble(plugin.getTailLengthSeconds());
+    for (auto* parameter : plugin.getParameters())
+    {
+        out.writeFloat(parameter->getValue());
+    }
+}
+
+inline void readParameters(juce::MemoryInputStream& in, juce::AudioProcessor& plugin)
+{
+    auto& parameters = plugin.getParameters();
+    for (int i = in.readInt(); i > 0; i--)
+    {
+        const int index = in.readInt();
+        const float value = in.readFloat();
+        if (juce::isPositiveAndBelow(index, parameters.size()))
+        {
+            parameters[index]->setValue(value);
+        }
+    }
+}
+
+} // namespace IsolatedPlugin
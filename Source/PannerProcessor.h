@@ -52,6 +52,14 @@ class PannerProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "PannerProcessor"; };
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher& hasher) override
+    {
+        hasher.add(myRule);
+        return true;
+    }
+
     void setPan(float newPanVal) { setAutomationVal("pan", newPanVal); }
     float getPan() const { return getAutomationAtZero("pan"); }
 
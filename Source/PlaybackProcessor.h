@@ -12,15 +12,24 @@ class PlaybackProcessor : public ProcessorBase
     {
         m_numChannels = (int)inputData.size();
         auto numSamples = (int)inputData.at(0).size();
-        myPlaybackData.setSize(m_numChannels, numSamples);
+        auto data = std::make_shared<juce::AudioSampleBuffer>(m_numChannels, numSamples);
         for (int chan = 0; chan < m_numChannels; chan++)
         {
-            myPlaybackData.copyFrom(chan, 0, inputData.at(chan).data(), numSamples);
+            data->copyFrom(chan, 0, inputData.at(chan).data(), numSamples);
         }
+        myPlaybackData = data;
 
         setMainBusInputsAndOutputs(0, m_numChannels);
     }
 
+    // Play the same data as `other` without copying it.
+    PlaybackProcessor(std::string newUniqueName, const PlaybackProcessor& other)
+        : ProcessorBase{newUniqueName}, myPlaybackData(other.myPlaybackData),
+          m_numChannels(other.m_numChannels)
+    {
+        setMainBusInputsAndOutputs(0, m_numChannels);
+    }
+
     PlaybackProcessor(std::string newUniqueName, nb::ndarray<float> input)
         : ProcessorBase{newUniqueName}
     {
@@ -38,12 +47,12 @@ class PlaybackProcessor : public ProcessorBase
         // The playhead can be past the end of the data (including data with
         // zero samples), so clamp to zero to avoid a negative copy length.
         int numSamples =
-            std::max(0, std::min(buffer.getNumSamples(), myPlaybackData.getNumSamples() -
+            std::max(0, std::min(buffer.getNumSamples(), myPlaybackData->getNumSamples() -
                                                              (int)(*posInfo->getTimeInSamples())));
 
         for (int chan = 0; chan < m_numChannels; chan++)
         {
-            auto srcPtr = myPlaybackData.getReadPointer(chan);
+            auto srcPtr = myPlaybackData->getReadPointer(chan);
             srcPtr += (int)*posInfo->getTimeInSamples();
             buffer.copyFrom(chan, 0, srcPtr, numSamples);
         }
@@ -54,12 +63,18 @@ class PlaybackProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "PlaybackProcessor"; }
 
+    bool hashConfiguration(ConfigurationHasher& hasher) override
+    {
+        hasher.add(*myPlaybackData);
+        return true;
+    }
+
     nb::dict getPickleState()
     {
         nb::dict state;
         state["pickle_version"] = DawDreamerPickle::getVersion();
         state["unique_name"] = getUniqueName();
-        state["audio_data"] = bufferToPyArray(myPlaybackData);
+        state["audio_data"] = bufferToPyArray(*myPlaybackData);
         return state;
     }
 
@@ -92,7 +107,8 @@ class PlaybackProcessor : public ProcessorBase
         m_numChannels = (int)input.shape(0);
         auto numSamples = (int)input.shape(1);
 
-        myPlaybackData.setSize(m_numChannels, numSamples);
+        // Clones may share the current data, so fill a new buffer.
+        auto data = std::make_shared<juce::AudioSampleBuffer>(m_numChannels, numSamples);
 
         // Get strides - nanobind returns ELEMENT strides, not byte strides
         size_t elem_stride_ch = input.stride(0);     // stride for channel dimension (in elements)
@@ -106,7 +122,7 @@ class PlaybackProcessor : public ProcessorBase
             // Fast path for C-contiguous arrays
             for (int chan = 0; chan < m_numChannels; chan++)
             {
-                myPlaybackData.copyFrom(chan, 0, input_ptr, numSamples);
+                data->copyFrom(chan, 0, input_ptr, numSamples);
                 input_ptr += numSamples;
             }
         }
@@ -116,18 +132,20 @@ class PlaybackProcessor : public ProcessorBase
             for (int chan = 0; chan < m_numChannels; chan++)
             {
                 float* chan_ptr = input_ptr + (chan * elem_stride_ch);
-                float* dest = myPlaybackData.getWritePointer(chan);
+                float* dest = data->getWritePointer(chan);
                 for (int samp = 0; samp < numSamples; samp++)
                 {
                     dest[samp] = chan_ptr[samp * elem_stride_sample];
                 }
             }
         }
+        myPlaybackData = data;
 
         setMainBusInputsAndOutputs(0, m_numChannels);
     }
 
   private:
-    juce::AudioSampleBuffer myPlaybackData;
+    // Never modified after it's filled, so clones can share it.
+    std::shared_ptr<juce::AudioSampleBuffer> myPlaybackData;
     int m_numChannels = 0;
 };
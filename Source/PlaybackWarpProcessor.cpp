@@ -30,11 +30,12 @@ PlaybackWarpProcessor::PlaybackWarpProcessor(std::string newUniqueName,
     setMainBusInputsAndOutputs(0, m_numChannels);
     const int numSamples = (int)inputData.at(0).size();
 
-    myPlaybackData.setSize(m_numChannels, numSamples);
+    auto data = std::make_shared<juce::AudioSampleBuffer>(m_numChannels, numSamples);
     for (int chan = 0; chan < m_numChannels; chan++)
     {
-        myPlaybackData.copyFrom(chan, 0, inputData.at(chan).data(), numSamples);
+        data->copyFrom(chan, 0, inputData.at(chan).data(), numSamples);
     }
+    myPlaybackData = data;
 
     if (data_sr)
     {
@@ -63,6 +64,20 @@ PlaybackWarpProcessor::PlaybackWarpProcessor(std::string newUniqueName, nb::ndar
     resetWarpMarkers(120.);
 }
 
+PlaybackWarpProcessor::PlaybackWarpProcessor(std::string newUniqueName,
+                                             const PlaybackWarpProcessor& other)
+    : ProcessorBase{newUniqueName}, myPlaybackData(other.myPlaybackData),
+      myPlaybackDataSR(other.myPlaybackDataSR), m_numChannels(other.m_numChannels),
+      m_clipInfo(other.m_clipInfo), m_sample_rate(other.m_sample_rate),
+      m_time_ratio_if_warp_off(other.m_time_ratio_if_warp_off),
+      m_rubberbandConfig(other.m_rubberbandConfig)
+{
+    createParameterLayout();
+    setMainBusInputsAndOutputs(0, m_numChannels);
+    init();
+    m_clips = other.m_clips;
+}
+
 void PlaybackWarpProcessor::init()
 {
     setAutomationVal("transpose", 0.);
@@ -124,7 +139,7 @@ void PlaybackWarpProcessor::resetWarpMarkers(double bpm)
     m_clipInfo.warp_markers.push_back(std::make_pair(durSeconds, beats));
 
     m_clipInfo.end_marker = m_clipInfo.loop_end = m_clipInfo.hidden_loop_end =
-        (bpm / 60.) * (myPlaybackData.getNumSamples() / myPlaybackDataSR);
+        (bpm / 60.) * (myPlaybackData->getNumSamples() / myPlaybackDataSR);
 }
 
 void PlaybackWarpProcessor::setWarpMarkers(nb::ndarray<float> input)
@@ -377,12 +392,12 @@ void PlaybackWarpProcessor::processBlock(juce::AudioSampleBuffer& buffer,
         m_nonInterleavedBuffer.setSize(m_numChannels, 1);
 
         // Can we read from the playback data?
-        const int last_sample = myPlaybackData.getNumSamples() - 1;
+        const int last_sample = myPlaybackData->getNumSamples() - 1;
         if (sampleReadIndex > -1 && sampleReadIndex <= last_sample)
         {
             for (int chan = 0; chan < m_numChannels; chan++)
             {
-                m_nonInterleavedBuffer.copyFrom(chan, 0, myPlaybackData, chan, sampleReadIndex, 1);
+                m_nonInterleavedBuffer.copyFrom(chan, 0, *myPlaybackData, chan, sampleReadIndex, 1);
             }
         }
         else
@@ -434,7 +449,9 @@ void PlaybackWarpProcessor::setData(nb::ndarray<float> input, double data_sr)
     setMainBusInputsAndOutputs(0, m_numChannels);
     const int numSamples = (int)input.shape(1);
 
-    myPlaybackData.setSize(m_numChannels, numSamples);
+    // Clones may still play the old data, so replace it instead of
+    // overwriting it.
+    auto data = std::make_shared<juce::AudioSampleBuffer>(m_numChannels, numSamples);
 
     // Get strides - nanobind returns ELEMENT strides, not byte strides
     size_t elem_stride_ch = input.stride(0);     // stride for channel dimension (in elements)
@@ -448,7 +465,7 @@ void PlaybackWarpProcessor::setData(nb::ndarray<float> input, double data_sr)
         // Fast path for C-contiguous arrays
         for (int chan = 0; chan < m_numChannels; chan++)
         {
-            myPlaybackData.copyFrom(chan, 0, input_ptr, numSamples);
+            data->copyFrom(chan, 0, input_ptr, numSamples);
             input_ptr += numSamples;
         }
     }
@@ -458,13 +475,14 @@ void PlaybackWarpProcessor::setData(nb::ndarray<float> input, double data_sr)
         for (int chan = 0; chan < m_numChannels; chan++)
         {
             float* chan_ptr = input_ptr + (chan * elem_stride_ch);
-            float* dest = myPlaybackData.getWritePointer(chan);
+            float* dest = data->getWritePointer(chan);
             for (int samp = 0; samp < numSamples; samp++)
             {
                 dest[samp] = chan_ptr[samp * elem_stride_sample];
             }
         }
     }
+    myPlaybackData = data;
 
     if (data_sr)
     {
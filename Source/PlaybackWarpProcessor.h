@@ -17,6 +17,10 @@ class PlaybackWarpProcessor : public ProcessorBase
     PlaybackWarpProcessor(std::string newUniqueName, nb::ndarray<float> input, double sr,
                           double data_sr);
 
+    // Play the same data as `other` without copying it, with the same clip
+    // info, clip positions and settings.
+    PlaybackWarpProcessor(std::string newUniqueName, const PlaybackWarpProcessor& other);
+
     void prepareToPlay(double, int) override;
 
     void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) override;
@@ -70,7 +74,7 @@ class PlaybackWarpProcessor : public ProcessorBase
         state["unique_name"] = getUniqueName();
         state["sample_rate"] = m_sample_rate;
         state["data_sample_rate"] = myPlaybackDataSR;
-        state["audio_data"] = bufferToPyArray(myPlaybackData);
+        state["audio_data"] = bufferToPyArray(*myPlaybackData);
 
         // Serialize clip info
         state["warp_on"] = m_clipInfo.warp_on;
@@ -169,7 +173,8 @@ class PlaybackWarpProcessor : public ProcessorBase
         double start_marker_offset = 0.;
     };
 
-    juce::AudioSampleBuffer myPlaybackData;
+    // Shared with clones (see the constructor that takes another processor).
+    std::shared_ptr<juce::AudioSampleBuffer> myPlaybackData;
     double myPlaybackDataSR = 0;
 
     std::unique_ptr<RubberBand::RubberBandStretcher> m_rbstretcher;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// What DawDreamer has learned about the parameters of one plugin binary, so
+// that get_parameters_description and get_parameter_range can answer without
+// calling into the plugin again (see PluginProcessor::getParameterValueRange).
+// Tables are shared by every processor of the same plugin and can be saved to
+// and loaded from an XML file.
+namespace PluginParameterTable
+{
+
+// The text of each range of normalized values, from probing a parameter.
+using TextRanges = std::map<std::pair<float, float>, std::string>;
+
+struct Parameter
+{
+    std::string name;
+    std::string label;
+    std::string category;
+    int numSteps = 0;
+    bool isBoolean = false;
+    bool isDiscrete = false;
+    bool isMetaParameter = false;
+    bool isAutomatable = true;
+    float defaultValue = 0.f;
+    std::string defaultValueText;
+    std::string minText;
+    std::string maxText;
+    std::vector<std::string> valueStrings;
+    // By the number of search steps they were probed with.
+    std::map<int, TextRanges> ranges;
+};
+
+struct Table
+{
+    std::vector<Parameter> parameters;
+};
+
+// Tables by plugin (see PluginProcessor::getParameterTableKey).
+using Tables = std::map<std::string, Table>;
+
+inline std::unique_ptr<juce::XmlElement> toXml(const Tables& tables)
+{
+    auto xml = std::make_unique<juce::XmlElement>("PARAMETER_TABLES");
+    for (auto& [key, table] : tables)
+    {
+        auto* tableXml = xml->createNewChildElement("TABLE");
+        tableXml->setAttribute("key", juce::String(key));
+        for (auto& parameter : table.parameters)
+        {
+            auto* parameterXml = tableXml->createNewChildElement("PARAMETER");
+            parameterXml->setAttribute("name", juce::String(parameter.name));
+            parameterXml->setAttribute("label", juce::String(parameter.label));
+            parameterXml->setAttribute("category", juce::String(parameter.category));
+            parameterXml->setAttribute("numSteps", parameter.numSteps);
+            parameterXml->setAttribute("isBoolean", parameter.isBoolean);
+            parameterXml->setAttribute("isDiscrete", parameter.isDiscrete);
+            parameterXml->setAttribute("isMetaParameter", parameter.isMetaParameter);
+            parameterXml->setAttribute("isAutomatable", parameter.isAutomatable);
+            parameterXml->setAttribute("defaultValue", parameter.defaultValue);
+            parameterXml->setAttribute("defaultValueText",
+                                       juce::String(parameter.defaultValueText));
+            parameterXml->setAttribute("min", juce::String(parameter.minText));
+            parameterXml->setAttribute("max", juce::String(parameter.maxText));
+
+            for (auto& valueString : parameter.valueStrings)
+            {
+                parameterXml->createNewChildElement("VALUE")->setAttribute(
+                    "text", juce::String(valueString));
+            }
+
+            for (auto& [searchSteps, ranges] : parameter.ranges)
+            {
+                auto* rangesXml = parameterXml->createNewChildElement("RANGES");
+                rangesXml->setAttribute("searchSteps", searchSteps);
+                for (auto& [range, text] : ranges)
+                {
+                    auto* rangeXml = rangesXml->createNewChildElement("RANGE");
+                    rangeXml->setAttribute("start", range.first);
+                    rangeXml->setAttribute("end", range.second);
+                    rangeXml->setAttribute("text", juce::String(text));
+                }
+            }
+        }
+    }
+    return xml;
+}
+
+// Add the tables in `xml` to `tables`, replacing tables with the same key.
+inline void fromXml(const juce::XmlElement& xml, Tables& tables)
+{
+    for (auto* tableXml : xml.getChildWithTagNameIterator("TABLE"))
+    {
+        Table table;
+        for (auto* parameterXml : tableXml->getChildWithTagNameIterator("PARAMETER"))
+        {
+            Parameter parameter;
+            parameter.name = parameterXml->getStringAttribute("name").toStdString();
+            parameter.label = parameterXml->getStringAttribute("label").toStdString();
+            parameter.category = parameterXml->getStringAttribute("category").toStdString();
+            parameter.numSteps = parameterXml->getIntAttribute("numSteps");
+            parameter.isBoolean = parameterXml->getBoolAttribute("isBoolean");
+            parameter.isDiscrete = parameterXml->getBoolAttribute("isDiscrete");
+            parameter.isMetaParameter = parameterXml->getBoolAttribute("isMetaParameter");
+            parameter.isAutomatable = parameterXml->getBoolAttribute("isAutomatable", true);
+            parameter.defaultValue = (float)parameterXml->getDoubleAttribute("defaultValue");
+            parameter.defaultValueText =
+                parameterXml->getStringAttribute("defaultValueText").toStdString();
+            parameter.minText = parameterXml->getStringAttribute("min").toStdString();
+            parameter.maxText = parameterXml->getStringAttribute("max").toStdString();
+
+            for (auto* valueXml : parameterXml->getChildWithTagNameIterator("VALUE"))
+            {
+                parameter.valueStrings.push_back(
+                    valueXml->getStringAttribute("text").toStdString());
+            }
+
+            for (auto* rangesXml : parameterXml->getChildWithTagNameIterator("RANGES"))
+            {
+                auto& ranges = parameter.ranges[rangesXml->getIntAttribute("searchSteps")];
+                for (auto* rangeXml : rangesXml->getChildWithTagNameIterator("RANGE"))
+                {
+                    const auto start = (float)rangeXml->getDoubleAttribute("start");
+                    const auto end = (float)rangeXml->getDoubleAttribute("end");
+                    ranges[{start, end}] = rangeXml->getStringAttribute("text").toStdString();
+                }
+            }
+
+            table.parameters.push_back(std::move(parameter));
+        }
+        tables[tableXml->getStringAttribute("key").toStdString()] = std::move(table);
+    }
+}
+
+} // namespace PluginParameterTable
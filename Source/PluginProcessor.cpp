@@ -3,7 +3,12 @@
 #include <filesystem>
 #include <mutex>
 #include <regex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
+#include "IsolatedPlugin.h"
+#include "PluginParameterTable.h"
 #include "StandalonePluginWindow.h"
 
 using juce::ExtensionsVisitor;
@@ -14,6 +19,132 @@ using juce::ExtensionsVisitor;
         throw std::runtime_error("Please load the plugin first!");                                 \
     }
 
+namespace
+{
+
+// Plugin scanning and instantiation use shared JUCE machinery, and
+// make_plugin_processor releases the GIL, so loads are serialized across
+// threads. This also guards everything below.
+std::mutex pluginLoadMutex;
+
+// The descriptions of every plugin file scanned so far. Loading a file again
+// reuses its descriptions instead of scanning it, unless the file was modified
+// since (see KnownPluginList::scanAndAddFile).
+KnownPluginList& getKnownPlugins()
+{
+    static KnownPluginList knownPlugins;
+    return knownPlugins;
+}
+
+// Where the descriptions are also saved so that other processes can skip
+// scanning, or empty to only cache in memory.
+std::string scanCacheDirectory;
+
+juce::File getScanCacheFile()
+{
+    return juce::File(scanCacheDirectory).getChildFile("plugin_scan_cache.xml");
+}
+
+// Processes hold this lock while they change the cache file. The name is a hash
+// of the file's path because it can't contain path separators.
+juce::String getScanCacheLockName()
+{
+    return "DawDreamer_scan_cache_" + juce::String::toHexString(getScanCacheFile().hashCode64());
+}
+
+// Add the descriptions saved in the cache directory for plugin files that
+// haven't been scanned in this process.
+void readScanCacheFile()
+{
+    auto xml = juce::parseXML(getScanCacheFile());
+    if (!xml)
+    {
+        return;
+    }
+
+    KnownPluginList saved;
+    saved.recreateFromXml(*xml);
+    for (const auto& type : saved.getTypes())
+    {
+        if (!getKnownPlugins().getTypeForFile(type.fileOrIdentifier))
+        {
+            getKnownPlugins().addType(type);
+        }
+    }
+}
+
+void writeScanCacheFile()
+{
+    auto cacheFile = getScanCacheFile();
+
+    // Without the lock, two processes could each read the file, add their own
+    // scans and replace it, and one of them would lose the other's scans.
+    juce::InterProcessLock lock(getScanCacheLockName());
+    juce::InterProcessLock::ScopedLockType scopedLock(lock);
+    if (!scopedLock.isLocked())
+    {
+        return;
+    }
+
+    // Keep what other processes saved since this one last read the file.
+    readScanCacheFile();
+
+    cacheFile.getParentDirectory().createDirectory();
+    // Write to a temporary file first so that other processes sharing the
+    // directory never read a partial file.
+    juce::TemporaryFile tempFile(cacheFile);
+    if (getKnownPlugins().createXml()->writeTo(tempFile.getFile()))
+    {
+        tempFile.overwriteTargetFileWithTemporary();
+    }
+}
+
+// The size and latest modification time of a plugin's file, which change when
+// the plugin is rebuilt. VST3 and AU plugins are usually bundles, directories
+// whose own size and time stay the same, so those add up every file inside.
+std::pair<juce::int64, juce::int64> getPluginFileFingerprint(const juce::File& pluginFile)
+{
+    if (!pluginFile.isDirectory())
+    {
+        return {pluginFile.getSize(), pluginFile.getLastModificationTime().toMilliseconds()};
+    }
+
+    juce::int64 size = 0;
+    juce::int64 modificationTime = 0;
+    // Links inside a bundle point at files in the same bundle.
+    for (const auto& entry : juce::RangedDirectoryIterator(
+             pluginFile, true, "*", juce::File::findFiles, juce::File::FollowSymlinks::no))
+    {
+        size += entry.getFileSize();
+        modificationTime =
+            std::max(modificationTime, entry.getModificationTime().toMilliseconds());
+    }
+    return {size, modificationTime};
+}
+
+struct StateSnapshot
+{
+    juce::String pluginIdentifier;
+    juce::MemoryBlock state;
+    size_t hash;
+};
+
+// Every snapshot taken with snapshotState, by handle.
+std::mutex stateSnapshotMutex;
+std::unordered_map<int64_t, std::shared_ptr<const StateSnapshot>> stateSnapshots;
+std::unordered_multimap<size_t, int64_t> stateSnapshotsByHash;
+int64_t nextStateSnapshotHandle = 1;
+
+// Parameter tables of every plugin loaded so far (see getParameterTableKey).
+std::mutex parameterTableMutex;
+PluginParameterTable::Tables parameterTables;
+
+// The command that starts the helper process of an isolated plugin, without
+// the pipe's name that's appended to it (see setIsolatedHostCommand).
+juce::StringArray isolatedHostCommand;
+
+} // namespace
+
 struct PresetVisitor : public ExtensionsVisitor
 {
     const std::string presetFilePath;
@@ -38,10 +169,11 @@ struct PresetVisitor : public ExtensionsVisitor
 };
 
 PluginProcessor::PluginProcessor(std::string newUniqueName, double sampleRate, int samplesPerBlock,
-                                 std::string path)
+                                 std::string path, bool isolated)
     : ProcessorBase{newUniqueName}, myPlugin{nullptr}
 {
     myPluginPath = path;
+    myIsIsolated = isolated;
 
     loadPlugin(sampleRate, samplesPerBlock);
 }
@@ -50,6 +182,11 @@ void PluginProcessor::openEditor()
 {
     THROW_ERROR_IF_NO_PLUGIN
 
+    if (myIsIsolated)
+    {
+        throw std::runtime_error("The editor of an isolated plugin can't be shown.");
+    }
+
     if (!juce::Desktop::getInstance().getDisplays().getPrimaryDisplay())
     {
         throw std::runtime_error("Editor cannot be shown because no visual display devices are "
@@ -66,54 +203,76 @@ void PluginProcessor::openEditor()
 
 bool PluginProcessor::loadPlugin(double sampleRate, int samplesPerBlock)
 {
-    // Plugin scanning and instantiation use shared JUCE machinery, and
-    // make_plugin_processor releases the GIL, so serialize loads across
-    // threads.
-    static std::mutex pluginLoadMutex;
-    std::lock_guard<std::mutex> lock(pluginLoadMutex);
-
-    OwnedArray<PluginDescription> pluginDescriptions;
-    KnownPluginList pluginList;
-    AudioPluginFormatManager pluginFormatManager;
-
-    pluginFormatManager.addDefaultFormats();
-
-    for (int i = pluginFormatManager.getNumFormats(); --i >= 0;)
-    {
-        auto* format = pluginFormatManager.getFormat(i);
-
-        // Only scan with formats that might match the file. Probing a path
-        // with every format is slow and makes non-matching backends print
-        // errors to stderr (e.g. LV2's "attempt to map invalid URI" for a
-        // .vst3 path).
-        if (format->fileMightContainThisPluginType(String(myPluginPath)))
-        {
-            pluginList.scanAndAddFile(String(myPluginPath), true, pluginDescriptions, *format);
-        }
-    }
-
     if (myPlugin.get())
     {
         myPlugin.get()->releaseResources();
         myPlugin.reset();
     }
 
-    // If there is a problem here first check the preprocessor definitions
-    // in the projucer are sensible - is it set up to scan for plugin's?
-    if (pluginDescriptions.size() <= 0)
+    if (myIsIsolated)
     {
-        throw std::runtime_error("Unable to load plugin.");
+        // The helper process scans and loads the plugin, so there's nothing
+        // to serialize with other loads.
+        if (isolatedHostCommand.isEmpty() || isolatedHostCommand[0].isEmpty())
+        {
+            throw std::runtime_error("Isolated plugins need a Python executable to start, but "
+                                     "sys.executable is empty.");
+        }
+        myPlugin = IsolatedPlugin::Instance::create(isolatedHostCommand, myPluginPath, sampleRate,
+                                                    samplesPerBlock);
     }
+    else
+    {
+        std::lock_guard<std::mutex> lock(pluginLoadMutex);
 
-    String errorMessage;
+        OwnedArray<PluginDescription> pluginDescriptions;
+        auto& knownPlugins = getKnownPlugins();
+        AudioPluginFormatManager pluginFormatManager;
 
-    myPlugin = pluginFormatManager.createPluginInstance(*pluginDescriptions[0], sampleRate,
-                                                        samplesPerBlock, errorMessage);
+        pluginFormatManager.addDefaultFormats();
 
-    if (myPlugin.get() == nullptr)
-    {
-        throw std::runtime_error("PluginProcessor::loadPlugin error: " +
-                                 errorMessage.toStdString());
+        for (int i = pluginFormatManager.getNumFormats(); --i >= 0;)
+        {
+            auto* format = pluginFormatManager.getFormat(i);
+
+            // Only scan with formats that might match the file. Probing a path
+            // with every format is slow and makes non-matching backends print
+            // errors to stderr (e.g. LV2's "attempt to map invalid URI" for a
+            // .vst3 path).
+            if (format->fileMightContainThisPluginType(String(myPluginPath)))
+            {
+                if (!scanCacheDirectory.empty() && !knownPlugins.getTypeForFile(myPluginPath))
+                {
+                    readScanCacheFile();
+                }
+
+                // Only scans if the file is new or was modified.
+                const bool scanned = knownPlugins.scanAndAddFile(String(myPluginPath), true,
+                                                                 pluginDescriptions, *format);
+                if (scanned && !scanCacheDirectory.empty())
+                {
+                    writeScanCacheFile();
+                }
+            }
+        }
+
+        // If there is a problem here first check the preprocessor definitions
+        // in the projucer are sensible - is it set up to scan for plugin's?
+        if (pluginDescriptions.size() <= 0)
+        {
+            throw std::runtime_error("Unable to load plugin.");
+        }
+
+        String errorMessage;
+
+        myPlugin = pluginFormatManager.createPluginInstance(*pluginDescriptions[0], sampleRate,
+                                                            samplesPerBlock, errorMessage);
+
+        if (myPlugin.get() == nullptr)
+        {
+            throw std::runtime_error("PluginProcessor::loadPlugin error: " +
+                                     errorMessage.toStdString());
+        }
     }
     // We loaded the plugin.
 
@@ -151,6 +310,230 @@ bool PluginProcessor::loadPlugin(double sampleRate, int samplesPerBlock)
     return true;
 }
 
+void PluginProcessor::setScanCacheDirectory(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(pluginLoadMutex);
+    scanCacheDirectory = path;
+}
+
+std::string PluginProcessor::getScanCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(pluginLoadMutex);
+    return scanCacheDirectory;
+}
+
+void PluginProcessor::clearScanCache()
+{
+    std::lock_guard<std::mutex> lock(pluginLoadMutex);
+    getKnownPlugins().clear();
+    if (!scanCacheDirectory.empty())
+    {
+        juce::InterProcessLock lock(getScanCacheLockName());
+        juce::InterProcessLock::ScopedLockType scopedLock(lock);
+        getScanCacheFile().deleteFile();
+    }
+}
+
+void PluginProcessor::setIsolatedHostCommand(const std::vector<std::string>& command)
+{
+    isolatedHostCommand.clear();
+    for (const auto& arg : command)
+    {
+        isolatedHostCommand.add(arg);
+    }
+}
+
+void PluginProcessor::runIsolatedHost(const std::string& pipeName)
+{
+    using namespace IsolatedPlugin;
+
+    Connection connection;
+    if (!connection.connectToPipe(pipeName, 10000))
+    {
+        throw std::runtime_error("Unable to connect to the pipe: " + pipeName);
+    }
+
+    std::unique_ptr<PluginProcessor> processor;
+    FixedPlayHead playHead;
+    SharedBlock shared;
+    std::vector<float*> channels;
+    juce::MidiBuffer midiBuffer;
+
+    juce::MemoryBlock message;
+    auto lastReplyTime = juce::Time::getMillisecondCounter();
+    while (!connection.isLost())
+    {
+        if (!connection.waitForMessage(message, 1000))
+        {
+            // Pings only start once the plugin is loaded, which can take long.
+            const auto sinceReply = juce::Time::getMillisecondCounter() - lastReplyTime;
+            if (connection.getMillisecondsSincePing() > kPingTimeoutMs &&
+                sinceReply > kPingTimeoutMs)
+            {
+                break;
+            }
+            continue;
+        }
+
+        juce::MemoryInputStream in(message, false);
+        juce::MemoryOutputStream reply;
+        reply.writeInt(1);
+
+        try
+        {
+            const auto request = (Request)in.readInt();
+            if (request == Request::quit)
+            {
+                break;
+            }
+            if (request != Request::load && !processor)
+            {
+                throw std::runtime_error("Please load the plugin first!");
+            }
+            auto* plugin = processor ? processor->myPlugin.get() : nullptr;
+
+            switch (request)
+            {
+            case Request::load:
+            {
+                auto path = in.readString().toStdString();
+                const double sampleRate = in.readDouble();
+                const int samplesPerBlock = in.readInt();
+                processor = std::make_unique<PluginProcessor>("isolated", sampleRate,
+                                                              samplesPerBlock, path);
+                plugin = processor->myPlugin.get();
+                plugin->setPlayHead(&playHead);
+
+                juce::PluginDescription description;
+                plugin->fillInPluginDescription(description);
+                writeBuses(reply, *plugin);
+                reply.writeString(description.createXml()->toString());
+                reply.writeBool(plugin->acceptsMidi());
+                reply.writeBool(plugin->producesMidi());
+                writeParameterInfo(reply, *plugin);
+                writeInfo(reply, *plugin);
+                break;
+            }
+            case Request::prepare:
+            {
+                const double sampleRate = in.readDouble();
+                const int samplesPerBlock = in.readInt();
+                plugin->prepareToPlay(sampleRate, samplesPerBlock);
+                writeInfo(reply, *plugin);
+                break;
+            }
+            case Request::release:
+                plugin->releaseResources();
+                break;
+            case Request::reset:
+                plugin->reset();
+                break;
+            case Request::process:
+            {
+                auto sharedPath = in.readString();
+                if (sharedPath.isNotEmpty())
+                {
+                    shared.open(juce::File(sharedPath));
+                }
+                const int numChannels = in.readInt();
+                const int numSamples = in.readInt();
+                const bool isNonRealtime = in.readBool();
+                if (isNonRealtime != plugin->isNonRealtime())
+                {
+                    plugin->setNonRealtime(isNonRealtime);
+                }
+                playHead.position = readPosition(in);
+                readParameters(in, *plugin);
+
+                // Process the shared audio in place.
+                channels.resize((size_t)numChannels);
+                for (int chan = 0; chan < numChannels; chan++)
+                {
+                    channels[(size_t)chan] = shared.getChannel(chan, numSamples);
+                }
+                juce::AudioBuffer<float> buffer(channels.data(), numChannels, numSamples);
+                const auto audioSize = SharedBlock::getAudioSize(numChannels, numSamples);
+                shared.readMidi(audioSize, midiBuffer);
+
+                plugin->processBlock(buffer, midiBuffer);
+
+                if (!shared.writeMidi(audioSize, midiBuffer))
+                {
+                    writeMidi(reply, midiBuffer);
+                }
+                break;
+            }
+            case Request::getState:
+            {
+                readParameters(in, *plugin);
+                juce::MemoryBlock state;
+                plugin->getStateInformation(state);
+                reply.writeInt64((juce::int64)state.getSize());
+                reply << state;
+                break;
+            }
+            case Request::setState:
+            {
+                juce::MemoryBlock state;
+                in.readIntoMemoryBlock(state, (ssize_t)in.readInt64());
+                plugin->setStateInformation(state.getData(), (int)state.getSize());
+                writeInfo(reply, *plugin);
+                break;
+            }
+            case Request::loadPreset:
+            case Request::loadVST3Preset:
+            {
+                auto path = in.readString().toStdString();
+                reply.writeBool(request == Request::loadPreset ? processor->loadPreset(path)
+                                                               : processor->loadVST3Preset(path));
+                writeInfo(reply, *plugin);
+                break;
+            }
+            case Request::getParameterText:
+            case Request::getParameterValueForText:
+            {
+                auto* parameter = plugin->getParameters()[in.readInt()];
+                if (!parameter)
+                {
+                    throw std::runtime_error("Parameter not found.");
+                }
+                if (request == Request::getParameterText)
+                {
+                    reply.writeString(
+                        parameter->getText(in.readFloat(), DAW_PARAMETER_MAX_NAME_LENGTH));
+                }
+                else
+                {
+                    reply.writeFloat(parameter->getValueForText(in.readString()));
+                }
+                break;
+            }
+            case Request::isLayoutSupported:
+                reply.writeBool(plugin->checkBusesLayoutSupported(readLayout(in)));
+                break;
+            case Request::setLayout:
+                reply.writeBool(plugin->setBusesLayout(readLayout(in)));
+                writeInfo(reply, *plugin);
+                break;
+            default:
+                throw std::runtime_error("Unknown request to an isolated plugin.");
+            }
+        }
+        catch (const std::exception& e)
+        {
+            reply.reset();
+            reply.writeInt(0);
+            reply.writeString(e.what());
+        }
+
+        if (!connection.send(reply.getMemoryBlock()))
+        {
+            break;
+        }
+        lastReplyTime = juce::Time::getMillisecondCounter();
+    }
+}
+
 PluginProcessor::~PluginProcessor()
 {
     if (myPlugin.get())
@@ -284,20 +667,16 @@ void PluginProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBu
     }
 
     {
-        auto pulseStart = std::floor(*posInfo->getPpqPosition() * PPQN);
-        auto pulseEnd = pulseStart +
-                        buffer.getNumSamples() * (*posInfo->getBpm() * PPQN) / (mySampleRate * 60.);
-
-        myIsMessageBetweenQN =
-            myMidiMessagePositionQN >= pulseStart && myMidiMessagePositionQN < pulseEnd;
+        // The tempo map gives the exact sample of each event in beats.
+        auto start = *posInfo->getTimeInSamples();
+        auto end = start + buffer.getNumSamples();
+        auto eventSample = getSampleAtPulse(myMidiMessagePositionQN);
+        myIsMessageBetweenQN = eventSample < end;
         while (myIsMessageBetweenQN && myMidiEventsDoRemainQN)
         {
             // steps for saving midi to file output
             auto messageCopy = MidiMessage(myMidiMessageQN);
-            messageCopy.setTimeStamp(
-                (*posInfo->getTimeInSeconds() +
-                 (myMidiMessagePositionQN - pulseStart) * (60. / (*posInfo->getBpm())) / PPQN) *
-                2400.);
+            messageCopy.setTimeStamp(eventSample * (2400. / mySampleRate));
             if (!(messageCopy.isEndOfTrackMetaEvent() || messageCopy.isTempoMetaEvent()))
             {
                 myRecordedMidiSequence.addEvent(messageCopy);
@@ -305,16 +684,34 @@ void PluginProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBu
 
             // steps for playing MIDI
             myRenderMidiBuffer.addEvent(myMidiMessageQN,
-                                        int((myMidiMessagePositionQN - pulseStart) * 60. *
-                                            mySampleRate / (PPQN * *posInfo->getBpm())));
+                                        int(std::max<int64_t>(0, eventSample - start)));
             myMidiEventsDoRemainQN =
                 myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
-            myIsMessageBetweenQN =
-                myMidiMessagePositionQN >= pulseStart && myMidiMessagePositionQN < pulseEnd;
+            eventSample = getSampleAtPulse(myMidiMessagePositionQN);
+            myIsMessageBetweenQN = eventSample < end;
         }
     }
 
-    myPlugin->processBlock(buffer, myRenderMidiBuffer);
+    processWithAutomation(
+        buffer.getNumSamples(),
+        [&](int start, int numSamples)
+        {
+            if (numSamples == buffer.getNumSamples())
+            {
+                myPlugin->processBlock(buffer, myRenderMidiBuffer);
+                return;
+            }
+
+            juce::AudioSampleBuffer subBlock(buffer.getArrayOfWritePointers(),
+                                             buffer.getNumChannels(), start, numSamples);
+            mySubBlockMidiBuffer.clear();
+            mySubBlockMidiBuffer.addEvents(myRenderMidiBuffer, start, numSamples, -start);
+            mySubBlockPlayHead.position = offsetPosition(*posInfo, start);
+
+            myPlugin->setPlayHead(&mySubBlockPlayHead);
+            myPlugin->processBlock(subBlock, mySubBlockMidiBuffer);
+            myPlugin->setPlayHead(getPlayHead());
+        });
 
     ProcessorBase::processBlock(buffer, midiBuffer);
 }
@@ -325,7 +722,7 @@ void PluginProcessor::automateParameters(AudioPlayHead::PositionInfo& posInfo, i
 
     int i = 0;
 
-    auto allParameters = this->getParameters();
+    const auto& allParameters = getAutomationParameters();
 
     for (juce::AudioProcessorParameter* parameter : myPlugin->getParameters())
     {
@@ -335,16 +732,20 @@ void PluginProcessor::automateParameters(AudioPlayHead::PositionInfo& posInfo, i
             continue;
         }
 
-        auto theParameter = (AutomateParameterFloat*)allParameters.getUnchecked(i);
+        auto theParameter = allParameters[(size_t)i];
 
         // only need to update if it's an automated parameter (there are multiple
         // samples to choose from)
         if (theParameter->isAutomated())
         {
-            // parameter->setValue(theParameter->sample(posInfo));
-            parameter->beginChangeGesture();
-            parameter->setValueNotifyingHost(theParameter->sample(posInfo));
-            parameter->endChangeGesture();
+            // The plugin picks up the value in its next processBlock (VST3
+            // plugins as a parameter change), so listeners don't need to be
+            // notified, and unchanged values needn't be sent at all.
+            const float value = theParameter->sample(posInfo);
+            if (value != parameter->getValue())
+            {
+                parameter->setValue(value);
+            }
         }
 
         i++;
@@ -358,12 +759,12 @@ void PluginProcessor::reset()
         myPlugin->reset();
     }
 
-    myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec);
+    myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec, getRenderStartSample());
 
     myMidiEventsDoRemainSec =
         myMidiIteratorSec.getNextEvent(myMidiMessageSec, myMidiMessagePositionSec);
 
-    myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN);
+    myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN, getRenderStartPulse());
 
     myMidiEventsDoRemainQN =
         myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
@@ -394,17 +795,19 @@ bool PluginProcessor::loadPreset(const std::string& path)
         File file = File(path);
         file.loadFileAsData(mb);
 
-        // The VST2 way of loading preset.
-        bool result = VSTPluginFormat::loadFromFXBFile(myPlugin.get(), mb.getData(), mb.getSize());
-
-        int i = 0;
-        for (auto* parameter : myPlugin->getParameters())
+        bool result;
+        if (auto* isolated = dynamic_cast<IsolatedPlugin::Instance*>(myPlugin.get()))
         {
-            auto value = parameter->getValue();
-            ProcessorBase::setAutomationValByIndex(i, value);
-            i++;
+            result = isolated->loadPreset(path, false);
+        }
+        else
+        {
+            // The VST2 way of loading preset.
+            result = VSTPluginFormat::loadFromFXBFile(myPlugin.get(), mb.getData(), mb.getSize());
         }
 
+        syncAutomationWithPlugin();
+
         return result;
     }
     catch (std::exception& e)
@@ -433,20 +836,21 @@ bool PluginProcessor::loadVST3Preset(const std::string& path)
 
     try
     {
-        myPlugin->getExtensions(presetVisitor);
+        if (auto* isolated = dynamic_cast<IsolatedPlugin::Instance*>(myPlugin.get()))
+        {
+            isolated->loadPreset(path, true);
+        }
+        else
+        {
+            myPlugin->getExtensions(presetVisitor);
+        }
     }
     catch (const std::exception&)
     {
         throw std::runtime_error("PluginProcessor::loadVST3Preset: unknown error.");
     }
 
-    int i = 0;
-    for (auto* parameter : myPlugin->getParameters())
-    {
-        auto value = parameter->getValue();
-        ProcessorBase::setAutomationValByIndex(i, value);
-        i++;
-    }
+    syncAutomationWithPlugin();
 
     return true;
 }
@@ -464,17 +868,101 @@ void PluginProcessor::loadStateInformation(std::string filepath)
 
     myPlugin->setStateInformation((const char*)state.getData(), (int)state.getSize());
 
-    int i = 0;
-    for (auto* parameter : myPlugin->getParameters())
-    {
-        ProcessorBase::setAutomationValByIndex(i, parameter->getValue());
-        i++;
-    }
+    syncAutomationWithPlugin();
 
     // todo: this is a little hacky. We create a window because this forces the
     // loaded state to take effect in certain plugins. This allows us to call
     // load_state and not bother calling open_editor().
-    StandalonePluginWindow tmp_window(*this, *myPlugin);
+    if (!myIsIsolated)
+    {
+        StandalonePluginWindow tmp_window(*this, *myPlugin);
+    }
+}
+
+void PluginProcessor::copyPluginStateFrom(PluginProcessor& other)
+{
+    THROW_ERROR_IF_NO_PLUGIN
+
+    if (!other.myPlugin)
+    {
+        return;
+    }
+
+    setBusesLayout(other.getBusesLayout());
+
+    MemoryBlock state;
+    other.myPlugin->getStateInformation(state);
+    myPlugin->setStateInformation((const char*)state.getData(), (int)state.getSize());
+}
+
+int64_t PluginProcessor::snapshotState()
+{
+    THROW_ERROR_IF_NO_PLUGIN
+
+    auto snapshot = std::make_shared<StateSnapshot>();
+    snapshot->pluginIdentifier = myPlugin->getPluginDescription().createIdentifierString();
+    myPlugin->getStateInformation(snapshot->state);
+    snapshot->hash = std::hash<std::string_view>{}(
+        {(const char*)snapshot->state.getData(), snapshot->state.getSize()});
+    snapshot->hash ^= std::hash<juce::String>{}(snapshot->pluginIdentifier);
+
+    std::lock_guard<std::mutex> lock(stateSnapshotMutex);
+    auto [first, last] = stateSnapshotsByHash.equal_range(snapshot->hash);
+    for (auto it = first; it != last; it++)
+    {
+        auto& existing = *stateSnapshots.at(it->second);
+        if (existing.pluginIdentifier == snapshot->pluginIdentifier &&
+            existing.state == snapshot->state)
+        {
+            return it->second;
+        }
+    }
+
+    const int64_t handle = nextStateSnapshotHandle++;
+    stateSnapshotsByHash.emplace(snapshot->hash, handle);
+    stateSnapshots.emplace(handle, std::move(snapshot));
+    return handle;
+}
+
+void PluginProcessor::restoreState(int64_t handle)
+{
+    THROW_ERROR_IF_NO_PLUGIN
+
+    std::shared_ptr<const StateSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(stateSnapshotMutex);
+        auto it = stateSnapshots.find(handle);
+        if (it == stateSnapshots.end())
+        {
+            throw std::runtime_error("Unknown state snapshot: " + std::to_string(handle));
+        }
+        snapshot = it->second;
+    }
+
+    if (snapshot->pluginIdentifier != myPlugin->getPluginDescription().createIdentifierString())
+    {
+        throw std::runtime_error("The state snapshot was taken from a different plugin.");
+    }
+
+    myPlugin->setStateInformation(snapshot->state.getData(), (int)snapshot->state.getSize());
+    syncAutomationWithPlugin();
+}
+
+void PluginProcessor::clearStateSnapshots()
+{
+    std::lock_guard<std::mutex> lock(stateSnapshotMutex);
+    stateSnapshots.clear();
+    stateSnapshotsByHash.clear();
+}
+
+void PluginProcessor::syncAutomationWithPlugin()
+{
+    const auto& parameters = myPlugin->getParameters();
+    const auto& automation = getAutomationParameters();
+    for (size_t i = 0; i < automation.size() && i < (size_t)parameters.size(); i++)
+    {
+        automation[i]->setAutomation(parameters.getUnchecked((int)i)->getValue());
+    }
 }
 
 void PluginProcessor::saveStateInformation(std::string filepath)
@@ -546,6 +1034,31 @@ void PluginProcessor::setPatch(const PluginPatch patch)
     }
 }
 
+bool PluginProcessor::hashConfiguration(ConfigurationHasher& hasher)
+{
+    if (!myPlugin)
+    {
+        return false;
+    }
+
+    // The plugin's state covers settings that aren't exposed as parameters.
+    // It also holds the parameters' current values, which automation leaves
+    // at their last values, so changing a plugin's automation misses the
+    // cache on the next render too.
+    hasher.add(myPluginPath);
+    const auto description = myPlugin->getPluginDescription();
+    hasher.add(description.createIdentifierString());
+    hasher.add(description.version);
+    // Rebuilding the plugin changes its file.
+    const auto [fileSize, modificationTime] = getPluginFileFingerprint(juce::File(myPluginPath));
+    hasher.add(fileSize);
+    hasher.add(modificationTime);
+    juce::MemoryBlock state;
+    myPlugin->getStateInformation(state);
+    hasher.add(state.getData(), state.getSize());
+    return true;
+}
+
 double PluginProcessor::getTailLengthSeconds() const
 {
     THROW_ERROR_IF_NO_PLUGIN
@@ -743,8 +1256,9 @@ void PluginProcessor::saveMIDI(std::string& savePath)
 //==============================================================================
 
 PluginProcessorWrapper::PluginProcessorWrapper(std::string newUniqueName, double sampleRate,
-                                               int samplesPerBlock, std::string path)
-    : PluginProcessor(newUniqueName, sampleRate, samplesPerBlock, path)
+                                               int samplesPerBlock, std::string path,
+                                               bool isolated)
+    : PluginProcessor(newUniqueName, sampleRate, samplesPerBlock, path, isolated)
 {
 }
 
@@ -768,23 +1282,27 @@ std::string PluginProcessorWrapper::wrapperGetParameterName(const int& parameter
     throw std::runtime_error("Parameter not found for index: " + std::to_string(parameter));
 }
 
-bool PluginProcessorWrapper::wrapperSetParameter(const int& parameterIndex, const float& value)
+bool PluginProcessor::setAutomationValByIndex(int index, float val)
 {
     THROW_ERROR_IF_NO_PLUGIN
 
-    if (parameterIndex < 0 || parameterIndex >= getParameters().size())
+    if (index < 0 || index >= getParameters().size())
     {
-        throw std::runtime_error("Parameter not found for index: " +
-                                 std::to_string(parameterIndex));
+        throw std::runtime_error("Parameter not found for index: " + std::to_string(index));
     }
 
-    auto pluginParameter = myPlugin->getParameters().getUnchecked(parameterIndex);
-    pluginParameter->setValue(value);
+    auto pluginParameter = myPlugin->getParameters().getUnchecked(index);
+    pluginParameter->setValue(val);
     // pluginParameter->beginChangeGesture();
-    // pluginParameter->setValueNotifyingHost(value);
+    // pluginParameter->setValueNotifyingHost(val);
     // pluginParameter->endChangeGesture();
 
-    return ProcessorBase::setAutomationValByIndex(parameterIndex, value);
+    return ProcessorBase::setAutomationValByIndex(index, val);
+}
+
+bool PluginProcessorWrapper::wrapperSetParameter(const int& parameterIndex, const float& value)
+{
+    return setAutomationValByIndex(parameterIndex, value);
 }
 
 int PluginProcessorWrapper::wrapperGetPluginParameterSize()
@@ -930,14 +1448,74 @@ ValueType extract_value(const std::string& s)
     }
 }
 
-std::map<std::pair<float, float>, ValueType> getParameterRange(AudioProcessorParameter* parameter,
-                                                               int searchSteps, bool convert)
+// Everything about a parameter that doesn't depend on its value.
+PluginParameterTable::Parameter describeParameter(AudioProcessorParameter* parameter)
+{
+    PluginParameterTable::Parameter info;
+    info.name = parameter->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+    info.label = parameter->getLabel().toStdString();
+
+    switch (parameter->getCategory())
+    {
+    case AudioProcessorParameter::Category::genericParameter:
+        info.category = "genericParameter";
+        break;
+    case AudioProcessorParameter::Category::inputGain:
+        info.category = "inputGain";
+        break;
+    case AudioProcessorParameter::Category::outputGain:
+        info.category = "outputGain";
+        break;
+    case AudioProcessorParameter::Category::inputMeter:
+        info.category = "inputMeter";
+        break;
+    case AudioProcessorParameter::Category::outputMeter:
+        info.category = "outputMeter";
+        break;
+    case AudioProcessorParameter::Category::compressorLimiterGainReductionMeter:
+        info.category = "compressorLimiterGainReductionMeter";
+        break;
+    case AudioProcessorParameter::Category::expanderGateGainReductionMeter:
+        info.category = "expanderGateGainReductionMeter";
+        break;
+    case AudioProcessorParameter::Category::analysisMeter:
+        info.category = "analysisMeter";
+        break;
+    case AudioProcessorParameter::Category::otherMeter:
+        info.category = "otherMeter";
+        break;
+    default:
+        info.category = "unknown";
+        break;
+    }
+
+    info.numSteps = parameter->getNumSteps();
+    info.isBoolean = parameter->isBoolean();
+    info.isDiscrete = parameter->isDiscrete();
+    info.isMetaParameter = parameter->isMetaParameter();
+    info.isAutomatable = parameter->isAutomatable();
+    info.defaultValue = parameter->getDefaultValue();
+    info.defaultValueText =
+        parameter->getText(parameter->getDefaultValue(), DAW_PARAMETER_MAX_NAME_LENGTH)
+            .toStdString();
+    info.minText = parameter->getText(0.f, DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+    info.maxText = parameter->getText(1.f, DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+
+    for (auto& valueString : parameter->getAllValueStrings())
+    {
+        info.valueStrings.push_back(valueString.toStdString());
+    }
+
+    return info;
+}
+
+PluginParameterTable::TextRanges probeTextRanges(AudioProcessorParameter* parameter,
+                                                 int searchSteps)
 {
     // Adapted from pedalboard (GPL-3.0)
     // https://github.com/spotify/pedalboard/blob/ee16bb8805859fcd7e2fb7b00c8946666194774b/pedalboard/_pedalboard.py#L290-L318
-    std::map<std::pair<float, float>, ValueType> ranges;
+    PluginParameterTable::TextRanges ranges;
     std::string text;
-    bool resultsLookIncorrect = false;
 
     float startOfRange = 0;
     text.clear();
@@ -980,17 +1558,25 @@ std::map<std::pair<float, float>, ValueType> getParameterRange(AudioProcessorPar
         ranges[{ranges.rbegin()->first.second, 1.0f}] = text; // Final range
     }
 
+    return ranges;
+}
+
+std::map<std::pair<float, float>, ValueType>
+convertTextRanges(const PluginParameterTable::TextRanges& textRanges, bool convert)
+{
+    std::map<std::pair<float, float>, ValueType> ranges(textRanges.begin(), textRanges.end());
+
     if (!convert)
     {
         return ranges;
     }
 
     std::map<std::pair<float, float>, ValueType> rangeFloat;
-    for (auto& kv : ranges)
+    for (auto& kv : textRanges)
     {
         try
         {
-            rangeFloat[kv.first] = stringToFloat(std::get<std::string>(kv.second));
+            rangeFloat[kv.first] = stringToFloat(kv.second);
         }
         catch (const std::invalid_argument& e)
         {
@@ -1010,8 +1596,143 @@ PluginProcessor::getParameterValueRange(const int parameterIndex, int search_ste
                                  std::to_string(parameterIndex));
     }
 
+    const auto key = getParameterTableKey();
+    {
+        std::lock_guard<std::mutex> lock(parameterTableMutex);
+        auto& ranges = getParameterTable(key).parameters[(size_t)parameterIndex].ranges;
+        auto it = ranges.find(search_steps);
+        if (it != ranges.end())
+        {
+            return convertTextRanges(it->second, convert);
+        }
+    }
+
+    // Probe without the lock, since it can take long.
     auto pluginParameter = myPlugin->getParameters().getUnchecked(parameterIndex);
-    return getParameterRange(pluginParameter, search_steps, convert);
+    auto textRanges = probeTextRanges(pluginParameter, search_steps);
+    {
+        std::lock_guard<std::mutex> lock(parameterTableMutex);
+        getParameterTable(key).parameters[(size_t)parameterIndex].ranges[search_steps] =
+            textRanges;
+    }
+    return convertTextRanges(textRanges, convert);
+}
+
+void PluginProcessor::cacheParameterRanges(int searchSteps, int numThreads)
+{
+    THROW_ERROR_IF_NO_PLUGIN
+
+    const int numParameters = myPlugin->getParameters().size();
+    if (numThreads <= 0)
+    {
+        numThreads = juce::SystemStats::getNumCpus();
+    }
+    numThreads = std::max(1, std::min(numThreads, numParameters));
+
+    {
+        std::lock_guard<std::mutex> lock(parameterTableMutex);
+        getParameterTable(getParameterTableKey());
+    }
+
+    // Probing sets the parameters' values, so each thread probes its own
+    // instance of the plugin, in this processor's state.
+    std::vector<std::unique_ptr<PluginProcessor>> processors;
+    for (int i = 1; i < numThreads; i++)
+    {
+        auto processor = std::make_unique<PluginProcessor>(
+            getUniqueName(), mySampleRate, getBlockSize(), myPluginPath, myIsIsolated);
+        processor->copyPluginStateFrom(*this);
+        processors.push_back(std::move(processor));
+    }
+
+    std::vector<std::exception_ptr> errors((size_t)numThreads);
+    auto probe = [&](PluginProcessor& processor, int thread)
+    {
+        try
+        {
+            for (int i = thread; i < numParameters; i += numThreads)
+            {
+                processor.getParameterValueRange(i, searchSteps, false);
+            }
+        }
+        catch (...)
+        {
+            errors[(size_t)thread] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numThreads; i++)
+    {
+        threads.emplace_back(probe, std::ref(*processors[(size_t)i - 1]), i);
+    }
+    probe(*this, 0);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+std::string PluginProcessor::getParameterTableKey()
+{
+    auto description = myPlugin->getPluginDescription();
+    // Rebuilding the plugin changes its file, maybe without changing its
+    // version (see hashConfiguration).
+    const auto [fileSize, modificationTime] = getPluginFileFingerprint(juce::File(myPluginPath));
+    return (description.createIdentifierString() + "-" + description.version + "-" +
+            juce::String(fileSize) + "-" + juce::String(modificationTime))
+        .toStdString();
+}
+
+PluginParameterTable::Table& PluginProcessor::getParameterTable(const std::string& key)
+{
+    auto& table = parameterTables[key];
+    const auto& parameters = myPlugin->getParameters();
+    if (table.parameters.size() != (size_t)parameters.size())
+    {
+        // New, or saved from another version of the plugin.
+        table.parameters.clear();
+        for (auto* parameter : parameters)
+        {
+            table.parameters.push_back(describeParameter(parameter));
+        }
+    }
+    return table;
+}
+
+void PluginProcessor::saveParameterCache(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(parameterTableMutex);
+    if (!PluginParameterTable::toXml(parameterTables)->writeTo(juce::File(path)))
+    {
+        throw std::runtime_error("Unable to write the parameter cache to: " + path);
+    }
+}
+
+void PluginProcessor::loadParameterCache(const std::string& path)
+{
+    auto xml = juce::parseXML(juce::File(path));
+    if (!xml || !xml->hasTagName("PARAMETER_TABLES"))
+    {
+        throw std::runtime_error("Unable to read a parameter cache from: " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(parameterTableMutex);
+    PluginParameterTable::fromXml(*xml, parameterTables);
+}
+
+void PluginProcessor::clearParameterCache()
+{
+    std::lock_guard<std::mutex> lock(parameterTableMutex);
+    parameterTables.clear();
 }
 
 nb::list PluginProcessorWrapper::getPluginParametersDescription()
@@ -1020,84 +1741,40 @@ nb::list PluginProcessorWrapper::getPluginParametersDescription()
 
     nb::list myList;
 
-    // get the parameters as an AudioProcessorParameter array
+    std::vector<PluginParameterTable::Parameter> parameters;
+    {
+        std::lock_guard<std::mutex> lock(parameterTableMutex);
+        parameters = getParameterTable(getParameterTableKey()).parameters;
+    }
+
+    // Only the texts of the current values come from the plugin.
     const Array<AudioProcessorParameter*>& processorParams = myPlugin->getParameters();
     for (int i = 0; i < processorParams.size(); i++)
     {
-        std::string theName =
-            (processorParams[i])->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+        auto& parameter = parameters[(size_t)i];
         std::string currentText =
             processorParams[i]
                 ->getText(processorParams[i]->getValue(), DAW_PARAMETER_MAX_NAME_LENGTH)
                 .toStdString();
-        std::string label = processorParams[i]->getLabel().toStdString();
-
-        std::string category;
-
-        switch (processorParams[i]->getCategory())
-        {
-        case AudioProcessorParameter::Category::genericParameter:
-            category = "genericParameter";
-            break;
-        case AudioProcessorParameter::Category::inputGain:
-            category = "inputGain";
-            break;
-        case AudioProcessorParameter::Category::outputGain:
-            category = "outputGain";
-            break;
-        case AudioProcessorParameter::Category::inputMeter:
-            category = "inputMeter";
-            break;
-        case AudioProcessorParameter::Category::outputMeter:
-            category = "outputMeter";
-            break;
-        case AudioProcessorParameter::Category::compressorLimiterGainReductionMeter:
-            category = "compressorLimiterGainReductionMeter";
-            break;
-        case AudioProcessorParameter::Category::expanderGateGainReductionMeter:
-            category = "expanderGateGainReductionMeter";
-            break;
-        case AudioProcessorParameter::Category::analysisMeter:
-            category = "analysisMeter";
-            break;
-        case AudioProcessorParameter::Category::otherMeter:
-            category = "otherMeter";
-            break;
-        default:
-            category = "unknown";
-            break;
-        }
 
         nb::dict myDictionary;
         myDictionary["index"] = i;
-        myDictionary["name"] = theName;
-        myDictionary["numSteps"] = processorParams[i]->getNumSteps();
-        myDictionary["isBoolean"] = processorParams[i]->isBoolean();
-        myDictionary["isDiscrete"] = processorParams[i]->isDiscrete();
-        myDictionary["label"] = label;
-        myDictionary["category"] = category;
+        myDictionary["name"] = parameter.name;
+        myDictionary["numSteps"] = parameter.numSteps;
+        myDictionary["isBoolean"] = parameter.isBoolean;
+        myDictionary["isDiscrete"] = parameter.isDiscrete;
+        myDictionary["label"] = parameter.label;
+        myDictionary["category"] = parameter.category;
 
         myDictionary["text"] = currentText;
         myDictionary["currentValText"] = processorParams[i]->getCurrentValueAsText().toStdString();
-        myDictionary["isMetaParameter"] = processorParams[i]->isMetaParameter();
-        myDictionary["isAutomatable"] = processorParams[i]->isAutomatable();
-        myDictionary["defaultValue"] = processorParams[i]->getDefaultValue();
-        myDictionary["defaultValueText"] =
-            processorParams[i]
-                ->getText(processorParams[i]->getDefaultValue(), DAW_PARAMETER_MAX_NAME_LENGTH)
-                .toStdString();
-        myDictionary["min"] =
-            processorParams[i]->getText(0.f, DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
-        myDictionary["max"] =
-            processorParams[i]->getText(1.f, DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
-
-        std::vector<std::string> valueStrings;
-        for (auto& valueString : processorParams[i]->getAllValueStrings())
-        {
-            valueStrings.push_back(valueString.toStdString());
-        }
-
-        myDictionary["valueStrings"] = valueStrings;
+        myDictionary["isMetaParameter"] = parameter.isMetaParameter;
+        myDictionary["isAutomatable"] = parameter.isAutomatable;
+        myDictionary["defaultValue"] = parameter.defaultValue;
+        myDictionary["defaultValueText"] = parameter.defaultValueText;
+        myDictionary["min"] = parameter.minText;
+        myDictionary["max"] = parameter.maxText;
+        myDictionary["valueStrings"] = parameter.valueStrings;
         myList.append(myDictionary);
     }
 
@@ -3,6 +3,7 @@
 #include "custom_nanobind_wrappers.h"
 #include "MidiSerialization.h"
 #include "PickleVersion.h"
+#include "PluginParameterTable.h"
 #include "ProcessorBase.h"
 
 typedef std::vector<std::pair<int, float>> PluginPatch;
@@ -13,8 +14,9 @@ using ValueType = std::variant<float, std::string>;
 class PluginProcessor : public ProcessorBase
 {
   public:
+    // An `isolated` plugin is hosted in a helper process (see IsolatedPlugin.h).
     PluginProcessor(std::string newUniqueName, double sampleRate, int samplesPerBlock,
-                    std::string path);
+                    std::string path, bool isolated = false);
     ~PluginProcessor();
 
     bool canApplyBusesLayout(const juce::AudioProcessor::BusesLayout& layout) override;
@@ -34,9 +36,19 @@ class PluginProcessor : public ProcessorBase
 
     void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) override;
 
+    bool canAutomateWithinBlock() override { return true; }
+
     bool acceptsMidi() const override { return myPlugin.get() && myPlugin->acceptsMidi(); }
     bool producesMidi() const override { return myPlugin.get() && myPlugin->producesMidi(); }
     double getTailLengthSeconds() const override;
+    // Only audio effects. Instruments and plugins that take MIDI may play on
+    // their own, e.g. with an arpeggiator or an internal sequencer.
+    bool isSilentWithoutInput() override
+    {
+        return myPlugin && !myPlugin->getPluginDescription().isInstrument &&
+               !myPlugin->acceptsMidi() && getTotalNumInputChannels() > 0;
+    }
+    bool hashConfiguration(ConfigurationHasher& hasher) override;
     int getLatencySamples();
 
     void reset() override;
@@ -51,8 +63,18 @@ class PluginProcessor : public ProcessorBase
     std::string getParameterAsText(const int parameter);
     const PluginPatch getPatch();
     const size_t getPluginParameterSize();
+    // Ranges are probed once per plugin and search steps, and then come from
+    // a table shared by every processor of the plugin (see
+    // PluginParameterTable.h).
     std::map<std::pair<float, float>, ValueType>
     getParameterValueRange(const int parameterIndex, int search_steps, bool convert);
+    // Probe the ranges of every parameter, on `numThreads` instances of the
+    // plugin at once (0 for one per core).
+    void cacheParameterRanges(int searchSteps, int numThreads);
+    static void saveParameterCache(const std::string& path);
+    // Add the tables saved in a file, replacing tables of the same plugins.
+    static void loadParameterCache(const std::string& path);
+    static void clearParameterCache();
 
     const juce::String getName() const override { return "PluginProcessor"; }
 
@@ -63,7 +85,14 @@ class PluginProcessor : public ProcessorBase
     int getNumMidiEvents();
 
     bool addMidiNote(const uint8 midiNote, const uint8 midiVelocity, const double noteStart,
-                     const double noteLength, bool isBeats);
+                     const double noteLength, bool isBeats) override;
+
+    juce::MidiBuffer* getMidiBufferSec() override { return &myMidiBufferSec; }
+    juce::MidiBuffer* getMidiBufferQN() override { return &myMidiBufferQN; }
+
+    // Also sets the hosted plugin's parameter, because automateParameters only
+    // pushes parameters that have more than one value of automation.
+    bool setAutomationValByIndex(int index, float val) override;
 
     void setPlayHead(AudioPlayHead* newPlayHead) override;
 
@@ -73,6 +102,39 @@ class PluginProcessor : public ProcessorBase
 
     void saveStateInformation(std::string filepath);
 
+    // Keep the plugin's state in memory and return a handle for restoreState.
+    // Snapshots are shared by every processor in the process, and identical
+    // states of the same plugin get the same handle.
+    int64_t snapshotState();
+    // Restore a snapshot of this plugin without reading files or opening the
+    // editor.
+    void restoreState(int64_t handle);
+    static void clearStateSnapshots();
+
+    // Give the hosted plugin the state and bus layout of `other`'s plugin,
+    // which must be the same plugin (see RenderEngine::clone).
+    void copyPluginStateFrom(PluginProcessor& other);
+
+    std::string getPluginPath() const { return myPluginPath; }
+
+    bool isIsolated() const { return myIsIsolated; }
+
+    // Set once when the package is imported: the command that starts the
+    // helper process of an isolated plugin, before the pipe's name.
+    static void setIsolatedHostCommand(const std::vector<std::string>& command);
+
+    // The helper process's side of an isolated plugin. Serves the requests
+    // sent through the named pipe until the connection is closed.
+    static void runIsolatedHost(const std::string& pipeName);
+
+    // Loading a plugin file scans it once per process and reuses the result
+    // until the file is modified. With a cache directory, the results are also
+    // saved there so that other processes can skip scanning.
+    static void setScanCacheDirectory(const std::string& path);
+    static std::string getScanCacheDirectory();
+    // Forget every scan, including the ones saved in the cache directory.
+    static void clearScanCache();
+
     void saveMIDI(std::string& savePath);
 
     nb::dict getPickleState()
@@ -82,6 +144,7 @@ class PluginProcessor : public ProcessorBase
         state["unique_name"] = getUniqueName();
         state["plugin_path"] = myPluginPath;
         state["sample_rate"] = mySampleRate;
+        state["isolated"] = myIsIsolated;
 
         // Get plugin state as binary blob
         if (myPlugin)
@@ -120,9 +183,10 @@ class PluginProcessor : public ProcessorBase
         std::string name = nb::cast<std::string>(state["unique_name"]);
         std::string plugin_path = nb::cast<std::string>(state["plugin_path"]);
         double sr = nb::cast<double>(state["sample_rate"]);
+        bool isolated = state.contains("isolated") && nb::cast<bool>(state["isolated"]);
 
         // Reconstruct using placement new
-        new (this) PluginProcessor(name, sr, 512, plugin_path);
+        new (this) PluginProcessor(name, sr, 512, plugin_path, isolated);
 
         // Restore plugin state
         if (state.contains("plugin_state") && myPlugin)
@@ -134,12 +198,7 @@ class PluginProcessor : public ProcessorBase
                                               (int)plugin_state_bytes.size());
 
                 // Update automation values from plugin parameters
-                int i = 0;
-                for (auto* parameter : myPlugin->getParameters())
-                {
-                    ProcessorBase::setAutomationValByIndex(i, parameter->getValue());
-                    i++;
-                }
+                syncAutomationWithPlugin();
             }
         }
 
@@ -169,12 +228,7 @@ class PluginProcessor : public ProcessorBase
                                               (int)plugin_state_bytes.size());
 
                 // Update automation values from plugin parameters
-                int i = 0;
-                for (auto* parameter : myPlugin->getParameters())
-                {
-                    ProcessorBase::setAutomationValByIndex(i, parameter->getValue());
-                    i++;
-                }
+                syncAutomationWithPlugin();
             }
         }
 
@@ -195,13 +249,37 @@ class PluginProcessor : public ProcessorBase
   private:
     bool loadPlugin(double sampleRate, int samplesPerBlock);
 
+    // Set the automation of every parameter to the hosted plugin's value.
+    void syncAutomationWithPlugin();
+
+  protected:
+    // Identifies the plugin, its version and its file in the parameter tables.
+    std::string getParameterTableKey();
+    // The table for `key`, described from this plugin unless it's already
+    // known. The caller must hold the tables' lock.
+    PluginParameterTable::Table& getParameterTable(const std::string& key);
+
+  private:
+    // Reports a position set by the host instead of the engine's.
+    struct FixedPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override { return position; }
+
+        PositionInfo position;
+    };
+
     std::string myPluginPath;
     double mySampleRate;
+    bool myIsIsolated = false;
 
     MidiBuffer myMidiBufferQN;
     MidiBuffer myMidiBufferSec;
 
     MidiBuffer myRenderMidiBuffer;
+    // The part of myRenderMidiBuffer in a sub-block, and the sub-block's
+    // position (see processWithAutomation).
+    MidiBuffer mySubBlockMidiBuffer;
+    FixedPlayHead mySubBlockPlayHead;
     MidiMessageSequence myRecordedMidiSequence; // for fetching by user later.
 
     MidiMessage myMidiMessageQN;
@@ -229,7 +307,7 @@ class PluginProcessorWrapper : public PluginProcessor
 {
   public:
     PluginProcessorWrapper(std::string newUniqueName, double sampleRate, int samplesPerBlock,
-                           std::string path);
+                           std::string path, bool isolated = false);
 
     void wrapperSetPatch(nb::list listOfTuples);
 
@@ -1,5 +1,124 @@
 #include "ProcessorBase.h"
 
+#include <map>
+
+MidiBufferCursor::MidiBufferCursor(const juce::MidiBuffer& buffer, int startPosition)
+    : m_iterator{buffer.findNextSamplePosition(startPosition)}, m_end{buffer.cend()},
+      m_startPosition{startPosition}
+{
+    // Keyed by channel and number, so that a later message replaces an earlier one.
+    std::map<int, juce::MidiMessage> programs;
+    std::map<int, juce::MidiMessage> controllers;
+    std::map<int, juce::MidiMessage> pitchWheels;
+    std::map<int, juce::MidiMessage> notes;
+
+    for (auto it = buffer.cbegin(); it != m_iterator; ++it)
+    {
+        const auto message = (*it).getMessage();
+        const int channel = message.getChannel();
+
+        if (message.isNoteOn())
+        {
+            notes[channel * 128 + message.getNoteNumber()] = message;
+        }
+        else if (message.isNoteOff())
+        {
+            notes.erase(channel * 128 + message.getNoteNumber());
+        }
+        else if (message.isAllNotesOff() || message.isAllSoundOff())
+        {
+            for (auto note = notes.begin(); note != notes.end();)
+            {
+                note = note->second.getChannel() == channel ? notes.erase(note) : std::next(note);
+            }
+        }
+        else if (message.isController())
+        {
+            controllers[channel * 128 + message.getControllerNumber()] = message;
+        }
+        else if (message.isProgramChange())
+        {
+            programs[channel] = message;
+        }
+        else if (message.isPitchWheel())
+        {
+            pitchWheels[channel] = message;
+        }
+    }
+
+    for (const auto* messages : {&programs, &controllers, &pitchWheels, &notes})
+    {
+        for (const auto& [key, message] : *messages)
+        {
+            m_chasedMessages.push_back(message);
+        }
+    }
+}
+
+void ConfigurationHasher::add(const void* data, size_t numBytes)
+{
+    // The round function of one lane of xxHash64, applied to each 8 bytes.
+    auto mix = [this](std::uint64_t word)
+    {
+        const std::uint64_t x = m_hash ^ (word * 0xC2B2AE3D27D4EB4Full);
+        m_hash = ((x << 31) | (x >> 33)) * 0x9E3779B185EBCA87ull;
+    };
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= numBytes; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        mix(word);
+    }
+
+    std::uint64_t last = 0;
+    std::memcpy(&last, bytes + i, numBytes - i);
+    mix(last);
+    mix(numBytes);
+}
+
+void ConfigurationHasher::add(const juce::AudioSampleBuffer& buffer)
+{
+    add(buffer.getNumChannels());
+    add(buffer.getNumSamples());
+    for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+    {
+        add(buffer.getReadPointer(chan), (size_t)buffer.getNumSamples() * sizeof(float));
+    }
+}
+
+void ConfigurationHasher::add(const juce::MidiBuffer& buffer)
+{
+    add(buffer.data.size());
+    add(buffer.data.begin(), (size_t)buffer.data.size());
+}
+
+bool ProcessorBase::getConfigurationHash(ConfigurationHasher& hasher)
+{
+    hasher.add(getName());
+    hasher.add(getTotalNumInputChannels());
+    hasher.add(getTotalNumOutputChannels());
+
+    // The value of a parameter that isn't automated is its only sample.
+    for (auto* parameter : getAutomationParameters())
+    {
+        hasher.add(parameter->getPPQN());
+        hasher.add(parameter->getAutomationValues());
+    }
+
+    for (auto* midiBuffer : {getMidiBufferSec(), getMidiBufferQN()})
+    {
+        if (midiBuffer)
+        {
+            hasher.add(*midiBuffer);
+        }
+    }
+
+    return hashConfiguration(hasher);
+}
+
 void ProcessorBase::numChannelsChanged()
 {
     m_isConnectedInGraph = false;
@@ -115,20 +234,53 @@ float ProcessorBase::getAutomationVal(const char* parameterName,
 float ProcessorBase::getAutomationVal(const std::string& parameterName,
                                       AudioPlayHead::PositionInfo& posInfo)
 {
-    for (auto& uncastedParameter : this->getParameters())
+    const auto& parameters = getAutomationParameters();
+
+    auto it = m_automationParameterIndex.find(parameterName);
+    if (it != m_automationParameterIndex.end())
     {
-        if (uncastedParameter->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString() ==
-            parameterName)
+        return parameters[(size_t)it->second]->sample(posInfo);
+    }
+
+    throw std::runtime_error("Failed to get automation value for parameter: " + parameterName);
+}
+
+void ProcessorBase::cacheAutomationParameters()
+{
+    const Array<AudioProcessorParameter*>& processorParams = this->getParameters();
+
+    m_automationParameters.clear();
+    m_automationRecordTargets.clear();
+    m_automationParameterIndex.clear();
+
+    m_automationParameters.reserve((size_t)processorParams.size());
+    m_automationRecordTargets.reserve((size_t)processorParams.size());
+
+    for (int i = 0; i < processorParams.size(); i++)
+    {
+        // todo: why do we have to cast to AutomateParameterFloat instead of
+        // AutomateParameter
+        m_automationParameters.push_back(static_cast<AutomateParameterFloat*>(processorParams[i]));
+
+        // Note that we don't use label because it's sometimes blank. The same
+        // choice must be made in reset()
+        std::string name = processorParams[i]->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+
+        if (name.empty())
         {
-            auto parameter = static_cast<AutomateParameterFloat*>(
-                uncastedParameter); // todo: why do we have to cast to
-                                    // AutomateParameterFloat instead of
-                                    // AutomateParameter
-            return parameter->sample(posInfo);
+            m_automationRecordTargets.push_back(nullptr);
+            continue;
         }
+
+        // Like a linear search, the first parameter with a name wins.
+        m_automationParameterIndex.emplace(name, i);
+
+        auto it = m_recordedAutomationDict.find(name);
+        m_automationRecordTargets.push_back(it == m_recordedAutomationDict.end() ? nullptr
+                                                                                 : &it->second);
     }
 
-    throw std::runtime_error("Failed to get automation value for parameter: " + parameterName);
+    m_isAutomationCacheValid = true;
 }
 
 float ProcessorBase::getAutomationAtZeroByIndex(const int& index) const
@@ -195,35 +347,163 @@ nb::dict ProcessorBase::getAutomationAll()
     return outDict;
 }
 
-void ProcessorBase::recordAutomation(AudioPlayHead::PositionInfo& posInfo, int numSamples)
+int ProcessorBase::getAutomationSubBlock(AudioPlayHead::PositionInfo& posInfo, int maxSamples)
 {
-    if (m_recordAutomation)
+    if (!canAutomateWithinBlock())
     {
-        const Array<AudioProcessorParameter*>& processorParams = this->getParameters();
+        return maxSamples;
+    }
 
-        int j = 0;
+    int numSamples = maxSamples;
+    bool isAutomated = false;
+    for (auto* parameter : getAutomationParameters())
+    {
+        if (parameter->isAutomated())
+        {
+            isAutomated = true;
+            numSamples = parameter->getSamplesUntilChange(posInfo, numSamples, getTempoMap(),
+                                                          getSampleRate());
+        }
+    }
 
-        for (int i = 0; i < processorParams.size(); i++)
+    if (isAutomated && m_automationBlockSize > 0)
+    {
+        numSamples = std::min(numSamples, m_automationBlockSize);
+    }
+    return numSamples;
+}
+
+AudioPlayHead::PositionInfo
+ProcessorBase::offsetPosition(const AudioPlayHead::PositionInfo& posInfo, int numSamples)
+{
+    auto result = posInfo;
+
+    const double sampleRate = getSampleRate();
+    const int64_t timeInSamples = posInfo.getTimeInSamples().orFallback(0) + numSamples;
+    result.setTimeInSamples(timeInSamples);
+    result.setTimeInSeconds(double(timeInSamples) / sampleRate);
+
+    if (posInfo.getPpqPosition())
+    {
+        const auto& tempoMap = getTempoMap();
+        const double ppqPosition = tempoMap.getBeatAtSample(double(timeInSamples), sampleRate);
+        result.setPpqPosition(ppqPosition);
+        result.setBpm(tempoMap.getBpmAtBeat(ppqPosition));
+    }
+
+    return result;
+}
+
+void ProcessorBase::copySettingsFrom(ProcessorBase& other)
+{
+    const auto& parameters = getAutomationParameters();
+    const auto& otherParameters = other.getAutomationParameters();
+    for (size_t i = 0; i < std::min(parameters.size(), otherParameters.size()); i++)
+    {
+        parameters[i]->shareAutomation(*otherParameters[i]);
+    }
+
+    if (getMidiBufferSec() && other.getMidiBufferSec())
+    {
+        *getMidiBufferSec() = *other.getMidiBufferSec();
+        *getMidiBufferQN() = *other.getMidiBufferQN();
+    }
+
+    m_recordEnable = other.m_recordEnable;
+    m_recordAutomation = other.m_recordAutomation;
+}
+
+const TempoMap& ProcessorBase::getTempoMap() const
+{
+    static const TempoMap defaultTempoMap;
+    return m_tempoMap ? *m_tempoMap : defaultTempoMap;
+}
+
+int64_t ProcessorBase::getSampleAtPulse(double pulse) const
+{
+    return std::llround(getTempoMap().getSampleAtBeat(pulse / PPQN, getSampleRate()));
+}
+
+int ProcessorBase::getSamplesUntilNextEvent(AudioPlayHead::PositionInfo& posInfo, int maxSamples)
+{
+    int numSamples = maxSamples;
+
+    // With an automation block size, the processor already follows its
+    // automation within the block (see getAutomationSubBlock).
+    const bool automatesWithinBlock = m_automationBlockSize > 0 && canAutomateWithinBlock();
+    for (auto* parameter : getAutomationParameters())
+    {
+        if (!automatesWithinBlock && parameter->isAutomated())
         {
-            auto theParameter = static_cast<AutomateParameterFloat*>(processorParams[i]);
+            numSamples = parameter->getSamplesUntilChange(posInfo, numSamples, getTempoMap(),
+                                                          getSampleRate());
+        }
+    }
 
-            // Note that we don't use label because it's sometimes blank. The same
-            // choice must be made in reset()
-            std::string name =
-                (processorParams[i])->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
+    const int64_t time = *posInfo.getTimeInSamples();
+    if (auto* midiBuffer = getMidiBufferSec())
+    {
+        auto it = midiBuffer->findNextSamplePosition((int)time + 1);
+        if (it != midiBuffer->cend())
+        {
+            numSamples = (int)std::min<int64_t>(numSamples, (*it).samplePosition - time);
+        }
+    }
 
-            if (name.compare("") == 0)
+    if (auto* midiBuffer = getMidiBufferQN())
+    {
+        const int pulseStart = (int)std::floor(*posInfo.getPpqPosition() * PPQN);
+        for (auto it = midiBuffer->findNextSamplePosition(pulseStart); it != midiBuffer->cend();
+             ++it)
+        {
+            const int64_t samples = getSampleAtPulse((*it).samplePosition) - time;
+            if (samples >= numSamples)
             {
-                continue;
+                break;
             }
+            if (samples >= 1)
+            {
+                numSamples = (int)samples;
+                break;
+            }
+        }
+    }
+
+    return numSamples;
+}
+
+void ProcessorBase::recordAutomation(AudioPlayHead::PositionInfo& posInfo, int numSamples)
+{
+    if (m_recordAutomation)
+    {
+        const auto& parameters = getAutomationParameters();
 
-            float val = theParameter->sample(posInfo);
-            j = (int)(*posInfo.getTimeInSamples());
-            int jMax = std::min(j + numSamples, m_recordedAutomationDict[name].getNumSamples());
-            float* writePtr = m_recordedAutomationDict[name].getWritePointer(0, j);
-            for (; j < jMax; j++)
+        // Record the values the processor actually uses, one per sub-block
+        // (see processWithAutomation).
+        for (int offset = 0, length = 0; offset < numSamples; offset += length)
+        {
+            auto subBlockPosInfo = offset > 0 ? offsetPosition(posInfo, offset) : posInfo;
+
+            const int64_t start =
+                *subBlockPosInfo.getTimeInSamples() - m_expectedRecordStartSample;
+            length = getAutomationSubBlock(subBlockPosInfo, numSamples - offset);
+
+            for (size_t i = 0; i < parameters.size(); i++)
             {
-                *writePtr++ = val;
+                juce::AudioSampleBuffer* target = m_automationRecordTargets[i];
+                if (!target)
+                {
+                    continue;
+                }
+
+                float val = parameters[i]->sample(subBlockPosInfo);
+                const int jMin = (int)std::max<int64_t>(start, 0);
+                const int jMax = (int)std::min<int64_t>(start + length, target->getNumSamples());
+                if (jMin < jMax)
+                {
+                    juce::FloatVectorOperations::fill(target->getWritePointer(0, jMin), val,
+                                                      jMax - jMin);
+                }
             }
         }
     }
@@ -237,7 +517,7 @@ void ProcessorBase::reset()
     for (juce::AudioProcessorParameter* parameter : this->getParameters())
     {
         // Note that we don't use label because it's sometimes blank. The same
-        // choice must be made in recordAutomation()
+        // choice must be made in cacheAutomationParameters()
         std::string name = parameter->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString();
         if (name.empty())
         {
@@ -253,6 +533,9 @@ void ProcessorBase::reset()
         m_recordedAutomationDict[name] = buffer;
         i++;
     }
+
+    // The recorded automation buffers were just replaced.
+    cacheAutomationParameters();
 }
 
 void ProcessorBase::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuffer&)
@@ -269,14 +552,26 @@ void ProcessorBase::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuff
     }
 
     const int numberChannels = myRecordBuffer.getNumChannels();
-    int numSamplesToCopy = std::min(buffer.getNumSamples(), myRecordBuffer.getNumSamples() -
-                                                                int(*posInfo->getTimeInSamples()));
-    int writePos = int(*posInfo->getTimeInSamples());
+    int64_t writePos = *posInfo->getTimeInSamples() - myRecordStartSample;
+    int readPos = 0;
+    if (writePos < 0)
+    {
+        // The block starts before the record window.
+        readPos = (int)-writePos;
+        writePos = 0;
+    }
+    const int64_t numSamplesToCopy = std::min<int64_t>(buffer.getNumSamples() - readPos,
+                                                       myRecordBuffer.getNumSamples() - writePos);
+    if (numSamplesToCopy <= 0)
+    {
+        return;
+    }
 
     for (int chan = 0; chan < numberChannels; chan++)
     {
         // Write the sample to the engine's history for the correct channel.
-        myRecordBuffer.copyFrom(chan, writePos, buffer.getReadPointer(chan), numSamplesToCopy);
+        myRecordBuffer.copyFrom(chan, (int)writePos, buffer.getReadPointer(chan, readPos),
+                                (int)numSamplesToCopy);
     }
 }
 
@@ -288,16 +583,10 @@ nb::ndarray<nb::numpy, float> ProcessorBase::bufferToPyArray(juce::AudioSampleBu
     size_t shape[2] = {num_channels, num_samples};
     float* array_data = new float[num_channels * num_samples];
 
-    auto chans = buffer.getArrayOfReadPointers();
     for (size_t i = 0; i < num_channels; i++)
     {
-        auto chanPtr = chans[i];
-        float* row = array_data + (i * num_samples);
-
-        for (size_t j = 0; j < num_samples; j++)
-        {
-            row[j] = *(chanPtr++);
-        }
+        std::memcpy(array_data + (i * num_samples), buffer.getReadPointer((int)i),
+                    num_samples * sizeof(float));
     }
 
     auto capsule =
@@ -306,16 +595,249 @@ nb::ndarray<nb::numpy, float> ProcessorBase::bufferToPyArray(juce::AudioSampleBu
     return nb::ndarray<nb::numpy, float>(array_data, 2, shape, capsule);
 }
 
-nb::ndarray<nb::numpy, float> ProcessorBase::getAudioFrames()
+nb::object ProcessorBase::getAudioFrames()
+{
+    size_t shape[2] = {(size_t)myRecordBuffer.getNumChannels(),
+                       (size_t)myRecordBuffer.getNumSamples()};
+
+    if (!myRecordData || shape[0] * shape[1] == 0)
+    {
+        return nb::ndarray<nb::numpy, float>(nullptr, 2, shape).cast();
+    }
+
+    // The capsule holds its own reference to the storage, so the array stays
+    // valid after the processor records again or is deleted.
+    auto* owner = new std::shared_ptr<float[]>(myRecordData);
+    auto capsule = nb::capsule(owner, [](void* p) noexcept
+                               { delete static_cast<std::shared_ptr<float[]>*>(p); });
+
+    if (myRecordReadOnly)
+    {
+        // The storage is a read-only mapping of a render cache file, so
+        // writing to a writable array would crash.
+        const float* data = myRecordData.get();
+        return nb::ndarray<nb::numpy, const float>(data, 2, shape, capsule).cast();
+    }
+
+    return nb::ndarray<nb::numpy, float>(myRecordData.get(), 2, shape, capsule).cast();
+}
+
+nb::object ProcessorBase::detachAudioFrames()
 {
-    return bufferToPyArray(myRecordBuffer);
+    auto audio = getAudioFrames();
+
+    myRecordData.reset();
+    myRecordCapacity = 0;
+    myRecordReadOnly = false;
+    myRecordBuffer.setSize(myRecordBuffer.getNumChannels(), 0);
+
+    return audio;
+}
+
+void ProcessorBase::setExternalRecordTarget(float* data, int numChannels, int stride)
+{
+    myExternalRecordData = data;
+    myExternalRecordNumChannels = data ? numChannels : 0;
+    myExternalRecordStride = data ? stride : 0;
+
+    if (!data)
+    {
+        // Don't leave the record buffer pointing at memory we don't own.
+        myRecordBuffer.setSize(myRecordBuffer.getNumChannels(), 0);
+    }
 }
 
-void ProcessorBase::setRecorderLength(int numSamples)
+void ProcessorBase::setRecorderLength(int numSamples, int64_t startSample)
 {
     m_expectedRecordNumSamples = numSamples;
+    m_expectedRecordStartSample = startSample;
+    setRecordWindow(startSample, numSamples);
+}
+
+void ProcessorBase::moveRecordWindow(int64_t newStartSample)
+{
+    const int numChannels = myRecordBuffer.getNumChannels();
+    const int numSamples = myRecordBuffer.getNumSamples();
+    const int shift = (int)std::min<int64_t>(newStartSample - myRecordStartSample, numSamples);
+    const int numKept = numSamples - shift;
+
+    if (myRecordData && (myRecordReadOnly || myRecordData.use_count() > 1))
+    {
+        // An array from getAudioFrames refers to the storage, or it's a
+        // read-only file from loadRecording, so move into new storage instead
+        // of modifying it.
+        juce::AudioSampleBuffer kept(numChannels, numKept);
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            kept.copyFrom(chan, 0, myRecordBuffer, chan, shift, numKept);
+        }
+        setRecordWindow(newStartSample, numSamples);
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            myRecordBuffer.copyFrom(chan, 0, kept, chan, 0, numKept);
+        }
+        return;
+    }
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        float* data = myRecordBuffer.getWritePointer(chan);
+        std::memmove(data, data + shift, numKept * sizeof(float));
+        juce::FloatVectorOperations::clear(data + numKept, shift);
+    }
 
-    int numChannels = this->getTotalNumOutputChannels();
+    myRecordStartSample = newStartSample;
+}
+
+void ProcessorBase::loadRecording(std::shared_ptr<const void> owner, const float* data)
+{
+    const int numChannels = myRecordBuffer.getNumChannels();
+    const int numSamples = myRecordBuffer.getNumSamples();
+
+    // Share ownership of `owner` so that arrays from getAudioFrames keep the
+    // data alive. Nothing writes through the pointer while myRecordReadOnly is
+    // set, and the next setRecordWindow replaces it with storage of our own.
+    myRecordData = std::shared_ptr<float[]>(std::move(owner), const_cast<float*>(data));
+    myRecordCapacity = 0;
+    myRecordReadOnly = true;
+
+    std::vector<float*> channels((size_t)numChannels);
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        channels[(size_t)chan] = myRecordData.get() + (size_t)chan * (size_t)numSamples;
+    }
+
+    myRecordBuffer.setDataToReferTo(channels.data(), numChannels, numSamples);
+}
+
+void ProcessorBase::trimRecording(int numSamples)
+{
+    for (auto& [name, buffer] : m_recordedAutomationDict)
+    {
+        if (buffer.getNumSamples() > numSamples)
+        {
+            buffer.setSize(buffer.getNumChannels(), numSamples, true, false, true);
+        }
+    }
+
+    const int numChannels = myRecordBuffer.getNumChannels();
+    const int oldNumSamples = myRecordBuffer.getNumSamples();
+    if (numSamples >= oldNumSamples)
+    {
+        return;
+    }
+
+    std::vector<float*> channels((size_t)numChannels);
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        channels[(size_t)chan] = myRecordBuffer.getWritePointer(chan);
+    }
+
+    if (myRecordReadOnly)
+    {
+        // The data is a read-only file from loadRecording, so copy the start
+        // of each channel into storage of our own instead of moving it.
+        const size_t totalSamples = (size_t)numChannels * (size_t)numSamples;
+        auto trimmed = std::shared_ptr<float[]>(new float[totalSamples]);
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* destination = trimmed.get() + (size_t)chan * (size_t)numSamples;
+            std::memcpy(destination, channels[(size_t)chan], (size_t)numSamples * sizeof(float));
+            channels[(size_t)chan] = destination;
+        }
+        myRecordData = std::move(trimmed);
+        myRecordCapacity = totalSamples;
+        myRecordReadOnly = false;
+    }
+    else if (!myExternalRecordData && myRecordData)
+    {
+        // getAudioFrames expects the channels to be back to back, so move
+        // them together. Each channel moves towards the start of the storage,
+        // so going in order never overwrites a channel that hasn't moved yet.
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* destination = myRecordData.get() + (size_t)chan * (size_t)numSamples;
+            std::memmove(destination, channels[(size_t)chan], (size_t)numSamples * sizeof(float));
+            channels[(size_t)chan] = destination;
+        }
+    }
+
+    myRecordBuffer.setDataToReferTo(channels.data(), numChannels, numSamples);
+}
+
+void ProcessorBase::setRecordWindow(int64_t startSample, int numSamples)
+{
+    myRecordStartSample = startSample;
+
+    const int numChannels = this->getTotalNumOutputChannels();
+    const int numRecordSamples = m_recordEnable ? std::max(numSamples, 0) : 0;
+    const size_t totalSamples = (size_t)numChannels * (size_t)numRecordSamples;
+
+    if (myExternalRecordData)
+    {
+        if (myExternalRecordNumChannels != numChannels)
+        {
+            throw std::runtime_error(
+                "The output array has " + std::to_string(myExternalRecordNumChannels) +
+                " channels, but processor " + getUniqueName() + " produces " +
+                std::to_string(numChannels) + ".");
+        }
+        if (myExternalRecordStride < numRecordSamples)
+        {
+            throw std::runtime_error("The output array has room for " +
+                                     std::to_string(myExternalRecordStride) +
+                                     " samples, but the render needs " +
+                                     std::to_string(numRecordSamples) + ".");
+        }
+
+        std::vector<float*> channels((size_t)numChannels);
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            channels[(size_t)chan] =
+                myExternalRecordData + (size_t)chan * (size_t)myExternalRecordStride;
+        }
+
+        if (myRecordReadOnly)
+        {
+            // Don't keep a render cache file mapped for a recording that's
+            // been replaced.
+            myRecordData.reset();
+            myRecordReadOnly = false;
+        }
+
+        myRecordBuffer.setDataToReferTo(channels.data(), numChannels, numRecordSamples);
+        myRecordBuffer.clear();
+        return;
+    }
+
+    if (totalSamples == 0)
+    {
+        // Let go of the storage from an earlier render, so that processors
+        // that aren't recording don't keep full-length buffers alive. Arrays
+        // from getAudioFrames keep their own reference.
+        myRecordBuffer.setSize(numChannels, 0);
+        myRecordData.reset();
+        myRecordCapacity = 0;
+        myRecordReadOnly = false;
+        return;
+    }
+
+    // Reuse the storage unless it's too small, read-only, or a numpy array
+    // from getAudioFrames still refers to it.
+    if (!myRecordData || myRecordReadOnly || myRecordData.use_count() > 1 ||
+        myRecordCapacity < totalSamples)
+    {
+        myRecordData = std::shared_ptr<float[]>(new float[totalSamples]);
+        myRecordCapacity = totalSamples;
+        myRecordReadOnly = false;
+    }
+
+    std::vector<float*> channels((size_t)numChannels);
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        channels[(size_t)chan] = myRecordData.get() + (size_t)chan * (size_t)numRecordSamples;
+    }
 
-    myRecordBuffer.setSize(numChannels, m_recordEnable ? numSamples : 0);
+    myRecordBuffer.setDataToReferTo(channels.data(), numChannels, numRecordSamples);
+    myRecordBuffer.clear();
 }
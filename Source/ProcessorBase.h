@@ -4,6 +4,9 @@
 #include "custom_nanobind_wrappers.h"
 #include "CustomParameters.h"
 
+#include <type_traits>
+#include <unordered_map>
+
 const int DAW_PARAMETER_MAX_NAME_LENGTH = 512;
 
 // Throw with a clear message unless the array is 2D shaped (channels, samples).
@@ -32,10 +35,21 @@ class MidiBufferCursor
     {
     }
 
+    // Start at `startPosition` as if the messages before it had been played:
+    // the notes still held there and the latest program, controller and pitch
+    // wheel values are returned first, positioned at `startPosition`.
+    MidiBufferCursor(const juce::MidiBuffer& buffer, int startPosition);
+
     // Copy the next message and its sample position into the output arguments
     // and advance. Return false if no messages remain.
     bool getNextEvent(juce::MidiMessage& result, int& samplePosition)
     {
+        if (m_nextChasedMessage < m_chasedMessages.size())
+        {
+            result = m_chasedMessages[m_nextChasedMessage++];
+            samplePosition = m_startPosition;
+            return true;
+        }
         if (m_iterator == m_end)
         {
             return false;
@@ -50,6 +64,47 @@ class MidiBufferCursor
   private:
     juce::MidiBufferIterator m_iterator;
     juce::MidiBufferIterator m_end;
+    std::vector<juce::MidiMessage> m_chasedMessages;
+    size_t m_nextChasedMessage = 0;
+    int m_startPosition = 0;
+};
+
+// Accumulates a 64-bit hash of everything that determines a processor's
+// output (see ProcessorBase::hashConfiguration). It's fast enough to hash
+// whole audio buffers on every render, but it isn't cryptographic.
+class ConfigurationHasher
+{
+  public:
+    void add(const void* data, size_t numBytes);
+
+    template <typename T,
+              typename = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+    void add(T value)
+    {
+        add(&value, sizeof(T));
+    }
+
+    void add(const std::string& value)
+    {
+        add(value.size());
+        add(value.data(), value.size());
+    }
+
+    void add(const juce::String& value) { add(value.toStdString()); }
+
+    void add(const std::vector<float>& values)
+    {
+        add(values.size());
+        add(values.data(), values.size() * sizeof(float));
+    }
+
+    void add(const juce::AudioSampleBuffer& buffer);
+    void add(const juce::MidiBuffer& buffer);
+
+    std::uint64_t getHash() const { return m_hash; }
+
+  private:
+    std::uint64_t m_hash = 0x9E3779B97F4A7C15ull;
 };
 
 class ProcessorBase : public juce::AudioProcessor
@@ -91,6 +146,26 @@ class ProcessorBase : public juce::AudioProcessor
     bool producesMidi() const override { return false; }
     double getTailLengthSeconds() const override { return 0; }
 
+    // Whether the processor is silent when its inputs are silent and it has no
+    // MIDI to play, once getTailLengthSeconds() has passed since it last had
+    // either. RenderEngine's silence skipping only skips processors that
+    // return true. Processors that make sound on their own, such as
+    // PlaybackProcessor, keep the default.
+    virtual bool isSilentWithoutInput() { return false; }
+
+    // Add everything besides the inputs that determines the output to
+    // `hasher`: the bus layout, the parameters and their automation, the MIDI
+    // and the settings added by hashConfiguration. Return false if the
+    // processor doesn't support it.
+    bool getConfigurationHash(ConfigurationHasher& hasher);
+
+    // Subclasses whose output only depends on their inputs, parameters, MIDI
+    // and settings add those settings to `hasher` and return true. The output
+    // must be the same every time the processor renders from a reset.
+    // RenderEngine only reuses the outputs of processors that return true (see
+    // RenderEngine::setNodeCacheSize).
+    virtual bool hashConfiguration(ConfigurationHasher&) { return false; }
+
     //==============================================================================
     virtual bool canApplyBusesLayout(const juce::AudioProcessor::BusesLayout& layout)
     {
@@ -138,6 +213,30 @@ class ProcessorBase : public juce::AudioProcessor
     virtual void automateParameters(AudioPlayHead::PositionInfo& posInfo, int numSamples) {};
     void recordAutomation(AudioPlayHead::PositionInfo& posInfo, int numSamples);
 
+    // Also apply automation every `numSamples` samples inside a block, not only
+    // where it steps. 0 (the default) means only at steps. It only has an
+    // effect on processors that can split their blocks (see
+    // processWithAutomation).
+    void setAutomationBlockSize(int numSamples) { m_automationBlockSize = numSamples; }
+    int getAutomationBlockSize() const { return m_automationBlockSize; }
+
+    // Processors that call processWithAutomation in processBlock override this.
+    virtual bool canAutomateWithinBlock() { return false; }
+
+    // The number of samples, at most `maxSamples`, from `posInfo` until the
+    // next change of an automated parameter or the next MIDI event after the
+    // first sample (see RenderEngine::setAdaptiveBlocks).
+    int getSamplesUntilNextEvent(AudioPlayHead::PositionInfo& posInfo, int maxSamples);
+
+    // The engine's tempo, which converts MIDI and automation positions in
+    // beats to samples. RenderEngine sets it before each render.
+    void setTempoMap(const TempoMap* tempoMap) { m_tempoMap = tempoMap; }
+    const TempoMap& getTempoMap() const;
+
+    // The sample of the render at which a MIDI event at `pulse` (in PPQN
+    // pulses) plays.
+    int64_t getSampleAtPulse(double pulse) const;
+
     void setRecordEnable(bool recordEnable) { m_recordEnable = recordEnable; }
     bool getRecordEnable() const { return m_recordEnable; }
 
@@ -146,9 +245,72 @@ class ProcessorBase : public juce::AudioProcessor
 
     nb::ndarray<nb::numpy, float> bufferToPyArray(juce::AudioSampleBuffer& buffer);
 
-    nb::ndarray<nb::numpy, float> getAudioFrames();
+    // Returns a (channels, samples) view of the recorded audio without copying.
+    // The view keeps the storage alive, and the next render records into fresh
+    // storage while any view is still referenced, so the view never changes.
+    // A recording loaded from the render cache is a read-only view of the file.
+    nb::object getAudioFrames();
+
+    // Like getAudioFrames, but the processor gives up the storage, so the next
+    // render always allocates a new buffer.
+    nb::object detachAudioFrames();
 
-    void setRecorderLength(int numSamples);
+    // Record `numSamples` samples of audio and automation, starting at
+    // `startSample` of the render.
+    void setRecorderLength(int numSamples, int64_t startSample = 0);
+
+    // Where the render starts. Processors that play MIDI start their cursors
+    // there in reset(), so a render can begin partway through the MIDI.
+    void setRenderStart(int64_t startSample, double startPpqPosition)
+    {
+        m_renderStartSample = startSample;
+        m_renderStartPulse = (int64_t)std::floor(startPpqPosition * PPQN);
+    }
+    int getRenderStartSample() const { return (int)m_renderStartSample; }
+    int getRenderStartPulse() const { return (int)m_renderStartPulse; }
+
+    // Record only `numSamples` samples starting at `startSample` of the render,
+    // instead of the whole render. Samples outside the window are dropped.
+    void setRecordWindow(int64_t startSample, int numSamples);
+
+    // Slide the record window forward to `newStartSample`, keeping the samples
+    // already recorded past that point (see RenderStream).
+    void moveRecordWindow(int64_t newStartSample);
+
+    // Shorten the recording and the recorded automation to their first
+    // `numSamples` samples (see RenderEngine::renderTail).
+    void trimRecording(int numSamples);
+
+    // Use audio from an earlier render as the recording instead of processing
+    // (see RenderCache). `data` holds each channel of the recording one after
+    // the other. It's read-only and stays valid as long as `owner` is alive, so
+    // the recording refers to it until the next render instead of copying it.
+    void loadRecording(std::shared_ptr<const void> owner, const float* data);
+
+    // Record into caller-owned memory laid out as (channels, stride) instead of
+    // the processor's own storage (see RenderEngine::renderInto). Pass nullptr
+    // to go back to normal; the recording is then empty until the next render.
+    void setExternalRecordTarget(float* data, int numChannels, int stride);
+
+    const juce::AudioSampleBuffer& getRecordBuffer() const { return myRecordBuffer; }
+
+    // Processors that play MIDI notes override these so that RenderEngine can
+    // swap their notes in and out between renders (see render_batch).
+    virtual juce::MidiBuffer* getMidiBufferSec() { return nullptr; }
+    virtual juce::MidiBuffer* getMidiBufferQN() { return nullptr; }
+
+    // Copy the settings that all processors have from `other`, a processor of
+    // the same kind with the same parameters (see RenderEngine::clone):
+    // parameter values and automation, MIDI notes and whether to record. The
+    // automation values are shared rather than copied.
+    void copySettingsFrom(ProcessorBase& other);
+
+    virtual bool addMidiNote(const uint8 midiNote, const uint8 midiVelocity,
+                             const double noteStart, const double noteLength, bool isBeats)
+    {
+        throw std::runtime_error("Processor named " + getUniqueName() +
+                                 " doesn't accept MIDI notes.");
+    }
 
     virtual int getTotalNumOutputChannels() { return AudioProcessor::getTotalNumOutputChannels(); }
 
@@ -159,6 +321,11 @@ class ProcessorBase : public juce::AudioProcessor
     bool isConnectedInGraph() const { return m_isConnectedInGraph; }
     void setConnectedInGraph(bool isConnected) { m_isConnectedInGraph = isConnected; }
 
+    // Whether RenderEngine::connectGraph has to call prepareToPlay before wiring
+    // this processor. Once a processor has been connected, it only needs it
+    // again if its channel layout changed, unless it overrides this.
+    virtual bool needsPrepareToPlay() { return !m_isConnectedInGraph; }
+
     bool setMainBusInputsAndOutputs(int inputs, int outputs)
     {
         BusesLayout busesLayout = makeBusesLayout(inputs, outputs);
@@ -198,9 +365,30 @@ class ProcessorBase : public juce::AudioProcessor
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorBase)
     std::string myUniqueName;
+
+    // myRecordBuffer refers to one contiguous (channels x samples) block in
+    // myRecordData, which is shared with the numpy arrays from getAudioFrames.
     juce::AudioSampleBuffer myRecordBuffer;
+    std::shared_ptr<float[]> myRecordData;
+    size_t myRecordCapacity = 0;
+    // Whether myRecordData is read-only memory from loadRecording.
+    bool myRecordReadOnly = false;
+
+    int64_t myRecordStartSample = 0;
+
+    float* myExternalRecordData = nullptr;
+    int myExternalRecordNumChannels = 0;
+    int myExternalRecordStride = 0;
     bool m_isConnectedInGraph = false;
 
+    void cacheAutomationParameters();
+
+    bool m_isAutomationCacheValid = false;
+    std::vector<AutomateParameterFloat*> m_automationParameters;
+    // Where recordAutomation writes each parameter, or nullptr for unnamed ones.
+    std::vector<juce::AudioSampleBuffer*> m_automationRecordTargets;
+    std::unordered_map<std::string, int> m_automationParameterIndex;
+
   protected:
     juce::AudioProcessorValueTreeState::ParameterLayout createEmptyParameterLayout()
     {
@@ -211,8 +399,70 @@ class ProcessorBase : public juce::AudioProcessor
     bool m_recordAutomation = false;
 
     int m_expectedRecordNumSamples = 0;
+    int64_t m_expectedRecordStartSample = 0;
+    int64_t m_renderStartSample = 0;
+    const TempoMap* m_tempoMap = nullptr;
+    int64_t m_renderStartPulse = 0;
+    int m_automationBlockSize = 0;
     std::map<std::string, juce::AudioSampleBuffer> m_recordedAutomationDict;
 
+    // Every parameter, in the order of getParameters(), resolved once instead of
+    // on every block. The cache is rebuilt by reset() and dropped whenever the
+    // parameter tree is replaced.
+    const std::vector<AutomateParameterFloat*>& getAutomationParameters()
+    {
+        if (!m_isAutomationCacheValid)
+        {
+            cacheAutomationParameters();
+        }
+        return m_automationParameters;
+    }
+
+    // The length of the sub-block at `posInfo`, at most `maxSamples`, for
+    // processors that can split their blocks: until the next step of an
+    // automated parameter (see AutomateParameter::getSamplesUntilChange), and
+    // at most the automation block size if one is set. Without automation,
+    // or automation that doesn't step, it's the whole block.
+    int getAutomationSubBlock(AudioPlayHead::PositionInfo& posInfo, int maxSamples);
+
+    // `posInfo` moved forward by `numSamples` samples along the tempo map.
+    AudioPlayHead::PositionInfo offsetPosition(const AudioPlayHead::PositionInfo& posInfo,
+                                               int numSamples);
+
+    // Call `process(startSample, numSamples)` for consecutive sub-blocks of a
+    // block, applying automation at the start of each one. RenderEngine has
+    // already applied it at the start of the block.
+    template <typename Process> void processWithAutomation(int numSamples, Process&& process)
+    {
+        if (!canAutomateWithinBlock() || !getPlayHead())
+        {
+            process(0, numSamples);
+            return;
+        }
+
+        const auto posInfo = *getPlayHead()->getPosition();
+
+        for (int start = 0; start < numSamples;)
+        {
+            auto subBlockPosInfo = start > 0 ? offsetPosition(posInfo, start) : posInfo;
+            const int length = getAutomationSubBlock(subBlockPosInfo, numSamples - start);
+            if (start > 0)
+            {
+                automateParameters(subBlockPosInfo, length);
+            }
+            process(start, length);
+            start += length;
+        }
+    }
+
+    // This hides AudioProcessor::setParameterTree so that subclasses which call
+    // it can't leave stale pointers in the automation cache.
+    void setParameterTree(juce::AudioProcessorParameterGroup&& newTree)
+    {
+        m_isAutomationCacheValid = false;
+        AudioProcessor::setParameterTree(std::move(newTree));
+    }
+
     BusesLayout makeBusesLayout(int inputs, int outputs)
     {
         BusesLayout busesLayout;
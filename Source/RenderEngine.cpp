@@ -1,6 +1,10 @@
 #include "RenderEngine.h"
 
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <set>
+#include <thread>
 #include <unordered_map>
 
 RenderEngine::RenderEngine(double sr, int bs)
@@ -61,18 +65,261 @@ bool RenderEngine::removeProcessor(const std::string& name)
     return false;
 }
 
-bool RenderEngine::render(const double renderLength, bool isBeats)
+bool RenderEngine::render(const double renderLength, bool isBeats, double start, double preroll,
+                          bool autoTail, float tailThresholdDb, double maxTail)
+{
+    if (autoTail && maxTail < 0)
+    {
+        throw std::runtime_error("max_tail must be zero or greater.");
+    }
+
+    const int64_t maxTailSamples = autoTail ? (int64_t)(maxTail * mySampleRate) : 0;
+
+    // An automatic tail replaces the processors' MIDI (see endMidiAt). This
+    // also puts it back if the render throws.
+    const juce::ScopeGuard midiRestorer{[this] { restoreMidi(); }};
+
+    int64_t numRenderedSamples =
+        beginRender(renderLength, isBeats, -1, maxTailSamples, start, preroll);
+
+    auto lastProcessor = getProcessorByName(m_stringDag.back().first);
+    std::uint64_t renderCacheKey = 0;
+    const bool useRenderCache =
+        m_renderCache && !autoTail && getRenderCacheKey(numRenderedSamples, renderCacheKey);
+    if (useRenderCache && m_renderCache->load(renderCacheKey, *lastProcessor))
+    {
+        finishRender(false);
+        return true;
+    }
+
+    // The pre-roll starts on a block boundary, so this renders whole blocks
+    // until the end of the requested window.
+    const int64_t endSample = m_recordStartSample + numRenderedSamples;
+    while (*m_positionInfo.getTimeInSamples() < endSample)
+    {
+        renderBlock();
+    }
+
+    if (useRenderCache)
+    {
+        m_renderCache->store(renderCacheKey, lastProcessor->getRecordBuffer());
+    }
+
+    if (autoTail)
+    {
+        renderTail(numRenderedSamples, maxTailSamples, tailThresholdDb);
+    }
+
+    finishRender(true);
+
+    return true;
+}
+
+int64_t RenderEngine::renderTail(int64_t numSamples, int64_t maxTailSamples, float thresholdDb)
+{
+    auto lastProcessor = getProcessorByName(m_stringDag.back().first);
+    const auto& recordBuffer = lastProcessor->getRecordBuffer();
+    const float threshold = juce::Decibels::decibelsToGain(thresholdDb, -1000.f);
+
+    // Processors know how long they keep sounding after their input stops
+    // (for example, a delay's delay time), and the output may be silent in
+    // the meantime, so always render at least that much.
+    double tailHint = 0;
+    for (auto& entry : m_stringDag)
+    {
+        const double tail = getProcessorByName(entry.first)->getTailLengthSeconds();
+        if (std::isfinite(tail))
+        {
+            tailHint = std::max(tailHint, tail);
+        }
+    }
+
+    const int64_t maxEnd = numSamples + maxTailSamples;
+    const int64_t minEnd = std::min(maxEnd, numSamples + (int64_t)(tailHint * mySampleRate));
+    // How long the output has to stay below the threshold.
+    const int64_t silenceWindow = (int64_t)(0.1 * mySampleRate);
+
+    int64_t end = numSamples;
+    int64_t scanned = numSamples;
+    while (true)
+    {
+        const int64_t position =
+            std::min(*m_positionInfo.getTimeInSamples() - m_recordStartSample, maxEnd);
+
+        for (int chan = 0; chan < recordBuffer.getNumChannels(); chan++)
+        {
+            const float* data = recordBuffer.getReadPointer(chan);
+            for (int64_t i = position - 1; i >= std::max(scanned, end); i--)
+            {
+                if (std::abs(data[i]) > threshold)
+                {
+                    end = i + 1;
+                    break;
+                }
+            }
+        }
+        scanned = position;
+
+        if (position >= maxEnd || (position >= minEnd && position - end >= silenceWindow))
+        {
+            break;
+        }
+
+        renderBlock();
+    }
+
+    for (auto& entry : m_stringDag)
+    {
+        getProcessorByName(entry.first)->trimRecording((int)end);
+    }
+
+    return end;
+}
+
+RenderStream* RenderEngine::renderStream(const double renderLength, int chunkSamples,
+                                         bool isBeats)
+{
+    if (chunkSamples <= 0)
+    {
+        throw std::runtime_error("render_stream: chunk_samples must be greater than zero.");
+    }
+
+    // The window holds one chunk plus the part of a block that runs past it.
+    const int64_t numSamples = beginRender(renderLength, isBeats, chunkSamples + myBufferSize);
+
+    auto lastProcessor = getProcessorByName(m_stringDag.back().first);
+
+    return new RenderStream(*this, lastProcessor, numSamples, chunkSamples);
+}
+
+RenderStream::RenderStream(RenderEngine& engine, ProcessorBase* lastProcessor,
+                           int64_t numSamples, int chunkSamples)
+    : m_engine(engine), m_lastProcessor(lastProcessor), m_generation(engine.m_renderGeneration),
+      m_numSamples(numSamples), m_chunkSamples(chunkSamples)
+{
+}
+
+RenderStream::~RenderStream()
+{
+    // A stream that's dropped early must still restore the last processor.
+    if (!m_finished && m_engine.m_renderGeneration == m_generation)
+    {
+        finish(false);
+    }
+}
+
+void RenderStream::finish(bool sendNoteOffs)
+{
+    m_finished = true;
+    m_engine.finishRender(sendNoteOffs);
+    // Don't leave the last chunk behind as if it were the whole recording.
+    m_lastProcessor->setRecordWindow(0, 0);
+}
+
+nb::ndarray<nb::numpy, float> RenderStream::next()
+{
+    if (m_finished)
+    {
+        throw nb::stop_iteration();
+    }
+
+    if (m_engine.m_renderGeneration != m_generation)
+    {
+        m_finished = true;
+        throw std::runtime_error(
+            "render_stream: the engine started another render, so this stream can't continue.");
+    }
+
+    const int chunkLength = (int)std::min<int64_t>(m_chunkSamples, m_numSamples - m_position);
+    const int64_t chunkEnd = m_position + chunkLength;
+
+    try
+    {
+        nb::gil_scoped_release release;
+
+        m_lastProcessor->moveRecordWindow(m_position);
+
+        while (m_numProcessed < chunkEnd)
+        {
+            m_engine.renderBlock();
+            m_numProcessed += m_engine.myBufferSize;
+        }
+    }
+    catch (...)
+    {
+        finish(false);
+        throw;
+    }
+
+    const auto& recordBuffer = m_lastProcessor->getRecordBuffer();
+    const size_t numChannels = recordBuffer.getNumChannels();
+
+    size_t shape[2] = {numChannels, (size_t)chunkLength};
+    float* array_data = new float[numChannels * chunkLength];
+
+    for (size_t chan = 0; chan < numChannels; chan++)
+    {
+        std::memcpy(array_data + chan * chunkLength, recordBuffer.getReadPointer((int)chan),
+                    chunkLength * sizeof(float));
+    }
+
+    auto capsule =
+        nb::capsule(array_data, [](void* p) noexcept { delete[] static_cast<float*>(p); });
+
+    m_position = chunkEnd;
+    if (m_position >= m_numSamples)
+    {
+        nb::gil_scoped_release release;
+        finish(true);
+    }
+
+    return nb::ndarray<nb::numpy, float>(array_data, 2, shape, capsule);
+}
+
+int64_t RenderEngine::beginRender(const double renderLength, bool isBeats,
+                                  int lastProcessorRecordSamples, int64_t numTailSamples,
+                                  double start, double preroll)
 {
     if (m_stringDag.empty())
     {
         throw std::runtime_error("Cannot render an empty graph.");
     }
 
+    if (start < 0 || preroll < 0)
+    {
+        throw std::runtime_error("The render start and pre-roll must be zero or greater.");
+    }
+
+    // juce::AudioProcessorGraph only builds its rendering sequence on the
+    // message thread, and renders nothing anywhere else.
+    if (!usesFlatPlan() && !juce::MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        throw std::runtime_error(
+            "The \"graph\" executor can only render on the thread that first used DawDreamer. "
+            "Set the engine's executor to \"flat\", or render a clone (see RenderEngine.clone).");
+    }
+
+    // Invalidates any RenderStream that was still running.
+    m_renderGeneration++;
+
     int64_t numRenderedSamples = getRenderLength(renderLength, isBeats);
 
-    auto numberOfBuffers =
-        myBufferSize == 1 ? numRenderedSamples
-                          : (int64_t)std::ceil(((double)numRenderedSamples) / (double)myBufferSize);
+    m_recordStartSample = 0;
+    if (start > 0)
+    {
+        m_recordStartSample = getRenderLength(start, isBeats);
+        if (isBeats)
+        {
+            numRenderedSamples = getRenderLength(start + renderLength, true) - m_recordStartSample;
+        }
+    }
+
+    // Processing starts `preroll` seconds early to warm up stateful processors,
+    // on a block boundary so that the playhead takes the same steps as it
+    // would in a render from the beginning.
+    int64_t renderStartSample =
+        std::max<int64_t>(0, m_recordStartSample - (int64_t)(preroll * mySampleRate));
+    renderStartSample -= renderStartSample % myBufferSize;
 
     bool graphIsConnected = true;
     int audioBufferNumChans = 0;
@@ -115,6 +362,7 @@ bool RenderEngine::render(const double renderLength, bool isBeats)
     timeSignature.numerator = timeSignature.denominator = 4;
     m_positionInfo.setTimeSignature(timeSignature);
     m_positionInfo.setIsLooping(false);
+    advancePlayhead(renderStartSample);
     m_positionInfo.setBpm(getBPM(*m_positionInfo.getPpqPosition()));
 
     if (!graphIsConnected)
@@ -126,9 +374,7 @@ bool RenderEngine::render(const double renderLength, bool isBeats)
         }
     }
 
-    AudioSampleBuffer audioBuffer(audioBufferNumChans, myBufferSize);
-
-    bool lastProcessorRecordEnable = false;
+    m_renderAudioBuffer.setSize(audioBufferNumChans, myBufferSize);
 
     for (auto& entry : m_stringDag)
     {
@@ -137,13 +383,22 @@ bool RenderEngine::render(const double renderLength, bool isBeats)
 
         if (processor)
         {
-            if (entry == m_stringDag.at(m_stringDag.size() - 1))
+            const bool isLast = entry == m_stringDag.at(m_stringDag.size() - 1);
+            if (isLast)
             {
                 // Always force the last processor to record.
-                lastProcessorRecordEnable = processor->getRecordEnable();
+                m_lastProcessorRecordEnable = processor->getRecordEnable();
                 processor->setRecordEnable(true);
             }
-            processor->setRecorderLength((int)numRenderedSamples);
+            processor->setRecorderLength((int)(numRenderedSamples + numTailSamples),
+                                         m_recordStartSample);
+            processor->setRenderStart(renderStartSample, *m_positionInfo.getPpqPosition());
+            processor->setAutomationBlockSize(m_automationBlockSize);
+            processor->setTempoMap(&m_tempoMap);
+            if (isLast && lastProcessorRecordSamples >= 0)
+            {
+                processor->setRecordWindow(0, lastProcessorRecordSamples);
+            }
         }
         else
         {
@@ -151,513 +406,2266 @@ bool RenderEngine::render(const double renderLength, bool isBeats)
         }
     }
 
+    // Processors read their MIDI from the start in reset.
+    if (numTailSamples > 0)
+    {
+        endMidiAt(m_recordStartSample + numRenderedSamples);
+    }
+
     // note that it's important for setRecorderLength to be called before reset,
     // because setRecorderLength sets `m_expectedRecordNumSamples` which is used
     // in reset.
     m_mainProcessorGraph->reset();
 
-    MidiBuffer renderMidiBuffer;
+    // Without the flat plan, only schedule the graph ourselves when some nodes
+    // can actually run concurrently. Otherwise the JUCE graph is just as fast.
+    m_useSchedule = false;
+    m_isScheduleSerial = false;
+    m_numNodeCacheHits = 0;
+    m_numSkippedBlocks = 0;
+    m_numSubBlocks = 0;
+    const bool useFlatPlan = usesFlatPlan();
+    const int scheduleWidth = (useFlatPlan || m_numThreads > 1) ? buildSchedule() : 0;
+    if (scheduleWidth > 1 || (useFlatPlan && scheduleWidth > 0))
+    {
+        m_useSchedule = true;
+        m_isScheduleSerial = m_numThreads == 1 || scheduleWidth == 1;
+        planScheduleBuffers(m_isScheduleSerial);
+        if ((m_nodeCacheMaxBytes > 0 || m_renderCache) && numTailSamples == 0)
+        {
+            hashScheduledNodes(renderStartSample,
+                               m_recordStartSample + numRenderedSamples - renderStartSample);
+            if (m_nodeCacheMaxBytes > 0)
+            {
+                planNodeCache();
+            }
+        }
+        if (!m_isScheduleSerial &&
+            (!m_threadPool || m_threadPool->getNumThreads() != m_numThreads))
+        {
+            m_threadPool = std::make_unique<RenderThreadPool>(m_numThreads);
+        }
+    }
+
+    m_renderMidiBuffer.clear();
+
+    return numRenderedSamples;
+}
 
-    double stepInMinutes = double(myBufferSize) / (mySampleRate * 60);
+void RenderEngine::renderBlock()
+{
+    if (!m_adaptiveBlocks)
+    {
+        renderSubBlock(myBufferSize);
+        return;
+    }
 
-    for (int64_t i = 0; i < numberOfBuffers; ++i)
+    // Split the block wherever automation, the tempo or MIDI changes, so that
+    // every change happens at the start of a sub-block.
+    for (int offset = 0; offset < myBufferSize;)
     {
-        m_positionInfo.setBpm(getBPM(*m_positionInfo.getPpqPosition()));
+        const int numSamples = getSamplesUntilNextEvent(myBufferSize - offset);
+        renderSubBlock(numSamples);
+        offset += numSamples;
+    }
+}
+
+void RenderEngine::renderSubBlock(int numSamples)
+{
+    m_numSubBlocks++;
+    m_positionInfo.setBpm(getBPM(*m_positionInfo.getPpqPosition()));
 
+    if (m_useSchedule)
+    {
+        // Automation is applied by each node right before it's processed.
+        processScheduledBlock(numSamples, true);
+    }
+    else
+    {
         for (ProcessorBase* processor : m_connectedProcessors)
         {
-            processor->automateParameters(m_positionInfo, myBufferSize);
-            processor->recordAutomation(m_positionInfo, myBufferSize);
+            processor->automateParameters(m_positionInfo, numSamples);
+            processor->recordAutomation(m_positionInfo, numSamples);
         }
 
-        m_mainProcessorGraph->processBlock(audioBuffer, renderMidiBuffer);
-
-        m_positionInfo.setTimeInSamples(*m_positionInfo.getTimeInSamples() + (int64_t)myBufferSize);
-        m_positionInfo.setTimeInSeconds(double(*m_positionInfo.getTimeInSamples()) / mySampleRate);
-        m_positionInfo.setPpqPosition(*m_positionInfo.getPpqPosition() +
-                                      stepInMinutes * *m_positionInfo.getBpm());
+        if (numSamples == myBufferSize)
+        {
+            m_mainProcessorGraph->processBlock(m_renderAudioBuffer, m_renderMidiBuffer);
+        }
+        else
+        {
+            juce::AudioSampleBuffer block(m_renderAudioBuffer.getArrayOfWritePointers(),
+                                          m_renderAudioBuffer.getNumChannels(), numSamples);
+            m_mainProcessorGraph->processBlock(block, m_renderMidiBuffer);
+        }
     }
 
-    m_positionInfo.setIsPlaying(false);
-    m_positionInfo.setIsRecording(false);
+    advancePlayhead(numSamples);
+}
 
-    // processBlock once more because PluginProcessor will look at
-    // the playhead's isPlaying value, which was just set to false,
-    // to know that we should send MIDI note off messages to all channels.
-    m_mainProcessorGraph->processBlock(audioBuffer, renderMidiBuffer);
+int RenderEngine::getSamplesUntilNextEvent(int maxSamples)
+{
+    m_positionInfo.setBpm(getBPM(*m_positionInfo.getPpqPosition()));
 
-    // restore the record-enable of the last processor.
-    if (m_stringDag.size())
+    // Ramps have no steps to split at; the playhead follows them exactly.
+    int numSamples = maxSamples;
+    if (!m_bpmRamp)
     {
-        auto node = m_mainProcessorGraph->getNodeForId(
-            m_UniqueNameToNodeID[m_stringDag.at(m_stringDag.size() - 1).first]);
-        auto processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
+        numSamples = getSamplesUntilValueChange(
+            m_bpmAutomation.getReadPointer(0), (size_t)m_bpmAutomation.getNumSamples(), m_BPM_PPQN,
+            m_tempoMap, *m_positionInfo.getTimeInSamples(), mySampleRate, maxSamples);
+    }
 
-        if (processor)
+    for (ProcessorBase* processor : m_connectedProcessors)
+    {
+        numSamples = processor->getSamplesUntilNextEvent(m_positionInfo, numSamples);
+        if (numSamples == 1)
         {
-            processor->setRecordEnable(lastProcessorRecordEnable);
+            break;
         }
     }
 
-    return true;
+    return numSamples;
 }
 
-int64_t RenderEngine::getRenderLength(const double renderLength, bool isBeats)
+void RenderEngine::advancePlayhead(int64_t numSamples)
 {
-    if (renderLength <= 0)
+    const int64_t timeInSamples = *m_positionInfo.getTimeInSamples() + numSamples;
+
+    m_positionInfo.setTimeInSamples(timeInSamples);
+    m_positionInfo.setTimeInSeconds(double(timeInSamples) / mySampleRate);
+    m_positionInfo.setPpqPosition(m_tempoMap.getBeatAtSample(double(timeInSamples), mySampleRate));
+}
+
+void RenderEngine::finishRender(bool sendNoteOffs)
+{
+    m_positionInfo.setIsPlaying(false);
+    m_positionInfo.setIsRecording(false);
+
+    if (sendNoteOffs)
     {
-        throw std::runtime_error("Render length must be greater than zero.");
+        // processBlock once more because PluginProcessor will look at
+        // the playhead's isPlaying value, which was just set to false,
+        // to know that we should send MIDI note off messages to all channels.
+        if (m_useSchedule)
+        {
+            processScheduledBlock(myBufferSize, false);
+        }
+        else
+        {
+            m_mainProcessorGraph->processBlock(m_renderAudioBuffer, m_renderMidiBuffer);
+        }
     }
 
-    if (!isBeats)
+    if (m_useSchedule)
     {
-        int64_t numRenderedSamples = (int64_t)(renderLength * mySampleRate);
-        return numRenderedSamples;
+        storeNodeCache();
     }
-    else
+
+    // restore the record-enable of the last processor.
+    if (m_stringDag.size())
+    {
+        auto processor = getProcessorByName(m_stringDag.at(m_stringDag.size() - 1).first);
+
+        if (processor)
+        {
+            processor->setRecordEnable(m_lastProcessorRecordEnable);
+        }
+    }
+}
+
+void RenderEngine::endMidiAt(int64_t sample)
+{
+    for (auto& entry : m_stringDag)
     {
-        double stepInSeconds = double(myBufferSize) / mySampleRate;
+        auto* processor = getProcessorByName(entry.first);
+        auto* midiSec = processor->getMidiBufferSec();
+        auto* midiQN = processor->getMidiBufferQN();
+        if (!midiSec || !midiQN)
+        {
+            continue;
+        }
 
-        PositionInfo posInfo;
-        // It's important to initialize these.
-        posInfo.setTimeInSamples(0);
-        posInfo.setTimeInSeconds(0);
-        posInfo.setPpqPosition(0);
+        m_midiBeforeTail.push_back({processor, *midiSec, *midiQN});
 
-        while (*posInfo.getPpqPosition() < renderLength)
+        midiSec->clear((int)sample, std::numeric_limits<int>::max() - (int)sample);
+        for (int channel = 1; channel <= 16; channel++)
         {
-            posInfo.setBpm(getBPM(*posInfo.getPpqPosition()));
-            posInfo.setTimeInSamples(*posInfo.getTimeInSamples() + (int64_t)myBufferSize);
-            posInfo.setTimeInSeconds(*posInfo.getTimeInSeconds() + stepInSeconds);
-            posInfo.setPpqPosition(*posInfo.getPpqPosition() +
-                                   (stepInSeconds / 60.) * (*posInfo.getBpm()));
+            midiSec->addEvent(juce::MidiMessage::allNotesOff(channel), (int)sample);
         }
 
-        return *posInfo.getTimeInSamples();
+        midiQN->clear();
+        for (const auto metadata : m_midiBeforeTail.back().midiQN)
+        {
+            const double beat = metadata.samplePosition / (double)ProcessorBase::PPQN;
+            if (std::llround(m_tempoMap.getSampleAtBeat(beat, mySampleRate)) >= sample)
+            {
+                break;
+            }
+            midiQN->addEvent(metadata.getMessage(), metadata.samplePosition);
+        }
     }
 }
 
-void RenderEngine::setBPM(double bpm)
+void RenderEngine::restoreMidi()
 {
-    if (bpm <= 0)
+    for (auto& saved : m_midiBeforeTail)
     {
-        throw std::runtime_error("BPM must be positive.");
+        *saved.processor->getMidiBufferSec() = std::move(saved.midiSec);
+        *saved.processor->getMidiBufferQN() = std::move(saved.midiQN);
     }
-
-    m_bpmAutomation.setSize(1, 1);
-    m_bpmAutomation.setSample(0, 0, bpm);
+    m_midiBeforeTail.clear();
 }
 
-bool RenderEngine::setBPMwithPPQN(nb::ndarray<nb::numpy, float> input, std::uint32_t ppqn)
+int64_t RenderEngine::renderInto(nb::ndarray<float> output, const double renderLength,
+                                 bool isBeats)
 {
-    if (ppqn <= 0)
+    if (m_stringDag.empty())
     {
-        throw std::runtime_error("The BPM's PPQN cannot be less than or equal to zero.");
+        throw std::runtime_error("Cannot render an empty graph.");
     }
 
-    if (input.ndim() > 1)
+    validateAudioNdarray(output, "render_into");
+
+    if (output.stride(1) != 1 || output.stride(0) != (int64_t)output.shape(1))
     {
-        throw std::runtime_error("The BPM automation must be single dimensional.");
+        throw std::runtime_error("render_into: the output array must be C-contiguous.");
     }
 
-    m_BPM_PPQN = ppqn;
+    auto lastProcessor = getProcessorByName(m_stringDag.back().first);
+    if (!lastProcessor)
+    {
+        throw std::runtime_error("Unable to find processor named: " + m_stringDag.back().first +
+                                 ".");
+    }
 
-    int numSamples = (int)input.shape(0);
+    const int64_t numSamples = getRenderLength(renderLength, isBeats);
+    const bool recordEnable = lastProcessor->getRecordEnable();
 
-    m_bpmAutomation.setSize(1, numSamples);
+    lastProcessor->setExternalRecordTarget((float*)output.data(), (int)output.shape(0),
+                                           (int)output.shape(1));
+
+    try
+    {
+        nb::gil_scoped_release release;
+        render(renderLength, isBeats);
+    }
+    catch (const std::exception& e)
+    {
+        // render() may have thrown before restoring the record flag it forces on.
+        lastProcessor->setRecordEnable(recordEnable);
+        lastProcessor->setExternalRecordTarget(nullptr, 0, 0);
+        throw std::runtime_error(std::string("render_into: ") + e.what());
+    }
 
-    m_bpmAutomation.copyFrom(0, 0, (float*)input.data(), numSamples);
+    lastProcessor->setExternalRecordTarget(nullptr, 0, 0);
 
-    return true;
+    return numSamples;
 }
 
-nb::ndarray<nb::numpy, float> RenderEngine::getAudioFrames()
+namespace
 {
-    if (m_mainProcessorGraph->getNumNodes() == 0 || m_stringDag.size() == 0)
-    {
-        // Return empty array with shape (2, 0)
-        size_t shape[2] = {2, 0};
-        return nb::ndarray<nb::numpy, float>(nullptr, 2, shape);
-    }
+struct BatchParameterOverride
+{
+    int index;
+    std::vector<float> values;
+    std::uint32_t ppqn;
+};
 
-    return getAudioFramesForName(m_stringDag.at(m_stringDag.size() - 1).first);
-}
+struct BatchMidiNote
+{
+    uint8 note;
+    uint8 velocity;
+    double start;
+    double duration;
+    bool isBeats;
+};
+
+struct BatchProcessorOverride
+{
+    ProcessorBase* processor = nullptr;
+    std::vector<BatchParameterOverride> parameters;
+    bool replacesMidi = false;
+    std::vector<BatchMidiNote> notes;
+};
+
+// The state a variant may change, saved so that it can be put back.
+struct BatchSavedParameter
+{
+    ProcessorBase* processor;
+    int index;
+    std::vector<float> values;
+    std::uint32_t ppqn;
+};
 
-nb::ndarray<nb::numpy, float> RenderEngine::getAudioFramesForName(std::string& name)
+struct BatchSavedMidi
 {
-    if (m_UniqueNameToNodeID.find(name) != m_UniqueNameToNodeID.end())
-    {
-        auto node = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[name]);
+    ProcessorBase* processor;
+    juce::MidiBuffer midiSec;
+    juce::MidiBuffer midiQN;
+};
 
-        auto processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
-        if (processor)
+int findParameterIndex(ProcessorBase* processor, nb::handle key)
+{
+    auto parameters = processor->getParameters();
+
+    if (nb::isinstance<nb::str>(key))
+    {
+        std::string name = nb::cast<std::string>(key);
+        for (int i = 0; i < parameters.size(); i++)
         {
-            if (std::strcmp(processor->getUniqueName().c_str(), name.c_str()) == 0)
+            if (parameters.getUnchecked(i)->getName(DAW_PARAMETER_MAX_NAME_LENGTH).toStdString() ==
+                name)
             {
-                return processor->getAudioFrames();
+                return i;
             }
         }
+        throw std::runtime_error("render_batch: processor " + processor->getUniqueName() +
+                                 " has no parameter named " + name + ".");
     }
 
-    // Return empty array with shape (2, 0)
-    size_t shape[2] = {2, 0};
-    return nb::ndarray<nb::numpy, float>(nullptr, 2, shape);
+    int index = nb::cast<int>(key);
+    if (index < 0 || index >= parameters.size())
+    {
+        throw std::runtime_error("render_batch: processor " + processor->getUniqueName() +
+                                 " has no parameter at index " + std::to_string(index) + ".");
+    }
+    return index;
 }
 
-juce::Optional<juce::AudioPlayHead::PositionInfo> RenderEngine::getPosition() const
+std::vector<float> automationFromArray(nb::handle obj)
 {
-    return m_positionInfo;
+    auto input = nb::cast<nb::ndarray<float>>(obj);
+    if (input.ndim() != 1)
+    {
+        throw std::runtime_error("render_batch: automation arrays must be 1-D.");
+    }
+    if (input.shape(0) == 0)
+    {
+        throw std::runtime_error("render_batch: automation arrays must not be empty.");
+    }
+
+    // Follow the stride, so that slices such as arr[::2] are read correctly.
+    const float* data = (const float*)input.data();
+    const int64_t stride = input.stride(0);
+    std::vector<float> values(input.shape(0));
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = data[(int64_t)i * stride];
+    }
+    return values;
 }
+} // namespace
 
-/** Returns true if this object can control the transport. */
-bool RenderEngine::canControlTransport()
+nb::ndarray<nb::numpy, float> RenderEngine::renderBatch(nb::list variants,
+                                                        const double renderLength, bool isBeats,
+                                                        int numWorkers)
 {
-    return false;
-}
+    if (m_stringDag.empty())
+    {
+        throw std::runtime_error("Cannot render an empty graph.");
+    }
 
-/** Starts or stops the audio. */
-void RenderEngine::transportPlay(bool shouldStartPlaying) {}
+    // Parse every variant while we hold the GIL.
+    std::vector<std::vector<BatchProcessorOverride>> batch;
 
-/** Starts or stops recording the audio. */
-void RenderEngine::transportRecord(bool shouldStartRecording) {}
+    for (nb::handle variantObj : variants)
+    {
+        if (!nb::isinstance<nb::dict>(variantObj))
+        {
+            throw std::runtime_error(
+                "render_batch: each variant must be a dict of processor names to overrides.");
+        }
 
-/** Rewinds the audio. */
-void RenderEngine::transportRewind() {}
+        std::vector<BatchProcessorOverride> variant;
 
-// Factory methods exposed to Python:
+        for (auto [nameObj, specObj] : nb::cast<nb::dict>(variantObj))
+        {
+            std::string name = nb::cast<std::string>(nameObj);
 
-OscillatorProcessor* RenderEngine::makeOscillatorProcessor(const std::string& name, float freq)
-{
-    auto processor = new OscillatorProcessor{name, freq};
-    this->prepareProcessor(processor, name);
-    return processor;
-}
+            BatchProcessorOverride processorOverride;
+            processorOverride.processor = getProcessorByName(name);
+            if (!processorOverride.processor)
+            {
+                throw std::runtime_error("render_batch: unable to find processor named " + name +
+                                         ".");
+            }
 
-PluginProcessorWrapper* RenderEngine::makePluginProcessor(const std::string& name,
-                                                          const std::string& path)
-{
-    auto processor = new PluginProcessorWrapper{name, mySampleRate, myBufferSize, path};
-    this->prepareProcessor(processor, name);
-    return processor;
-}
+            if (!nb::isinstance<nb::dict>(specObj))
+            {
+                throw std::runtime_error("render_batch: the overrides for " + name +
+                                         " must be a dict.");
+            }
 
-PlaybackProcessor* RenderEngine::makePlaybackProcessor(const std::string& name,
-                                                       nb::ndarray<float> data)
-{
-    auto processor = new PlaybackProcessor{name, data};
-    this->prepareProcessor(processor, name);
-    return processor;
+            for (auto [keyObj, valueObj] : nb::cast<nb::dict>(specObj))
+            {
+                std::string key = nb::cast<std::string>(keyObj);
+
+                if (key == "parameters")
+                {
+                    for (auto [paramKey, paramValue] : nb::cast<nb::dict>(valueObj))
+                    {
+                        BatchParameterOverride parameterOverride;
+                        parameterOverride.index =
+                            findParameterIndex(processorOverride.processor, paramKey);
+                        parameterOverride.ppqn = 0;
+
+                        float constant;
+                        if (nb::isinstance<nb::tuple>(paramValue))
+                        {
+                            // (automation, ppqn)
+                            auto pair = nb::cast<nb::tuple>(paramValue);
+                            if (nb::len(pair) != 2)
+                            {
+                                throw std::runtime_error(
+                                    "render_batch: PPQN automation must be a tuple of "
+                                    "(array, ppqn).");
+                            }
+                            parameterOverride.values = automationFromArray(pair[0]);
+                            parameterOverride.ppqn = nb::cast<std::uint32_t>(pair[1]);
+                        }
+                        else if (nb::try_cast<float>(paramValue, constant))
+                        {
+                            parameterOverride.values = {constant};
+                        }
+                        else
+                        {
+                            parameterOverride.values = automationFromArray(paramValue);
+                        }
+
+                        processorOverride.parameters.push_back(std::move(parameterOverride));
+                    }
+                }
+                else if (key == "midi_notes")
+                {
+                    if (!processorOverride.processor->getMidiBufferSec())
+                    {
+                        throw std::runtime_error("render_batch: processor " + name +
+                                                 " doesn't accept MIDI notes.");
+                    }
+
+                    processorOverride.replacesMidi = true;
+
+                    for (nb::handle noteObj : nb::cast<nb::list>(valueObj))
+                    {
+                        auto noteTuple = nb::cast<nb::tuple>(noteObj);
+                        const size_t size = nb::len(noteTuple);
+                        if (size != 4 && size != 5)
+                        {
+                            throw std::runtime_error(
+                                "render_batch: each MIDI note must be a tuple of (note, "
+                                "velocity, start_time, duration) with an optional `beats` "
+                                "bool.");
+                        }
+
+                        BatchMidiNote note;
+                        note.note = (uint8)nb::cast<int>(noteTuple[0]);
+                        note.velocity = (uint8)nb::cast<int>(noteTuple[1]);
+                        note.start = nb::cast<double>(noteTuple[2]);
+                        note.duration = nb::cast<double>(noteTuple[3]);
+                        note.isBeats = size == 5 && nb::cast<bool>(noteTuple[4]);
+                        processorOverride.notes.push_back(note);
+                    }
+                }
+                else
+                {
+                    throw std::runtime_error("render_batch: unknown override \"" + key +
+                                             "\" for processor " + name +
+                                             ". Expected \"parameters\" or \"midi_notes\".");
+                }
+            }
+
+            variant.push_back(std::move(processorOverride));
+        }
+
+        batch.push_back(std::move(variant));
+    }
+
+    // Save everything that any variant overrides.
+    std::vector<BatchSavedParameter> savedParameters;
+    std::vector<BatchSavedMidi> savedMidi;
+
+    for (auto& variant : batch)
+    {
+        for (auto& processorOverride : variant)
+        {
+            auto* processor = processorOverride.processor;
+            for (auto& parameterOverride : processorOverride.parameters)
+            {
+                auto isSaved = [&](const BatchSavedParameter& saved)
+                { return saved.processor == processor && saved.index == parameterOverride.index; };
+                if (std::none_of(savedParameters.begin(), savedParameters.end(), isSaved))
+                {
+                    auto* parameter = static_cast<AutomateParameterFloat*>(
+                        processor->getParameters().getUnchecked(parameterOverride.index));
+                    savedParameters.push_back({processor, parameterOverride.index,
+                                               parameter->getAutomation(), parameter->getPPQN()});
+                }
+            }
+
+            if (processorOverride.replacesMidi &&
+                std::none_of(savedMidi.begin(), savedMidi.end(),
+                             [&](const BatchSavedMidi& saved)
+                             { return saved.processor == processor; }))
+            {
+                savedMidi.push_back(
+                    {processor, *processor->getMidiBufferSec(), *processor->getMidiBufferQN()});
+            }
+        }
+    }
+
+    // The processor in `engine` standing in for `processor` of this engine.
+    auto resolve = [this](RenderEngine& engine, ProcessorBase* processor)
+    { return &engine == this ? processor : engine.getProcessorByName(processor->getUniqueName()); };
+
+    auto restoreSavedState = [&](RenderEngine& engine)
+    {
+        for (auto& saved : savedParameters)
+        {
+            auto* processor = resolve(engine, saved.processor);
+            if (saved.values.size() == 1 && saved.ppqn == 0)
+            {
+                // Go through the processor so that plugins update the hosted
+                // plugin's parameter too.
+                processor->setAutomationValByIndex(saved.index, saved.values[0]);
+            }
+            else
+            {
+                auto* parameter = static_cast<AutomateParameterFloat*>(
+                    processor->getParameters().getUnchecked(saved.index));
+                parameter->setAutomation(saved.values, saved.ppqn);
+            }
+        }
+
+        for (auto& saved : savedMidi)
+        {
+            auto* processor = resolve(engine, saved.processor);
+            *processor->getMidiBufferSec() = saved.midiSec;
+            *processor->getMidiBufferQN() = saved.midiQN;
+        }
+    };
+
+    auto lastProcessor = getProcessorByName(m_stringDag.back().first);
+    if (!lastProcessor)
+    {
+        throw std::runtime_error("Unable to find processor named: " + m_stringDag.back().first +
+                                 ".");
+    }
+
+    const size_t numVariants = batch.size();
+    const size_t numChannels = lastProcessor->getTotalNumOutputChannels();
+    const size_t numSamples = getRenderLength(renderLength, isBeats);
+    const size_t variantSize = numChannels * numSamples;
+
+    if (numWorkers <= 0)
+    {
+        numWorkers = juce::SystemStats::getNumCpus();
+    }
+    numWorkers = (int)std::max((size_t)1, std::min((size_t)numWorkers, numVariants));
+
+    // Every worker after the first renders on its own clone of this engine.
+    // Cloning needs the GIL, so they're made before it's released.
+    std::vector<std::unique_ptr<RenderEngine>> clones;
+    for (int i = 1; i < numWorkers; i++)
+    {
+        clones.emplace_back(clone());
+    }
+
+    float* array_data = new float[numVariants * variantSize];
+
+    auto renderVariant = [&](RenderEngine& engine, size_t v)
+    {
+        restoreSavedState(engine);
+
+        for (auto& processorOverride : batch[v])
+        {
+            auto* processor = resolve(engine, processorOverride.processor);
+
+            for (auto& parameterOverride : processorOverride.parameters)
+            {
+                if (parameterOverride.values.size() == 1 && parameterOverride.ppqn == 0)
+                {
+                    processor->setAutomationValByIndex(parameterOverride.index,
+                                                       parameterOverride.values[0]);
+                }
+                else
+                {
+                    auto* parameter = static_cast<AutomateParameterFloat*>(
+                        processor->getParameters().getUnchecked(parameterOverride.index));
+                    parameter->setAutomation(parameterOverride.values, parameterOverride.ppqn);
+                }
+            }
+
+            if (processorOverride.replacesMidi)
+            {
+                processor->getMidiBufferSec()->clear();
+                processor->getMidiBufferQN()->clear();
+                for (auto& note : processorOverride.notes)
+                {
+                    processor->addMidiNote(note.note, note.velocity, note.start, note.duration,
+                                           note.isBeats);
+                }
+            }
+        }
+
+        engine.render(renderLength, isBeats);
+
+        const auto& recordBuffer = resolve(engine, lastProcessor)->getRecordBuffer();
+        const size_t numSamplesToCopy = std::min(numSamples, (size_t)recordBuffer.getNumSamples());
+        float* variantData = array_data + v * variantSize;
+
+        for (size_t chan = 0; chan < numChannels; chan++)
+        {
+            float* row = variantData + chan * numSamples;
+            if (chan < (size_t)recordBuffer.getNumChannels())
+            {
+                std::memcpy(row, recordBuffer.getReadPointer((int)chan),
+                            numSamplesToCopy * sizeof(float));
+                std::fill(row + numSamplesToCopy, row + numSamples, 0.f);
+            }
+            else
+            {
+                std::fill(row, row + numSamples, 0.f);
+            }
+        }
+    };
+
+    try
+    {
+        nb::gil_scoped_release release;
+
+        // Workers take the next variant that no one has started.
+        std::atomic<size_t> nextVariant{0};
+        std::vector<std::exception_ptr> errors((size_t)numWorkers);
+        auto work = [&](RenderEngine& engine, int worker)
+        {
+            try
+            {
+                for (size_t v = nextVariant++; v < numVariants; v = nextVariant++)
+                {
+                    renderVariant(engine, v);
+                }
+            }
+            catch (...)
+            {
+                errors[(size_t)worker] = std::current_exception();
+                nextVariant = numVariants;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < numWorkers; i++)
+        {
+            threads.emplace_back(work, std::ref(*clones[(size_t)i - 1]), i);
+        }
+        work(*this, 0);
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        restoreSavedState(*this);
+
+        for (auto& error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    catch (...)
+    {
+        restoreSavedState(*this);
+        delete[] array_data;
+        throw;
+    }
+
+    size_t shape[3] = {numVariants, numChannels, numSamples};
+    auto capsule =
+        nb::capsule(array_data, [](void* p) noexcept { delete[] static_cast<float*>(p); });
+
+    return nb::ndarray<nb::numpy, float>(array_data, 3, shape, capsule);
 }
 
-#ifdef BUILD_DAWDREAMER_RUBBERBAND
-PlaybackWarpProcessor* RenderEngine::makePlaybackWarpProcessor(const std::string& name,
-                                                               nb::ndarray<float> data,
-                                                               double data_sr)
+int64_t RenderEngine::getRenderLength(const double renderLength, bool isBeats)
 {
-    auto processor = new PlaybackWarpProcessor{name, data, mySampleRate, data_sr};
-    this->prepareProcessor(processor, name);
-    return processor;
+    if (renderLength <= 0)
+    {
+        throw std::runtime_error("Render length must be greater than zero.");
+    }
+
+    if (!isBeats)
+    {
+        int64_t numRenderedSamples = (int64_t)(renderLength * mySampleRate);
+        return numRenderedSamples;
+    }
+    else
+    {
+        return std::llround(m_tempoMap.getSampleAtBeat(renderLength, mySampleRate));
+    }
 }
-#endif
 
-FilterProcessor* RenderEngine::makeFilterProcessor(const std::string& name, const std::string& mode,
-                                                   float freq, float q, float gain)
+void RenderEngine::setBPM(double bpm)
 {
-    float validFreq = std::fmax(.0001f, freq);
-    float validQ = std::fmax(.0001f, q);
-    float validGain = std::fmax(.0001f, gain);
+    if (bpm <= 0)
+    {
+        throw std::runtime_error("BPM must be positive.");
+    }
 
-    auto processor = new FilterProcessor{name, mode, validFreq, validQ, validGain};
-    this->prepareProcessor(processor, name);
-    return processor;
+    m_bpmAutomation.setSize(1, 1);
+    m_bpmAutomation.setSample(0, 0, bpm);
+    m_bpmRamp = false;
+    m_tempoMap = TempoMap(bpm);
 }
 
-CompressorProcessor* RenderEngine::makeCompressorProcessor(const std::string& name,
-                                                           float threshold = 0.f, float ratio = 2.f,
-                                                           float attack = 2.f, float release = 50.f)
+bool RenderEngine::setBPMwithPPQN(nb::ndarray<nb::numpy, float> input, std::uint32_t ppqn,
+                                  bool ramp)
 {
-    // ratio must be >= 1.0
-    // attack and release are in milliseconds
-    float validRatio = std::fmax(1.0f, ratio);
-    float validAttack = std::fmax(0.f, attack);
-    float validRelease = std::fmax(0.f, release);
+    if (ppqn <= 0)
+    {
+        throw std::runtime_error("The BPM's PPQN cannot be less than or equal to zero.");
+    }
 
-    auto processor =
-        new CompressorProcessor{name, threshold, validRatio, validAttack, validRelease};
-    this->prepareProcessor(processor, name);
-    return processor;
+    if (input.ndim() > 1)
+    {
+        throw std::runtime_error("The BPM automation must be single dimensional.");
+    }
+
+    int numSamples = (int)input.shape(0);
+    const float* bpm = (const float*)input.data();
+
+    if (numSamples == 0)
+    {
+        throw std::runtime_error("The BPM automation must not be empty.");
+    }
+    if (std::any_of(bpm, bpm + numSamples, [](float value) { return !(value > 0); }))
+    {
+        throw std::runtime_error("BPM must be positive.");
+    }
+
+    m_BPM_PPQN = ppqn;
+
+    m_bpmAutomation.setSize(1, numSamples);
+
+    m_bpmAutomation.copyFrom(0, 0, bpm, numSamples);
+
+    m_bpmRamp = ramp;
+    m_tempoMap = TempoMap(bpm, (size_t)numSamples, ppqn, ramp);
+
+    return true;
 }
 
-AddProcessor* RenderEngine::makeAddProcessor(const std::string& name, std::vector<float> gainLevels)
+nb::object RenderEngine::getAudioFrames()
 {
-    auto processor = new AddProcessor{name, gainLevels};
-    this->prepareProcessor(processor, name);
-    return processor;
+    if (m_mainProcessorGraph->getNumNodes() == 0 || m_stringDag.size() == 0)
+    {
+        // Return empty array with shape (2, 0)
+        size_t shape[2] = {2, 0};
+        return nb::ndarray<nb::numpy, float>(nullptr, 2, shape).cast();
+    }
+
+    return getAudioFramesForName(m_stringDag.at(m_stringDag.size() - 1).first);
 }
 
-ReverbProcessor* RenderEngine::makeReverbProcessor(const std::string& name, float roomSize = 0.5f,
-                                                   float damping = 0.5f, float wetLevel = 0.33f,
-                                                   float dryLevel = 0.4f, float width = 1.0f)
+nb::object RenderEngine::detachAudioFrames()
 {
-    auto processor = new ReverbProcessor{name, roomSize, damping, wetLevel, dryLevel, width};
-    this->prepareProcessor(processor, name);
-    return processor;
+    if (m_mainProcessorGraph->getNumNodes() == 0 || m_stringDag.size() == 0)
+    {
+        // Return empty array with shape (2, 0)
+        size_t shape[2] = {2, 0};
+        return nb::ndarray<nb::numpy, float>(nullptr, 2, shape).cast();
+    }
+
+    return detachAudioFramesForName(m_stringDag.at(m_stringDag.size() - 1).first);
 }
 
-PannerProcessor* RenderEngine::makePannerProcessor(const std::string& name, std::string& rule,
-                                                   float pan)
+nb::object RenderEngine::detachAudioFramesForName(std::string& name)
 {
-    float safeVal = std::clamp(pan, -1.f, 1.f);
+    auto processor = getProcessorByName(name);
+    if (processor)
+    {
+        return processor->detachAudioFrames();
+    }
 
-    auto processor = new PannerProcessor{name, rule, safeVal};
-    this->prepareProcessor(processor, name);
-    return processor;
+    // Return empty array with shape (2, 0)
+    size_t shape[2] = {2, 0};
+    return nb::ndarray<nb::numpy, float>(nullptr, 2, shape).cast();
 }
 
-DelayProcessor* RenderEngine::makeDelayProcessor(const std::string& name, std::string& rule,
-                                                 float delay, float wet)
+nb::object RenderEngine::getAudioFramesForName(std::string& name)
 {
-    float safeDelay = std::fmax(0.f, delay);
+    if (m_UniqueNameToNodeID.find(name) != m_UniqueNameToNodeID.end())
+    {
+        auto node = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[name]);
 
-    float safeWet = std::fmin(1.f, std::fmax(0.f, wet));
-    auto processor = new DelayProcessor{name, rule, safeDelay, safeWet};
+        auto processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
+        if (processor)
+        {
+            if (std::strcmp(processor->getUniqueName().c_str(), name.c_str()) == 0)
+            {
+                return processor->getAudioFrames();
+            }
+        }
+    }
+
+    // Return empty array with shape (2, 0)
+    size_t shape[2] = {2, 0};
+    return nb::ndarray<nb::numpy, float>(nullptr, 2, shape).cast();
+}
+
+void RenderEngine::setNumThreads(int numThreads)
+{
+    if (numThreads < 0)
+    {
+        throw std::runtime_error("The number of threads must be zero or greater.");
+    }
+
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    m_numThreads = numThreads;
+}
+
+void RenderEngine::setExecutor(const std::string& executor)
+{
+    if (executor != "graph" && executor != "flat")
+    {
+        throw std::runtime_error("Unknown executor \"" + executor +
+                                 "\". Use \"graph\" or \"flat\".");
+    }
+
+    m_useFlatPlan = executor == "flat";
+}
+
+void RenderEngine::setNodeCacheSize(double megabytes)
+{
+    if (megabytes < 0)
+    {
+        throw std::runtime_error("The node cache size must be zero or greater.");
+    }
+
+    m_nodeCacheMaxBytes = (size_t)(megabytes * 1024. * 1024.);
+    trimNodeCache();
+}
+
+void RenderEngine::setRenderCache(const std::string& directory, double maxMegabytes)
+{
+    if (maxMegabytes <= 0)
+    {
+        throw std::runtime_error("The render cache size must be greater than zero.");
+    }
+
+    m_renderCache.reset();
+    if (!directory.empty())
+    {
+        m_renderCache = std::make_unique<RenderCache>(directory, maxMegabytes);
+    }
+}
+
+RenderEngine* RenderEngine::clone()
+{
+    auto engine = std::make_unique<RenderEngine>(mySampleRate, myBufferSize);
+
+    engine->m_bpmAutomation.makeCopyOf(m_bpmAutomation);
+    engine->m_BPM_PPQN = m_BPM_PPQN;
+    engine->m_bpmRamp = m_bpmRamp;
+    engine->m_tempoMap = m_tempoMap;
+
+    engine->m_useFlatPlan = m_useFlatPlan;
+    engine->m_isClone = true;
+    engine->m_skipSilence = m_skipSilence;
+    engine->m_adaptiveBlocks = m_adaptiveBlocks;
+    engine->m_automationBlockSize = m_automationBlockSize;
+    engine->setNumThreads(m_numThreads);
+    engine->m_nodeCacheMaxBytes = m_nodeCacheMaxBytes;
+    if (m_renderCache)
+    {
+        engine->setRenderCache(m_renderCache->getDirectory(), m_renderCache->getMaxMegabytes());
+    }
+
+    // The processors are created with the arguments their pickle state would
+    // restore them from, then take the automation, MIDI and record settings of
+    // the original.
+    std::unordered_map<std::string, ProcessorBase*> clones;
+    for (const auto& [name, nodeID] : m_UniqueNameToNodeID)
+    {
+        auto node = m_mainProcessorGraph->getNodeForId(nodeID);
+        auto* proc = node ? dynamic_cast<ProcessorBase*>(node->getProcessor()) : nullptr;
+        if (!proc)
+        {
+            continue;
+        }
+
+        ProcessorBase* copy = nullptr;
+#ifdef BUILD_DAWDREAMER_FAUST
+        if (auto* faust_proc = dynamic_cast<FaustProcessor*>(proc))
+        {
+            auto* faust_copy = engine->makeFaustProcessor(name);
+            faust_copy->copyCompiledFrom(*faust_proc);
+            copy = faust_copy;
+        }
+        else
+#endif
+#ifdef BUILD_DAWDREAMER_RUBBERBAND
+            if (auto* playbackwarp_proc = dynamic_cast<PlaybackWarpProcessor*>(proc))
+        {
+            copy = new PlaybackWarpProcessor{name, *playbackwarp_proc};
+            engine->prepareProcessor(copy, name);
+        }
+        else
+#endif
+            if (auto* playback_proc = dynamic_cast<PlaybackProcessor*>(proc))
+        {
+            copy = new PlaybackProcessor{name, *playback_proc};
+            engine->prepareProcessor(copy, name);
+        }
+        else if (auto* osc_proc = dynamic_cast<OscillatorProcessor*>(proc))
+        {
+            copy = engine->makeOscillatorProcessor(name, osc_proc->myFreq);
+        }
+        else if (auto* filter_proc = dynamic_cast<FilterProcessor*>(proc))
+        {
+            copy = engine->makeFilterProcessor(name, filter_proc->getMode(),
+                                               filter_proc->getFrequency(), filter_proc->getQ(),
+                                               filter_proc->getGain());
+        }
+        else if (auto* compressor_proc = dynamic_cast<CompressorProcessor*>(proc))
+        {
+            copy = engine->makeCompressorProcessor(
+                name, compressor_proc->getThreshold(), compressor_proc->getRatio(),
+                compressor_proc->getAttack(), compressor_proc->getRelease());
+        }
+        else if (auto* reverb_proc = dynamic_cast<ReverbProcessor*>(proc))
+        {
+            copy = engine->makeReverbProcessor(
+                name, reverb_proc->getRoomSize(), reverb_proc->getDamping(),
+                reverb_proc->getWetLevel(), reverb_proc->getDryLevel(), reverb_proc->getWidth());
+        }
+        else if (auto* panner_proc = dynamic_cast<PannerProcessor*>(proc))
+        {
+            std::string rule = panner_proc->getRule();
+            copy = engine->makePannerProcessor(name, rule, panner_proc->getPan());
+        }
+        else if (auto* delay_proc = dynamic_cast<DelayProcessor*>(proc))
+        {
+            std::string rule = delay_proc->getRule();
+            copy = engine->makeDelayProcessor(name, rule, delay_proc->getDelay(),
+                                              delay_proc->getWet());
+        }
+        else if (auto* sampler_proc = dynamic_cast<SamplerProcessor*>(proc))
+        {
+            copy = new SamplerProcessor{name, *sampler_proc};
+            engine->prepareProcessor(copy, name);
+        }
+        else if (auto* plugin_proc = dynamic_cast<PluginProcessorWrapper*>(proc))
+        {
+            auto* plugin_copy = engine->makePluginProcessor(name, plugin_proc->getPluginPath(),
+                                                            plugin_proc->isIsolated());
+            plugin_copy->copyPluginStateFrom(*plugin_proc);
+            copy = plugin_copy;
+        }
+        else if (auto* add_proc = dynamic_cast<AddProcessor*>(proc))
+        {
+            copy = engine->makeAddProcessor(name, add_proc->getGainLevels());
+        }
+        else
+        {
+            throw std::runtime_error("The processor \"" + name + "\" can't be cloned.");
+        }
+
+        copy->copySettingsFrom(*proc);
+        clones[name] = copy;
+    }
+
+    DAG dag;
+    for (const auto& [name, inputs] : m_stringDag)
+    {
+        dag.nodes.push_back(DAGNode{clones.at(name), inputs});
+    }
+    engine->loadGraph(dag);
+
+    return engine.release();
+}
+
+bool RenderEngine::getRenderCacheKey(int64_t numSamples, std::uint64_t& key)
+{
+    // The schedule follows the order of m_stringDag, so the last node is the
+    // last processor, the only one whose recording is stored.
+    if (!m_useSchedule || !m_schedule.back().isCacheable ||
+        m_schedule.back().processor->getRecordAutomationEnable())
+    {
+        return false;
+    }
+    for (size_t i = 0; i + 1 < m_schedule.size(); i++)
+    {
+        auto* processor = m_schedule[i].processor;
+        if (processor->getRecordEnable() || processor->getRecordAutomationEnable())
+        {
+            return false;
+        }
+    }
+
+    // The files outlive the module, so a new DawDreamer or libfaust, which may
+    // render differently, has to miss.
+    ConfigurationHasher hasher;
+    hasher.add(std::string(ProjectInfo::versionString));
+#ifdef BUILD_DAWDREAMER_FAUST
+    hasher.add(std::string(getCLibFaustVersion()));
+#endif
+    hasher.add(m_schedule.back().cacheKey);
+    hasher.add(m_recordStartSample);
+    hasher.add(numSamples);
+    key = hasher.getHash();
+    return true;
+}
+
+void RenderEngine::clearNodeCache()
+{
+    m_nodeCache.clear();
+    m_nodeCacheIndex.clear();
+    m_nodeCacheBytes = 0;
+}
+
+void RenderEngine::trimNodeCache()
+{
+    while (m_nodeCacheBytes > m_nodeCacheMaxBytes)
+    {
+        const auto& oldest = m_nodeCache.back();
+        m_nodeCacheBytes -= (size_t)oldest.audio->getNumChannels() *
+                            (size_t)oldest.audio->getNumSamples() * sizeof(float);
+        m_nodeCacheIndex.erase(oldest.key);
+        m_nodeCache.pop_back();
+    }
+}
+
+void RenderEngine::setAutomationBlockSize(int numSamples)
+{
+    if (numSamples < 0)
+    {
+        throw std::runtime_error("The automation block size must be zero or greater.");
+    }
+
+    m_automationBlockSize = numSamples;
+}
+
+juce::Optional<juce::AudioPlayHead::PositionInfo> RenderEngine::getPosition() const
+{
+    return m_positionInfo;
+}
+
+/** Returns true if this object can control the transport. */
+bool RenderEngine::canControlTransport()
+{
+    return false;
+}
+
+/** Starts or stops the audio. */
+void RenderEngine::transportPlay(bool shouldStartPlaying) {}
+
+/** Starts or stops recording the audio. */
+void RenderEngine::transportRecord(bool shouldStartRecording) {}
+
+/** Rewinds the audio. */
+void RenderEngine::transportRewind() {}
+
+// Factory methods exposed to Python:
+
+OscillatorProcessor* RenderEngine::makeOscillatorProcessor(const std::string& name, float freq)
+{
+    auto processor = new OscillatorProcessor{name, freq};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+PluginProcessorWrapper* RenderEngine::makePluginProcessor(const std::string& name,
+                                                          const std::string& path, bool isolated)
+{
+    auto processor = new PluginProcessorWrapper{name, mySampleRate, myBufferSize, path, isolated};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+PlaybackProcessor* RenderEngine::makePlaybackProcessor(const std::string& name,
+                                                       nb::ndarray<float> data)
+{
+    auto processor = new PlaybackProcessor{name, data};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+#ifdef BUILD_DAWDREAMER_RUBBERBAND
+PlaybackWarpProcessor* RenderEngine::makePlaybackWarpProcessor(const std::string& name,
+                                                               nb::ndarray<float> data,
+                                                               double data_sr)
+{
+    auto processor = new PlaybackWarpProcessor{name, data, mySampleRate, data_sr};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+#endif
+
+FilterProcessor* RenderEngine::makeFilterProcessor(const std::string& name, const std::string& mode,
+                                                   float freq, float q, float gain)
+{
+    float validFreq = std::fmax(.0001f, freq);
+    float validQ = std::fmax(.0001f, q);
+    float validGain = std::fmax(.0001f, gain);
+
+    auto processor = new FilterProcessor{name, mode, validFreq, validQ, validGain};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+CompressorProcessor* RenderEngine::makeCompressorProcessor(const std::string& name,
+                                                           float threshold = 0.f, float ratio = 2.f,
+                                                           float attack = 2.f, float release = 50.f)
+{
+    // ratio must be >= 1.0
+    // attack and release are in milliseconds
+    float validRatio = std::fmax(1.0f, ratio);
+    float validAttack = std::fmax(0.f, attack);
+    float validRelease = std::fmax(0.f, release);
+
+    auto processor =
+        new CompressorProcessor{name, threshold, validRatio, validAttack, validRelease};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+AddProcessor* RenderEngine::makeAddProcessor(const std::string& name, std::vector<float> gainLevels)
+{
+    auto processor = new AddProcessor{name, gainLevels};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+ReverbProcessor* RenderEngine::makeReverbProcessor(const std::string& name, float roomSize = 0.5f,
+                                                   float damping = 0.5f, float wetLevel = 0.33f,
+                                                   float dryLevel = 0.4f, float width = 1.0f)
+{
+    auto processor = new ReverbProcessor{name, roomSize, damping, wetLevel, dryLevel, width};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+PannerProcessor* RenderEngine::makePannerProcessor(const std::string& name, std::string& rule,
+                                                   float pan)
+{
+    float safeVal = std::clamp(pan, -1.f, 1.f);
+
+    auto processor = new PannerProcessor{name, rule, safeVal};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
+
+DelayProcessor* RenderEngine::makeDelayProcessor(const std::string& name, std::string& rule,
+                                                 float delay, float wet)
+{
+    float safeDelay = std::fmax(0.f, delay);
+
+    float safeWet = std::fmin(1.f, std::fmax(0.f, wet));
+    auto processor = new DelayProcessor{name, rule, safeDelay, safeWet};
+
+    this->prepareProcessor(processor, name);
+
+    return processor;
+}
+
+SamplerProcessor* RenderEngine::makeSamplerProcessor(const std::string& name,
+                                                     nb::ndarray<float> data)
+{
+    auto processor = new SamplerProcessor{name, data, mySampleRate, myBufferSize};
+    this->prepareProcessor(processor, name);
+    return processor;
+}
 
+#ifdef BUILD_DAWDREAMER_FAUST
+FaustProcessor* RenderEngine::makeFaustProcessor(const std::string& name)
+{
+    auto processor = new FaustProcessor{name, mySampleRate, myBufferSize};
     this->prepareProcessor(processor, name);
+    return processor;
+}
+#endif
+
+bool RenderEngine::loadGraphWrapper(nb::object dagObj)
+{
+    if (!nb::isinstance<nb::list>(dagObj))
+    {
+        throw std::runtime_error("Error: load_graph. No processors were passed.");
+    }
+
+    std::unique_ptr<DAG> buildingDag(new DAG());
+
+    for (nb::handle theTuple : dagObj)
+    { // iterators!
+
+        if (!nb::isinstance<nb::tuple>(theTuple) && !nb::isinstance<nb::list>(theTuple))
+        {
+            throw std::runtime_error("Error: load_graph. Received graph that is not a list.");
+        }
+
+        // Don't cast - both tuple and list support indexing via handle
+        auto& graphItem = theTuple;
+
+        if (nb::len(graphItem) != 2)
+        {
+            throw std::runtime_error("Error: load_graph. Each tuple in the graph must be size 2.");
+        }
+
+        // todo: enable this:
+        // if (!nb::isinstance<ProcessorBase*>(graphItem[0])) {
+        // std::cout << "Error: load_graph. First argument in tuple wasn't a
+        // Processor object." << std::endl;
+        //    return false;
+        //}
+        if (!nb::isinstance<nb::list>(graphItem[1]))
+        {
+            throw std::runtime_error(
+                "Error: load_graph. Something was wrong with the list of inputs.");
+        }
+
+        nb::handle listOfStrings = graphItem[1];
+
+        std::vector<std::string> inputs;
+
+        for (nb::handle potentialString : listOfStrings)
+        {
+            if (!nb::isinstance<nb::str>(potentialString))
+            {
+                throw std::runtime_error(
+                    "Error: load_graph. Something was wrong with the list of inputs.");
+            }
+
+            inputs.push_back(nb::cast<std::string>(potentialString));
+        }
+
+        DAGNode dagNode;
+        try
+        {
+            // In nanobind, use inst_ptr to extract a pointer to a bound C++ object
+            dagNode.processorBase = nb::inst_ptr<ProcessorBase>(graphItem[0]);
+            if (!dagNode.processorBase)
+            {
+                throw std::runtime_error(
+                    "Error: Load_graph. First argument in tuple wasn't a Processor "
+                    "object.");
+            }
+        }
+        catch (std::exception&)
+        {
+            throw std::runtime_error(
+                "Error: Load_graph. First argument in tuple wasn't a Processor "
+                "object.");
+        }
+
+        dagNode.inputs = inputs;
+
+        buildingDag->nodes.push_back(dagNode);
+    }
+
+    auto result = RenderEngine::loadGraph(*buildingDag);
+
+    // Connect the graph to populate m_connectedProcessors and prepare processors
+    // This ensures processors are ready for pickling and the graph is fully loaded
+    if (result)
+    {
+        connectGraph();
+    }
+
+    return result;
+}
+
+bool RenderEngine::connectGraph()
+{
+    m_connectedProcessors.clear();
+
+    // The connections the DAG calls for, in a deterministic order. Comparing
+    // this to the last connected graph tells us whether anything changed.
+    std::vector<AudioProcessorGraph::Connection> connections;
+    // The total input and output channels of each connected processor, since
+    // the JUCE graph sizes its buffers from them.
+    std::vector<std::pair<int, int>> channelCounts;
+    bool preparedAnyProcessor = false;
+
+    for (auto& entry : m_stringDag)
+    {
+        if (m_UniqueNameToNodeID.find(entry.first) == m_UniqueNameToNodeID.end())
+        {
+            m_stringDag.clear();
+            throw std::runtime_error(
+                "Error: Unable to find processor with unique name: " + entry.first + ".");
+        }
+
+        auto node = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[entry.first]);
+
+        auto processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
+        m_connectedProcessors.push_back(processor);
+
+        if (!processor)
+        {
+            throw std::runtime_error("Unable to cast to ProcessorBase during connectGraph.");
+        }
+
+        // Don't remove this prepareToPlay. In the case of Faust, it compiles the
+        // code. This makes the number of input/output channels correct, which we
+        // use a lines below in this function. Processors that were already
+        // connected with their current channel layout are prepared already.
+        if (processor->needsPrepareToPlay())
+        {
+            processor->prepareToPlay(mySampleRate, myBufferSize);
+            preparedAnyProcessor = true;
+        }
+
+        int numInputAudioChans = 0;
+
+        std::string myUniqueName = processor->getUniqueName();
+
+        auto inputNames = entry.second;
+
+        for (const std::string& inputName : inputNames)
+        {
+            if (m_UniqueNameToNodeID.find(inputName) == m_UniqueNameToNodeID.end())
+            {
+                m_stringDag.clear();
+                throw std::runtime_error(
+                    "Error: Unable to find processor with unique name: " + inputName + ".");
+            }
+
+            auto otherNode = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[inputName]);
+
+            numInputAudioChans += otherNode->getProcessor()->getMainBusNumOutputChannels();
+        }
+
+        int numOutputAudioChans = processor->getMainBusNumOutputChannels();
+        int expectedInputChannels = processor->getMainBusNumInputChannels();
+        if (numInputAudioChans > expectedInputChannels)
+        {
+            std::cerr << "Warning: Signals will be skipped. Processor named " << myUniqueName
+                      << " expects " << expectedInputChannels
+                      << " input signals, but you are trying to connect " << numInputAudioChans
+                      << " signals." << std::endl;
+        }
+
+        processor->setPlayConfigDetails(expectedInputChannels, numOutputAudioChans, mySampleRate,
+                                        myBufferSize);
+        channelCounts.push_back(
+            {processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels()});
+
+        int chanDest = 0;
+
+        for (const std::string& inputName : inputNames)
+        {
+            auto inputNode = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[inputName]);
+
+            auto inputProcessor = inputNode->getProcessor();
+
+            for (int chanSource = 0; chanSource < inputProcessor->getMainBusNumOutputChannels();
+                 chanSource++)
+            {
+                connections.push_back({{inputNode->nodeID, chanSource}, {node->nodeID, chanDest}});
+                chanDest++;
+            }
+        }
+
+        processor->setConnectedInGraph(true);
+    }
+
+    // Processors that aren't in the DAG (any more) stay in the JUCE graph, which
+    // would still process them. Bypass their nodes, and mark them as
+    // disconnected so they're prepared again if a later DAG brings them back.
+    // Their connections aren't wanted, so they're removed below.
+    const std::set<ProcessorBase*> connectedProcessors(m_connectedProcessors.begin(),
+                                                       m_connectedProcessors.end());
+    for (auto* node : m_mainProcessorGraph->getNodes())
+    {
+        auto* processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
+        const bool isConnected = connectedProcessors.count(processor) > 0;
+        if (processor && !isConnected)
+        {
+            processor->setConnectedInGraph(false);
+        }
+        node->setBypassed(!isConnected);
+    }
+
+    if (m_isGraphPrepared && !preparedAnyProcessor && connections == m_graphConnections &&
+        channelCounts == m_graphChannelCounts)
+    {
+        // Same nodes, channel layouts and edges as last time.
+        return true;
+    }
+
+    // Apply only the difference to the JUCE graph and rebuild its rendering
+    // sequence once at the end, instead of once per connection.
+    const auto wanted = std::set<AudioProcessorGraph::Connection>(connections.begin(),
+                                                                   connections.end());
+
+    for (auto& connection : m_mainProcessorGraph->getConnections())
+    {
+        if (wanted.find(connection) == wanted.end())
+        {
+            m_mainProcessorGraph->removeConnection(connection,
+                                                   AudioProcessorGraph::UpdateKind::none);
+        }
+    }
+
+    for (auto& connection : connections)
+    {
+        if (m_mainProcessorGraph->isConnected(connection))
+        {
+            continue;
+        }
+
+        bool result = m_mainProcessorGraph->canConnect(connection) &&
+                      m_mainProcessorGraph->addConnection(connection,
+                                                          AudioProcessorGraph::UpdateKind::none);
+        if (!result)
+        {
+            // todo: because we failed here, connectGraph should return false at
+            // the very end or immediately.
+            auto sourceName = dynamic_cast<ProcessorBase*>(
+                                  m_mainProcessorGraph->getNodeForId(connection.source.nodeID)
+                                      ->getProcessor())
+                                  ->getUniqueName();
+            auto destName = dynamic_cast<ProcessorBase*>(
+                                m_mainProcessorGraph->getNodeForId(connection.destination.nodeID)
+                                    ->getProcessor())
+                                ->getUniqueName();
+            std::cerr << "Warning: Unable to connect " << sourceName << " channel "
+                      << connection.source.channelIndex << " to " << destName << " channel "
+                      << connection.destination.channelIndex << std::endl;
+        }
+    }
+
+    m_graphConnections = std::move(connections);
+    m_graphChannelCounts = std::move(channelCounts);
+
+    // This also rebuilds the rendering sequence and prepares any new nodes.
+    m_mainProcessorGraph->setPlayConfigDetails(0, 0, mySampleRate, myBufferSize);
+    m_mainProcessorGraph->prepareToPlay(mySampleRate, myBufferSize);
+    m_isGraphPrepared = true;
+
+    return true;
+}
+
+float RenderEngine::getBPM(double ppqPosition)
+{
+    return (float)m_tempoMap.getBpmAtBeat(ppqPosition);
+}
+
+void RenderEngine::prepareProcessor(ProcessorBase* processor, const std::string& name)
+{
+    if (this->removeProcessor(name))
+    {
+        std::cerr << "Warning: a processor with the name \"" << name
+                  << "\" already exists and was removed to make room for the new "
+                     "processor."
+                  << std::endl;
+    };
+
+    auto node = m_mainProcessorGraph->addNode((std::unique_ptr<ProcessorBase>)(processor));
+    m_UniqueNameToNodeID[name] = node->nodeID;
+}
+
+int RenderEngine::buildSchedule()
+{
+    m_schedule.clear();
+
+    std::unordered_map<std::string, int> nameToIndex;
+    for (auto& entry : m_stringDag)
+    {
+        if (nameToIndex.find(entry.first) != nameToIndex.end())
+        {
+            // A processor appears twice in the DAG.
+            return 0;
+        }
+        nameToIndex[entry.first] = (int)m_schedule.size();
+
+        auto node = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[entry.first]);
+        ScheduledNode scheduledNode;
+        scheduledNode.processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
+        if (!scheduledNode.processor)
+        {
+            throw std::runtime_error("Unable to cast to ProcessorBase during render.");
+        }
+        m_schedule.push_back(std::move(scheduledNode));
+    }
+
+    const int numNodes = (int)m_schedule.size();
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        auto& node = m_schedule[i];
+        auto* processor = node.processor;
+        const int numInputs = processor->getTotalNumInputChannels();
+        const int numOutputs = processor->getTotalNumOutputChannels();
+
+        node.inputChannels.assign(numInputs, {-1, -1});
+
+        // Same channel assignment as connectGraph: the inputs' channels are
+        // stacked in order, and channels beyond numInputs are dropped.
+        int chanDest = 0;
+        for (const std::string& inputName : m_stringDag[i].second)
+        {
+            auto it = nameToIndex.find(inputName);
+            if (it == nameToIndex.end())
+            {
+                // The input is a processor that isn't part of the DAG, which
+                // only the JUCE graph processes.
+                return 0;
+            }
+
+            const int inputIndex = it->second;
+            auto* inputProcessor = m_schedule[inputIndex].processor;
+
+            for (int chanSource = 0; chanSource < inputProcessor->getMainBusNumOutputChannels();
+                 chanSource++)
+            {
+                if (chanDest < numInputs)
+                {
+                    node.inputChannels[chanDest] = {inputIndex, chanSource};
+                }
+                chanDest++;
+            }
+
+            auto& inputDependents = m_schedule[inputIndex].dependents;
+            if (std::find(inputDependents.begin(), inputDependents.end(), i) ==
+                inputDependents.end())
+            {
+                inputDependents.push_back(i);
+                node.numDependencies++;
+            }
+        }
+
+        node.midiBuffer.ensureSize(2048);
+
+        processor->setPlayHead(this);
+    }
+
+    // Topological levels (Kahn's algorithm). A node's level is one more than
+    // the deepest of its inputs, so nodes on the same level never depend on
+    // each other.
+    std::vector<int> remaining(numNodes);
+    std::queue<int> ready;
+    for (int i = 0; i < numNodes; i++)
+    {
+        remaining[i] = m_schedule[i].numDependencies;
+        if (remaining[i] == 0)
+        {
+            ready.push(i);
+        }
+    }
+
+    m_scheduleOrder.clear();
+    std::vector<int> levelWidths;
+    while (!ready.empty())
+    {
+        const int i = ready.front();
+        ready.pop();
+        m_scheduleOrder.push_back(i);
+
+        const int level = m_schedule[i].level;
+        if ((int)levelWidths.size() <= level)
+        {
+            levelWidths.resize(level + 1, 0);
+        }
+        levelWidths[level]++;
+
+        for (int dependent : m_schedule[i].dependents)
+        {
+            m_schedule[dependent].level = std::max(m_schedule[dependent].level, level + 1);
+            if (--remaining[dependent] == 0)
+            {
+                ready.push(dependent);
+            }
+        }
+    }
+
+    if ((int)m_scheduleOrder.size() != numNodes)
+    {
+        // The DAG has a cycle. The JUCE graph refuses those connections, so
+        // leave it to the JUCE graph.
+        return 0;
+    }
+
+    m_pendingDependencies = std::make_unique<std::atomic<int>[]>(numNodes);
+    m_readyNodes = std::make_unique<std::atomic<int>[]>(numNodes);
+
+    return *std::max_element(levelWidths.begin(), levelWidths.end());
+}
+
+void RenderEngine::planScheduleBuffers(bool isSerial)
+{
+    const int numNodes = (int)m_schedule.size();
+
+    // ancestors[i][j] is true if node j always finishes before node i starts.
+    // In a serial schedule, that's every node before i in the order. In a
+    // parallel one, it's only the nodes that i depends on, because the threads
+    // may pick up independent nodes in any order.
+    std::vector<std::vector<bool>> ancestors(numNodes, std::vector<bool>(numNodes, false));
+    for (int position = 0; position < numNodes; position++)
+    {
+        const int i = m_scheduleOrder[position];
+        if (isSerial)
+        {
+            for (int j = 0; j < position; j++)
+            {
+                ancestors[i][m_scheduleOrder[j]] = true;
+            }
+            continue;
+        }
+
+        for (int dependent : m_schedule[i].dependents)
+        {
+            auto& dependentAncestors = ancestors[dependent];
+            dependentAncestors[i] = true;
+            for (int j = 0; j < numNodes; j++)
+            {
+                if (ancestors[i][j])
+                {
+                    dependentAncestors[j] = true;
+                }
+            }
+        }
+    }
+
+    // Walk the nodes in topological order and give each one a buffer whose
+    // current owner is dead: the owner and everything that reads its output
+    // have finished before the node can start. Otherwise add a buffer to the
+    // pool.
+    std::vector<int> owners;
+    std::vector<int> numChannels;
+    for (int i : m_scheduleOrder)
+    {
+        auto& node = m_schedule[i];
+        const int nodeChannels = std::max(node.processor->getTotalNumInputChannels(),
+                                          node.processor->getTotalNumOutputChannels());
+
+        auto isDead = [&](int owner)
+        {
+            if (!ancestors[i][owner])
+            {
+                return false;
+            }
+            for (int dependent : m_schedule[owner].dependents)
+            {
+                if (!ancestors[i][dependent])
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        node.bufferIndex = -1;
+        for (int b = 0; b < (int)owners.size(); b++)
+        {
+            if (isDead(owners[b]))
+            {
+                node.bufferIndex = b;
+                break;
+            }
+        }
+
+        if (node.bufferIndex < 0)
+        {
+            node.bufferIndex = (int)owners.size();
+            owners.push_back(i);
+            numChannels.push_back(nodeChannels);
+        }
+        else
+        {
+            owners[node.bufferIndex] = i;
+            numChannels[node.bufferIndex] =
+                std::max(numChannels[node.bufferIndex], nodeChannels);
+        }
+    }
+
+    m_scheduleBuffers.resize(owners.size());
+    for (size_t b = 0; b < owners.size(); b++)
+    {
+        m_scheduleBuffers[b].setSize(numChannels[b], myBufferSize);
+    }
+}
+
+void RenderEngine::pushReadyNode(int nodeIndex)
+{
+    const int slot = m_readyTail.fetch_add(1, std::memory_order_relaxed);
+    m_readyNodes[slot].store(nodeIndex, std::memory_order_release);
+}
+
+void RenderEngine::processScheduledBlock(int numSamples, bool automate)
+{
+    if (m_isScheduleSerial)
+    {
+        for (int nodeIndex : m_scheduleOrder)
+        {
+            processScheduledNode(nodeIndex, numSamples, automate);
+        }
+        return;
+    }
+
+    const int numNodes = (int)m_schedule.size();
+
+    m_readyHead.store(0, std::memory_order_relaxed);
+    m_readyTail.store(0, std::memory_order_relaxed);
+    m_scheduleException = nullptr;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        m_pendingDependencies[i].store(m_schedule[i].numDependencies, std::memory_order_relaxed);
+        m_readyNodes[i].store(-1, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        if (m_schedule[i].numDependencies == 0)
+        {
+            pushReadyNode(i);
+        }
+    }
+
+    // Every node is pushed to the ready list exactly once per block, so each
+    // thread claims slots until all of them have been claimed. A thread that
+    // claims a slot before its node is ready waits for it, which only happens
+    // while another thread is finishing one of that node's inputs. There is
+    // no barrier between levels: a node starts as soon as its own inputs are
+    // done.
+    m_threadPool->run(
+        [this, numNodes, numSamples, automate]()
+        {
+            while (true)
+            {
+                const int slot = m_readyHead.fetch_add(1, std::memory_order_relaxed);
+                if (slot >= numNodes)
+                {
+                    return;
+                }
+
+                int nodeIndex;
+                while ((nodeIndex = m_readyNodes[slot].load(std::memory_order_acquire)) < 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                try
+                {
+                    processScheduledNode(nodeIndex, numSamples, automate);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_scheduleExceptionMutex);
+                    if (!m_scheduleException)
+                    {
+                        m_scheduleException = std::current_exception();
+                    }
+                }
+
+                // Release the dependents even if this node failed, so that
+                // the other threads don't wait forever.
+                for (int dependent : m_schedule[nodeIndex].dependents)
+                {
+                    if (m_pendingDependencies[dependent].fetch_sub(
+                            1, std::memory_order_acq_rel) == 1)
+                    {
+                        pushReadyNode(dependent);
+                    }
+                }
+            }
+        });
 
-    return processor;
+    if (m_scheduleException)
+    {
+        std::rethrow_exception(m_scheduleException);
+    }
 }
 
-SamplerProcessor* RenderEngine::makeSamplerProcessor(const std::string& name,
-                                                     nb::ndarray<float> data)
+namespace
 {
-    auto processor = new SamplerProcessor{name, data, mySampleRate, myBufferSize};
-    this->prepareProcessor(processor, name);
-    return processor;
-}
+// Output below -120 dBFS counts as silence when skipping silent processors.
+constexpr float silenceThreshold = 1e-6f;
+} // namespace
 
-#ifdef BUILD_DAWDREAMER_FAUST
-FaustProcessor* RenderEngine::makeFaustProcessor(const std::string& name)
+void RenderEngine::processScheduledNode(int nodeIndex, int numSamples, bool automate)
 {
-    auto processor = new FaustProcessor{name, mySampleRate, myBufferSize};
-    this->prepareProcessor(processor, name);
-    return processor;
-}
-#endif
+    auto& node = m_schedule[nodeIndex];
+    auto* processor = node.processor;
 
-bool RenderEngine::loadGraphWrapper(nb::object dagObj)
-{
-    if (!nb::isinstance<nb::list>(dagObj))
+    if (!node.isOutputNeeded)
     {
-        throw std::runtime_error("Error: load_graph. No processors were passed.");
+        return;
     }
 
-    std::unique_ptr<DAG> buildingDag(new DAG());
-
-    for (nb::handle theTuple : dagObj)
-    { // iterators!
+    auto& buffer = m_scheduleBuffers[node.bufferIndex];
+    const int numChannels = std::max(processor->getTotalNumInputChannels(),
+                                     processor->getTotalNumOutputChannels());
 
-        if (!nb::isinstance<nb::tuple>(theTuple) && !nb::isinstance<nb::list>(theTuple))
+    if (node.cachedOutput)
+    {
+        const auto& cached = *node.cachedOutput;
+        const int64_t position = *m_positionInfo.getTimeInSamples() - m_nodeCacheStartSample;
+        const bool isInCache = m_positionInfo.getIsPlaying() && position >= 0 &&
+                               position + numSamples <= cached.getNumSamples();
+        for (int chan = 0; chan < numChannels; chan++)
         {
-            throw std::runtime_error("Error: load_graph. Received graph that is not a list.");
+            if (isInCache && chan < cached.getNumChannels())
+            {
+                buffer.copyFrom(chan, 0, cached, chan, (int)position, numSamples);
+            }
+            else
+            {
+                buffer.clear(chan, 0, numSamples);
+            }
         }
 
-        // Don't cast - both tuple and list support indexing via handle
-        auto& graphItem = theTuple;
+        // Record the block like the processor would have.
+        juce::AudioSampleBuffer block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+        processor->ProcessorBase::processBlock(block, node.midiBuffer);
+        node.isOutputSilent = false;
+        return;
+    }
 
-        if (nb::len(graphItem) != 2)
+    if (automate)
+    {
+        processor->automateParameters(m_positionInfo, numSamples);
+        processor->recordAutomation(m_positionInfo, numSamples);
+    }
+
+    if (m_skipSilence && canSkipScheduledNode(node, numSamples))
+    {
+        // The recording was cleared when the render began, so it already
+        // holds silence for this block.
+        for (int chan = 0; chan < numChannels; chan++)
         {
-            throw std::runtime_error("Error: load_graph. Each tuple in the graph must be size 2.");
+            buffer.clear(chan, 0, numSamples);
         }
-
-        // todo: enable this:
-        // if (!nb::isinstance<ProcessorBase*>(graphItem[0])) {
-        // std::cout << "Error: load_graph. First argument in tuple wasn't a
-        // Processor object." << std::endl;
-        //    return false;
-        //}
-        if (!nb::isinstance<nb::list>(graphItem[1]))
+        node.isOutputSilent = true;
+        m_numSkippedBlocks.fetch_add(1, std::memory_order_relaxed);
+        captureScheduledOutput(node, buffer, numSamples);
+        return;
+    }
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        if (chan < (int)node.inputChannels.size() && node.inputChannels[chan].first >= 0)
         {
-            throw std::runtime_error(
-                "Error: load_graph. Something was wrong with the list of inputs.");
+            const auto& [inputIndex, inputChan] = node.inputChannels[chan];
+            const auto& inputBuffer = m_scheduleBuffers[m_schedule[inputIndex].bufferIndex];
+            buffer.copyFrom(chan, 0, inputBuffer, inputChan, 0, numSamples);
+        }
+        else
+        {
+            buffer.clear(chan, 0, numSamples);
         }
+    }
 
-        nb::handle listOfStrings = graphItem[1];
+    node.midiBuffer.clear();
 
-        std::vector<std::string> inputs;
+    juce::AudioSampleBuffer block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
 
-        for (nb::handle potentialString : listOfStrings)
+    // Match juce::AudioProcessorGraph's handling of each node.
+    const juce::ScopedLock lock(processor->getCallbackLock());
+    if (processor->isSuspended())
+    {
+        block.clear();
+    }
+    else
+    {
+        processor->processBlock(block, node.midiBuffer);
+    }
+
+    if (m_skipSilence)
+    {
+        node.isOutputSilent = true;
+        for (int chan = 0; chan < processor->getTotalNumOutputChannels(); chan++)
         {
-            if (!nb::isinstance<nb::str>(potentialString))
+            if (block.getMagnitude(chan, 0, numSamples) > silenceThreshold)
             {
-                throw std::runtime_error(
-                    "Error: load_graph. Something was wrong with the list of inputs.");
+                node.isOutputSilent = false;
+                break;
             }
-
-            inputs.push_back(nb::cast<std::string>(potentialString));
         }
+    }
 
-        DAGNode dagNode;
-        try
+    captureScheduledOutput(node, buffer, numSamples);
+}
+
+void RenderEngine::hashScheduledNodes(int64_t startSample, int64_t numSamples)
+{
+    m_nodeCacheStartSample = startSample;
+
+    // Whole blocks are processed, so the outputs cover the last partial one.
+    const int numCachedSamples =
+        (int)((numSamples + myBufferSize - 1) / myBufferSize * myBufferSize);
+    m_numNodeCacheSamples = numCachedSamples;
+
+    ConfigurationHasher renderHasher;
+    renderHasher.add(mySampleRate);
+    renderHasher.add(myBufferSize);
+    renderHasher.add(m_automationBlockSize);
+    renderHasher.add(m_skipSilence);
+    renderHasher.add(m_adaptiveBlocks);
+    renderHasher.add(m_BPM_PPQN);
+    renderHasher.add(m_bpmAutomation);
+    renderHasher.add(m_bpmRamp);
+    renderHasher.add(startSample);
+    renderHasher.add(numCachedSamples);
+
+    for (int nodeIndex : m_scheduleOrder)
+    {
+        auto& node = m_schedule[nodeIndex];
+        ConfigurationHasher hasher = renderHasher;
+        node.isCacheable = node.processor->getConfigurationHash(hasher);
+        for (const auto& [inputIndex, inputChan] : node.inputChannels)
         {
-            // In nanobind, use inst_ptr to extract a pointer to a bound C++ object
-            dagNode.processorBase = nb::inst_ptr<ProcessorBase>(graphItem[0]);
-            if (!dagNode.processorBase)
+            if (inputIndex >= 0)
             {
-                throw std::runtime_error(
-                    "Error: Load_graph. First argument in tuple wasn't a Processor "
-                    "object.");
+                node.isCacheable = node.isCacheable && m_schedule[inputIndex].isCacheable;
+                hasher.add(m_schedule[inputIndex].cacheKey);
             }
+            hasher.add(inputChan);
         }
-        catch (std::exception&)
+        node.cacheKey = hasher.getHash();
+    }
+}
+
+void RenderEngine::planNodeCache()
+{
+    const int numCachedSamples = m_numNodeCacheSamples;
+
+    for (int nodeIndex : m_scheduleOrder)
+    {
+        auto& node = m_schedule[nodeIndex];
+
+        // Recorded automation would be missing from a cached node.
+        if (!node.isCacheable || node.processor->getRecordAutomationEnable())
         {
-            throw std::runtime_error(
-                "Error: Load_graph. First argument in tuple wasn't a Processor "
-                "object.");
+            continue;
         }
 
-        dagNode.inputs = inputs;
-
-        buildingDag->nodes.push_back(dagNode);
+        auto it = m_nodeCacheIndex.find(node.cacheKey);
+        if (it != m_nodeCacheIndex.end())
+        {
+            m_nodeCache.splice(m_nodeCache.begin(), m_nodeCache, it->second);
+            node.cachedOutput = it->second->audio;
+        }
     }
 
-    auto result = RenderEngine::loadGraph(*buildingDag);
-
-    // Connect the graph to populate m_connectedProcessors and prepare processors
-    // This ensures processors are ready for pickling and the graph is fully loaded
-    if (result)
+    // A node's output is needed if it's a sink, it's recorded, or a node that
+    // will be processed reads it.
+    for (auto it = m_scheduleOrder.rbegin(); it != m_scheduleOrder.rend(); ++it)
     {
-        connectGraph();
+        auto& node = m_schedule[*it];
+        node.isOutputNeeded = node.dependents.empty() || node.processor->getRecordEnable() ||
+                              node.processor->getRecordAutomationEnable();
+        for (int dependent : node.dependents)
+        {
+            const auto& dependentNode = m_schedule[dependent];
+            if (dependentNode.isOutputNeeded && !dependentNode.cachedOutput)
+            {
+                node.isOutputNeeded = true;
+            }
+        }
+        if (node.isOutputNeeded && node.cachedOutput)
+        {
+            m_numNodeCacheHits++;
+        }
     }
 
-    return result;
+    size_t numCapturedBytes = 0;
+    for (int nodeIndex : m_scheduleOrder)
+    {
+        auto& node = m_schedule[nodeIndex];
+        if (!node.isCacheable || !node.isOutputNeeded || node.cachedOutput)
+        {
+            continue;
+        }
+        const int numChannels = node.processor->getTotalNumOutputChannels();
+        const size_t numBytes = (size_t)numChannels * (size_t)numCachedSamples * sizeof(float);
+        if (numCapturedBytes + numBytes <= m_nodeCacheMaxBytes)
+        {
+            node.capturedOutput =
+                std::make_shared<juce::AudioSampleBuffer>(numChannels, numCachedSamples);
+            numCapturedBytes += numBytes;
+        }
+    }
 }
 
-bool RenderEngine::connectGraph()
+void RenderEngine::captureScheduledOutput(ScheduledNode& node,
+                                          const juce::AudioSampleBuffer& buffer, int numSamples)
 {
-    // remove all connections
-    for (auto& connection : m_mainProcessorGraph->getConnections())
+    if (!node.capturedOutput || !m_positionInfo.getIsPlaying())
     {
-        m_mainProcessorGraph->removeConnection(connection);
+        return;
     }
 
-    m_connectedProcessors.clear();
+    auto& captured = *node.capturedOutput;
+    const int64_t position = *m_positionInfo.getTimeInSamples() - m_nodeCacheStartSample;
+    if (position < 0 || position + numSamples > captured.getNumSamples())
+    {
+        return;
+    }
 
-    for (auto& entry : m_stringDag)
+    for (int chan = 0; chan < captured.getNumChannels(); chan++)
     {
-        if (m_UniqueNameToNodeID.find(entry.first) == m_UniqueNameToNodeID.end())
+        captured.copyFrom(chan, (int)position, buffer, chan, 0, numSamples);
+    }
+}
+
+void RenderEngine::storeNodeCache()
+{
+    for (auto& node : m_schedule)
+    {
+        if (!node.capturedOutput)
         {
-            m_stringDag.clear();
-            throw std::runtime_error(
-                "Error: Unable to find processor with unique name: " + entry.first + ".");
+            continue;
         }
 
-        auto node = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[entry.first]);
-
-        auto processor = dynamic_cast<ProcessorBase*>(node->getProcessor());
-        m_connectedProcessors.push_back(processor);
-
-        if (!processor)
+        auto captured = std::move(node.capturedOutput);
+        // The render could have stopped early (see RenderStream).
+        if (*m_positionInfo.getTimeInSamples() - m_nodeCacheStartSample <
+                captured->getNumSamples() ||
+            m_nodeCacheIndex.find(node.cacheKey) != m_nodeCacheIndex.end())
         {
-            throw std::runtime_error("Unable to cast to ProcessorBase during connectGraph.");
+            continue;
         }
 
-        // Don't remove this prepareToPlay. In the case of Faust, it compiles the
-        // code. This makes the number of input/output channels correct, which we
-        // use a lines below in this function.
-        processor->prepareToPlay(mySampleRate, myBufferSize);
+        m_nodeCache.push_front({node.cacheKey, captured});
+        m_nodeCacheIndex[node.cacheKey] = m_nodeCache.begin();
+        m_nodeCacheBytes +=
+            (size_t)captured->getNumChannels() * (size_t)captured->getNumSamples() * sizeof(float);
+    }
 
-        int numInputAudioChans = 0;
+    trimNodeCache();
+}
 
-        std::string myUniqueName = processor->getUniqueName();
+bool RenderEngine::canSkipScheduledNode(ScheduledNode& node, int numSamples)
+{
+    auto* processor = node.processor;
 
-        auto inputNames = entry.second;
+    // The block that sends note-offs at the end of a render always runs.
+    if (!processor->isSilentWithoutInput() || !m_positionInfo.getIsPlaying())
+    {
+        return false;
+    }
 
-        for (const std::string& inputName : inputNames)
+    bool isActive = false;
+    for (const auto& [inputIndex, inputChan] : node.inputChannels)
+    {
+        if (inputIndex >= 0 && !m_schedule[inputIndex].isOutputSilent)
         {
-            if (m_UniqueNameToNodeID.find(inputName) == m_UniqueNameToNodeID.end())
-            {
-                m_stringDag.clear();
-                throw std::runtime_error(
-                    "Error: Unable to find processor with unique name: " + inputName + ".");
-            }
-
-            auto otherNode = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[inputName]);
+            isActive = true;
+            break;
+        }
+    }
 
-            numInputAudioChans += otherNode->getProcessor()->getMainBusNumOutputChannels();
+    auto countEvent = [&node](const juce::MidiMessage& message)
+    {
+        if (message.isNoteOn())
+        {
+            node.numHeldNotes++;
         }
+        else if (message.isNoteOff())
+        {
+            node.numHeldNotes = std::max(0, node.numHeldNotes - 1);
+        }
+        else if (message.isAllNotesOff() || message.isAllSoundOff())
+        {
+            node.numHeldNotes = 0;
+        }
+        else if (message.isSustainPedalOn() || message.isSustainPedalOff())
+        {
+            node.isSustained = message.isSustainPedalOn();
+        }
+    };
 
-        int numOutputAudioChans = processor->getMainBusNumOutputChannels();
-        int expectedInputChannels = processor->getMainBusNumInputChannels();
-        if (numInputAudioChans > expectedInputChannels)
+    // Count each event once by scanning from where the previous block's scan
+    // ended. Processors round block boundaries in their own way, so events
+    // just around the block also keep the node active.
+    const int64_t start = *m_positionInfo.getTimeInSamples();
+    const int64_t end = start + numSamples;
+    if (auto* midiBuffer = processor->getMidiBufferSec())
+    {
+        for (auto it = midiBuffer->findNextSamplePosition((int)node.nextMidiSample);
+             it != midiBuffer->cend() && (*it).samplePosition < end; ++it)
         {
-            std::cerr << "Warning: Signals will be skipped. Processor named " << myUniqueName
-                      << " expects " << expectedInputChannels
-                      << " input signals, but you are trying to connect " << numInputAudioChans
-                      << " signals." << std::endl;
+            countEvent((*it).getMessage());
+            isActive = true;
         }
+        node.nextMidiSample = std::max(node.nextMidiSample, end);
+    }
 
-        processor->setPlayConfigDetails(expectedInputChannels, numOutputAudioChans, mySampleRate,
-                                        myBufferSize);
+    if (auto* midiBuffer = processor->getMidiBufferQN())
+    {
+        const double ppq = *m_positionInfo.getPpqPosition();
+        const double ppqStep = numSamples * *m_positionInfo.getBpm() / (mySampleRate * 60.);
+        const int64_t pulseStart = (int64_t)std::floor(ppq * ProcessorBase::PPQN);
+        const int64_t pulseEnd = (int64_t)std::ceil((ppq + ppqStep) * ProcessorBase::PPQN);
+
+        for (auto it = midiBuffer->findNextSamplePosition(
+                 (int)std::min(node.nextMidiPulse, pulseStart));
+             it != midiBuffer->cend() && (*it).samplePosition <= pulseEnd; ++it)
+        {
+            if ((*it).samplePosition >= node.nextMidiPulse && (*it).samplePosition < pulseEnd)
+            {
+                countEvent((*it).getMessage());
+            }
+            isActive = true;
+        }
+        node.nextMidiPulse = std::max(node.nextMidiPulse, pulseEnd);
+    }
 
-        int chanDest = 0;
+    if (isActive || node.numHeldNotes > 0 || node.isSustained)
+    {
+        const double tailSamples = processor->getTailLengthSeconds() * mySampleRate;
+        node.activeUntilSample = tailSamples < 1e12 ? end + (int64_t)std::ceil(tailSamples)
+                                                    : std::numeric_limits<int64_t>::max();
+        return false;
+    }
 
-        for (const std::string& inputName : inputNames)
-        {
-            auto inputNode = m_mainProcessorGraph->getNodeForId(m_UniqueNameToNodeID[inputName]);
+    return start >= node.activeUntilSample && node.isOutputSilent;
+}
 
-            auto inputProcessor = inputNode->getProcessor();
+//==============================================================================
+namespace
+{
+const char renderCacheMagic[8] = {'D', 'D', 'R', 'E', 'N', 'D', 'E', 'R'};
+const std::uint32_t renderCacheVersion = 1;
+const char* renderCacheExtension = ".ddrender";
+} // namespace
+
+RenderCache::RenderCache(const std::string& directory, double maxMegabytes)
+    : m_directory{juce::File::getCurrentWorkingDirectory().getChildFile(directory)},
+      m_maxBytes{(juce::int64)(maxMegabytes * 1024. * 1024.)}
+{
+    if (!m_directory.createDirectory())
+    {
+        throw std::runtime_error("Unable to create the render cache directory: " + directory);
+    }
 
-            for (int chanSource = 0; chanSource < inputProcessor->getMainBusNumOutputChannels();
-                 chanSource++)
-            {
-                AudioProcessorGraph::Connection connection = {{inputNode->nodeID, chanSource},
-                                                              {node->nodeID, chanDest}};
+    for (const auto& entry : juce::RangedDirectoryIterator(
+             m_directory, false, juce::String("*") + renderCacheExtension))
+    {
+        m_sizeBytes += entry.getFileSize();
+    }
+    evict();
+}
 
-                bool result = m_mainProcessorGraph->canConnect(connection) &&
-                              m_mainProcessorGraph->addConnection(connection);
-                if (!result)
-                {
-                    // todo: because we failed here, connectGraph should return false at
-                    // the very end or immediately.
-                    std::cerr << "Warning: Unable to connect " << inputName << " channel "
-                              << chanSource << " to " << myUniqueName << " channel " << chanDest
-                              << std::endl;
-                    // return false;
-                }
+juce::File RenderCache::getFile(std::uint64_t key) const
+{
+    const auto name = juce::String::toHexString((juce::int64)key).paddedLeft('0', 16);
+    return m_directory.getChildFile(name + renderCacheExtension);
+}
 
-                chanDest++;
-            }
-        }
+bool RenderCache::load(std::uint64_t key, ProcessorBase& processor)
+{
+    const auto& recording = processor.getRecordBuffer();
+    const auto file = getFile(key);
+
+    // Map the file instead of reading it. The recording refers to the mapping,
+    // so the audio isn't copied at all.
+    auto mapped =
+        std::make_shared<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const auto numDataBytes =
+        (size_t)recording.getNumChannels() * (size_t)recording.getNumSamples() * sizeof(float);
+    if (mapped->getData() == nullptr || mapped->getSize() != sizeof(Header) + numDataBytes)
+    {
+        m_numMisses++;
+        return false;
+    }
 
-        processor->setConnectedInGraph(true);
+    Header header;
+    std::memcpy(&header, mapped->getData(), sizeof(Header));
+    if (std::memcmp(header.magic, renderCacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != renderCacheVersion || header.key != key ||
+        header.numChannels != (std::uint32_t)recording.getNumChannels() ||
+        header.numSamples != recording.getNumSamples())
+    {
+        m_numMisses++;
+        return false;
     }
 
-    m_mainProcessorGraph->setPlayConfigDetails(0, 0, mySampleRate, myBufferSize);
-    m_mainProcessorGraph->prepareToPlay(mySampleRate, myBufferSize);
+    const auto* data = static_cast<const char*>(mapped->getData()) + sizeof(Header);
+    processor.loadRecording(mapped, reinterpret_cast<const float*>(data));
 
+    // Mark the file as recently used.
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+    m_numHits++;
     return true;
 }
 
-float RenderEngine::getBPM(double ppqPosition)
+void RenderCache::store(std::uint64_t key, const juce::AudioSampleBuffer& audio)
 {
-    int index = int(m_BPM_PPQN * ppqPosition);
-    index = std::min(m_bpmAutomation.getNumSamples() - 1, index);
-
-    auto bpm = m_bpmAutomation.getSample(0, index);
+    Header header;
+    std::memcpy(header.magic, renderCacheMagic, sizeof(header.magic));
+    header.version = renderCacheVersion;
+    header.numChannels = (std::uint32_t)audio.getNumChannels();
+    header.key = key;
+    header.numSamples = audio.getNumSamples();
+
+    // Write to a temporary file first so that other processes sharing the
+    // directory never read a partial file.
+    const auto file = getFile(key);
+    juce::TemporaryFile tempFile(file);
+    {
+        juce::FileOutputStream stream(tempFile.getFile());
+        if (!stream.openedOk() || !stream.write(&header, sizeof(Header)))
+        {
+            return;
+        }
+        for (int chan = 0; chan < audio.getNumChannels(); chan++)
+        {
+            if (!stream.write(audio.getReadPointer(chan),
+                              (size_t)audio.getNumSamples() * sizeof(float)))
+            {
+                return;
+            }
+        }
+    }
+    if (!tempFile.overwriteTargetFileWithTemporary())
+    {
+        return;
+    }
 
-    return bpm;
+    m_sizeBytes += file.getSize();
+    if (m_sizeBytes > m_maxBytes)
+    {
+        evict();
+    }
 }
 
-void RenderEngine::prepareProcessor(ProcessorBase* processor, const std::string& name)
+void RenderCache::evict()
 {
-    if (this->removeProcessor(name))
+    // Other processes may have added or deleted files, so start from the
+    // directory's actual contents.
+    std::vector<std::pair<juce::Time, juce::File>> files;
+    m_sizeBytes = 0;
+    for (const auto& entry : juce::RangedDirectoryIterator(
+             m_directory, false, juce::String("*") + renderCacheExtension))
     {
-        std::cerr << "Warning: a processor with the name \"" << name
-                  << "\" already exists and was removed to make room for the new "
-                     "processor."
-                  << std::endl;
-    };
+        files.emplace_back(entry.getModificationTime(), entry.getFile());
+        m_sizeBytes += entry.getFileSize();
+    }
+    if (m_sizeBytes <= m_maxBytes)
+    {
+        return;
+    }
 
-    auto node = m_mainProcessorGraph->addNode((std::unique_ptr<ProcessorBase>)(processor));
-    m_UniqueNameToNodeID[name] = node->nodeID;
+    std::sort(files.begin(), files.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    const auto targetBytes = m_maxBytes / 10 * 9;
+    for (const auto& [time, file] : files)
+    {
+        if (m_sizeBytes <= targetBytes)
+        {
+            break;
+        }
+        const auto size = file.getSize();
+        if (file.deleteFile())
+        {
+            m_sizeBytes -= size;
+        }
+    }
 }
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <exception>
 #include <iomanip>
+#include <list>
 #include <random>
 #include <sstream>
 #include <string>
@@ -21,6 +24,7 @@
 #include "PlaybackWarpProcessor.h"
 #include "PluginProcessor.h"
 #include "ProcessorBase.h"
+#include "RenderThreadPool.h"
 #include "ReverbProcessor.h"
 #include "SamplerProcessor.h"
 
@@ -37,6 +41,50 @@ class DAG
     std::vector<DAGNode> nodes;
 };
 
+class RenderStream;
+
+// A directory of rendered audio that processes can share (see
+// RenderEngine::setRenderCache). Each file holds the last processor's
+// recording from one render and is named after the render's hash. The least
+// recently used files are deleted to keep the directory within its size.
+class RenderCache
+{
+  public:
+    RenderCache(const std::string& directory, double maxMegabytes);
+
+    // Make the processor's recording a read-only view of the file stored under
+    // `key` and return true, if there is one with the right shape.
+    bool load(std::uint64_t key, ProcessorBase& processor);
+    void store(std::uint64_t key, const juce::AudioSampleBuffer& audio);
+
+    std::string getDirectory() const { return m_directory.getFullPathName().toStdString(); }
+    double getMaxMegabytes() const { return m_maxBytes / (1024. * 1024.); }
+    int getNumHits() const { return m_numHits; }
+    int getNumMisses() const { return m_numMisses; }
+    // The size of the directory as of the last scan plus the files stored since.
+    juce::int64 getSizeBytes() const { return m_sizeBytes; }
+
+  private:
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t numChannels;
+        std::uint64_t key;
+        std::int64_t numSamples;
+    };
+
+    juce::File getFile(std::uint64_t key) const;
+    // Delete the oldest files until the directory is below 90% of its size.
+    void evict();
+
+    juce::File m_directory;
+    juce::int64 m_maxBytes;
+    juce::int64 m_sizeBytes = 0;
+    int m_numHits = 0;
+    int m_numMisses = 0;
+};
+
 class RenderEngine : public AudioPlayHead
 {
   public:
@@ -46,17 +94,130 @@ class RenderEngine : public AudioPlayHead
 
     bool removeProcessor(const std::string& name);
 
-    bool render(const double renderLength, bool isBeats);
+    // Render `renderLength` from `start` (both in beats if `isBeats`). Rendering
+    // begins `preroll` seconds before `start` to warm up the processors, but
+    // only the window from `start` on is recorded. MIDI notes held at the
+    // start of the render are chased (see MidiBufferCursor).
+    //
+    // With `autoTail`, rendering continues after the window until the last
+    // processor's output has stayed below `tailThresholdDb` for a moment (and
+    // at least as long as the longest getTailLengthSeconds() in the graph),
+    // but for no more than `maxTail` seconds. The recordings are then trimmed
+    // to end where the output last rose above the threshold.
+    bool render(const double renderLength, bool isBeats, double start = 0.,
+                double preroll = 0., bool autoTail = false, float tailThresholdDb = -90.f,
+                double maxTail = 10.);
+
+    // Render in chunks of `chunkSamples`, yielding each chunk of the last
+    // processor's output as it's produced (see RenderStream).
+    RenderStream* renderStream(const double renderLength, int chunkSamples, bool isBeats);
 
     int64_t getRenderLength(const double renderLength, bool isBeats);
 
-    void setBPM(double bpm);
+    // Render the loaded graph and write the last processor's output directly
+    // into `output`, a writable C-contiguous float32 array shaped
+    // (channels, samples). Returns the number of samples written.
+    int64_t renderInto(nb::ndarray<float> output, const double renderLength, bool isBeats);
 
-    bool setBPMwithPPQN(nb::ndarray<nb::numpy, float> input, std::uint32_t ppqn);
+    // Render the loaded graph once per variant and return the last processor's
+    // audio stacked as (variants, channels, samples). Each variant is a dict
+    // mapping processor names to parameter and MIDI overrides. The overrides
+    // only apply to their own variant; the processors are restored afterward.
+    // With `numWorkers` above 1 (0 for one per core), variants render in
+    // parallel, each worker after the first on a clone of this engine.
+    nb::ndarray<nb::numpy, float> renderBatch(nb::list variants, const double renderLength,
+                                              bool isBeats, int numWorkers = 1);
 
-    nb::ndarray<nb::numpy, float> getAudioFrames();
+    void setBPM(double bpm);
 
-    nb::ndarray<nb::numpy, float> getAudioFramesForName(std::string& name);
+    // Sets the tempo with `ppqn` BPM values per quarter note. Each value holds
+    // until the next one, or with `ramp` changes linearly towards it.
+    bool setBPMwithPPQN(nb::ndarray<nb::numpy, float> input, std::uint32_t ppqn,
+                        bool ramp = false);
+
+    nb::object getAudioFrames();
+
+    nb::object getAudioFramesForName(std::string& name);
+
+    nb::object detachAudioFrames();
+
+    nb::object detachAudioFramesForName(std::string& name);
+
+    // The number of threads used to process independent branches of the graph.
+    // With 1 (the default), the graph is rendered on the calling thread by the
+    // executor chosen with setExecutor. With more than 1, RenderEngine
+    // schedules the nodes itself and processes nodes whose inputs are ready
+    // concurrently. 0 means one thread per hardware core.
+    void setNumThreads(int numThreads);
+    int getNumThreads() const { return m_numThreads; }
+
+    // The number of samples between automation updates within a block for
+    // processors that support it (built-in filters and compressors and
+    // non-polyphonic Faust). 0, the default, updates automation once per block,
+    // at the block's start.
+    void setAutomationBlockSize(int numSamples);
+    int getAutomationBlockSize() const { return m_automationBlockSize; }
+
+    // How the DAG is executed. "graph" (the default) renders with
+    // juce::AudioProcessorGraph. "flat" compiles the DAG into a topologically
+    // ordered list of nodes with precomputed channel mappings and runs it
+    // directly, processing only the processors in the DAG. Graphs that the
+    // flat plan can't express fall back to the JUCE graph.
+    void setExecutor(const std::string& executor);
+    std::string getExecutor() const { return m_useFlatPlan ? "flat" : "graph"; }
+
+    // When enabled, processors that are silent without input (see
+    // ProcessorBase::isSilentWithoutInput) aren't processed while their inputs
+    // are silent, they have no MIDI to play, their tail has passed and their
+    // last output was silent. Their output is zeros instead. This renders with
+    // the flat plan (see setExecutor).
+    void setSkipSilence(bool skipSilence) { m_skipSilence = skipSilence; }
+    bool getSkipSilence() const { return m_skipSilence; }
+    // The number of blocks, summed over all processors, that the last render
+    // didn't process because of silence skipping.
+    int64_t getNumSkippedBlocks() const { return m_numSkippedBlocks.load(); }
+
+    // When enabled, each block is split into sub-blocks that end right before
+    // the next change of an automated parameter, the tempo or a MIDI event of
+    // any processor. Automation and tempo changes then take effect on the
+    // exact sample, as with a buffer size of 1, while stretches without
+    // changes are still processed a whole block at a time.
+    void setAdaptiveBlocks(bool adaptiveBlocks) { m_adaptiveBlocks = adaptiveBlocks; }
+    bool getAdaptiveBlocks() const { return m_adaptiveBlocks; }
+    // The number of blocks and sub-blocks the last render processed.
+    int64_t getNumSubBlocks() const { return m_numSubBlocks; }
+
+    // The memory in megabytes for keeping the outputs of nodes between
+    // renders, 0 (the default) to disable it. Each node's output is stored
+    // under a hash of its configuration (see ProcessorBase::hashConfiguration),
+    // its inputs' hashes and the render settings. When a later render has the
+    // same hash for a node, the node's output is copied from the cache instead
+    // of being processed, and nodes only feeding cached nodes aren't processed
+    // at all. The least recently used outputs are dropped to stay within the
+    // size. Renders with an automatic tail don't use the cache. This renders
+    // with the flat plan (see setExecutor).
+    void setNodeCacheSize(double megabytes);
+    double getNodeCacheSize() const { return m_nodeCacheMaxBytes / (1024. * 1024.); }
+    void clearNodeCache();
+    // The number of nodes that the last render copied from the cache.
+    int getNumNodeCacheHits() const { return m_numNodeCacheHits; }
+
+    // Keep the output of renders in `directory`, which other processes may
+    // share, and skip renders whose output is already there. A render is
+    // identified by the node cache hash of the last processor (see
+    // setNodeCacheSize) and the recorded window. Renders that record other
+    // processors or automation, or have an automatic tail, aren't cached. An
+    // empty directory disables the cache. This renders with the flat plan.
+    void setRenderCache(const std::string& directory, double maxMegabytes);
+    RenderCache* getRenderCache() { return m_renderCache.get(); }
+
+    // A new engine with the same settings, tempo, processors and graph, for
+    // rendering on another thread. Data that doesn't change during a render
+    // is shared instead of copied: automation, playback audio and compiled
+    // Faust factories (through the factory cache). Everything a render changes
+    // (DSP state, recordings and plugin instances) is the clone's own, and so
+    // are later changes to either engine's settings.
+    RenderEngine* clone();
 
     juce::Optional<PositionInfo> getPosition() const override;
     bool canControlTransport() override;
@@ -67,7 +228,8 @@ class RenderEngine : public AudioPlayHead
     // Factory methods exposed to Python:
     OscillatorProcessor* makeOscillatorProcessor(const std::string& name, float freq);
 
-    PluginProcessorWrapper* makePluginProcessor(const std::string& name, const std::string& path);
+    PluginProcessorWrapper* makePluginProcessor(const std::string& name, const std::string& path,
+                                                bool isolated = false);
 
     PlaybackProcessor* makePlaybackProcessor(const std::string& name, nb::ndarray<float> input);
 
@@ -105,6 +267,7 @@ class RenderEngine : public AudioPlayHead
         state["sample_rate"] = mySampleRate;
         state["buffer_size"] = myBufferSize;
         state["ppqn"] = m_BPM_PPQN;
+        state["bpm_ramp"] = m_bpmRamp;
 
         // BPM automation
         if (m_bpmAutomation.getNumSamples() > 0)
@@ -334,7 +497,8 @@ class RenderEngine : public AudioPlayHead
         {
             nb::ndarray<nb::numpy, float> bpm_data =
                 nb::cast<nb::ndarray<nb::numpy, float>>(state["bpm_automation"]);
-            setBPMwithPPQN(bpm_data, m_BPM_PPQN);
+            const bool ramp = state.contains("bpm_ramp") && nb::cast<bool>(state["bpm_ramp"]);
+            setBPMwithPPQN(bpm_data, m_BPM_PPQN, ramp);
         }
 
         // Recreate processors from their states
@@ -526,7 +690,9 @@ class RenderEngine : public AudioPlayHead
                 {
                     std::string name = nb::cast<std::string>(proc_state["unique_name"]);
                     std::string plugin_path = nb::cast<std::string>(proc_state["plugin_path"]);
-                    new_proc = makePluginProcessor(name, plugin_path);
+                    bool isolated = proc_state.contains("isolated") &&
+                                    nb::cast<bool>(proc_state["isolated"]);
+                    new_proc = makePluginProcessor(name, plugin_path, isolated);
 
                     // Restore plugin state separately (don't use setPickleState which does
                     // placement new)
@@ -671,8 +837,15 @@ class RenderEngine : public AudioPlayHead
     int myBufferSize;
     std::unordered_map<std::string, juce::AudioProcessorGraph::NodeID> m_UniqueNameToNodeID;
 
+    // Wire the JUCE graph to match m_stringDag. Only processors that need it
+    // are prepared, and only the connections that changed since the last call
+    // are added or removed.
     bool connectGraph();
 
+    std::vector<juce::AudioProcessorGraph::Connection> m_graphConnections;
+    std::vector<std::pair<int, int>> m_graphChannelCounts;
+    bool m_isGraphPrepared = false;
+
     std::unique_ptr<juce::AudioProcessorGraph> m_mainProcessorGraph;
 
     std::vector<std::pair<std::string, std::vector<std::string>>> m_stringDag;
@@ -680,9 +853,212 @@ class RenderEngine : public AudioPlayHead
 
     PositionInfo m_positionInfo;
     AudioSampleBuffer m_bpmAutomation;
+    bool m_bpmRamp = false;
+    // Built from m_bpmAutomation whenever the tempo is set. The playhead,
+    // render lengths in beats, MIDI in beats and automation with a PPQN all
+    // convert between beats and samples with it.
+    TempoMap m_tempoMap;
+
+    // render() is split into these stages so that RenderStream can process
+    // blocks a chunk at a time. beginRender returns the number of samples to
+    // render. If `lastProcessorRecordSamples` isn't negative, the last
+    // processor only records a window of that many samples (see
+    // ProcessorBase::setRecordWindow) instead of the whole render. Otherwise
+    // the recordings have room for `numTailSamples` more samples. See render
+    // for `start` and `preroll`.
+    int64_t beginRender(const double renderLength, bool isBeats, int lastProcessorRecordSamples,
+                        int64_t numTailSamples = 0, double start = 0., double preroll = 0.);
+    // Render blocks after the first `numSamples` until the tail is over (see
+    // render), trim the recordings and return their length.
+    int64_t renderTail(int64_t numSamples, int64_t maxTailSamples, float thresholdDb);
+    void renderBlock();
+    void renderSubBlock(int numSamples);
+    // The size of the next sub-block with adaptive blocks.
+    int getSamplesUntilNextEvent(int maxSamples);
+    void advancePlayhead(int64_t numSamples);
+    void finishRender(bool sendNoteOffs);
+    // For an automatic tail: replace each processor's MIDI with the events
+    // before `sample` followed by All Notes Off on every channel, the same
+    // messages finishRender sends plugins, so nothing new plays during the
+    // tail and held notes are released. restoreMidi puts the MIDI back.
+    void endMidiAt(int64_t sample);
+    void restoreMidi();
+
+    struct SavedMidi
+    {
+        ProcessorBase* processor;
+        juce::MidiBuffer midiSec;
+        juce::MidiBuffer midiQN;
+    };
+    std::vector<SavedMidi> m_midiBeforeTail;
+
+    // The sample of the render at which recording starts.
+    int64_t m_recordStartSample = 0;
+
+    AudioSampleBuffer m_renderAudioBuffer;
+    MidiBuffer m_renderMidiBuffer;
+    bool m_useSchedule = false;
+    // Process m_scheduleOrder on the calling thread instead of the thread pool.
+    bool m_isScheduleSerial = false;
+    bool m_useFlatPlan = false;
+    // Set on clones, which are made to render on other threads, where
+    // juce::AudioProcessorGraph can't prepare itself. They always use the flat
+    // plan, whatever their executor.
+    bool m_isClone = false;
+    bool m_skipSilence = false;
+    bool m_adaptiveBlocks = false;
+    int64_t m_numSubBlocks = 0;
+    bool m_lastProcessorRecordEnable = false;
+    std::uint64_t m_renderGeneration = 0;
+
+    friend class RenderStream;
     std::uint32_t m_BPM_PPQN = 960;
 
     float getBPM(double ppqPosition);
 
     void prepareProcessor(ProcessorBase* processor, const std::string& name);
+
+    // A node of the parallel schedule. The channel mapping mirrors the
+    // connections made in connectGraph.
+    struct ScheduledNode
+    {
+        ProcessorBase* processor = nullptr;
+        // For each input channel, the (node index, output channel) it reads
+        // from, or {-1, -1} if nothing is connected to it.
+        std::vector<std::pair<int, int>> inputChannels;
+        std::vector<int> dependents;
+        int numDependencies = 0;
+        int level = 0;
+        // The block-sized buffer in m_scheduleBuffers that the node processes
+        // in place. Nodes whose outputs are never alive at the same time
+        // share a buffer.
+        int bufferIndex = -1;
+        juce::MidiBuffer midiBuffer;
+
+        // Silence skipping state, reset by beginRender. A node is only skipped
+        // after it has been processed and its output was silent.
+        bool isOutputSilent = false;
+        int numHeldNotes = 0;
+        bool isSustained = false;
+        // The node is processed until at least this sample.
+        int64_t activeUntilSample = 0;
+        // Where the next scan of the processor's MIDI buffers starts.
+        int64_t nextMidiSample = 0;
+        int64_t nextMidiPulse = 0;
+
+        // Node cache state, set by beginRender.
+        std::uint64_t cacheKey = 0;
+        bool isCacheable = false;
+        // Whether anything reads or records the output this render.
+        bool isOutputNeeded = true;
+        // The output from the cache, played back instead of processing.
+        std::shared_ptr<juce::AudioSampleBuffer> cachedOutput;
+        // Where the output is collected to be cached when the render ends.
+        std::shared_ptr<juce::AudioSampleBuffer> capturedOutput;
+    };
+
+    int m_numThreads = 1;
+    int m_automationBlockSize = 0;
+    std::unique_ptr<RenderThreadPool> m_threadPool;
+    std::vector<ScheduledNode> m_schedule;
+    // The indices of m_schedule in a topological order.
+    std::vector<int> m_scheduleOrder;
+    std::vector<juce::AudioSampleBuffer> m_scheduleBuffers;
+    std::unique_ptr<std::atomic<int>[]> m_pendingDependencies;
+    std::unique_ptr<std::atomic<int>[]> m_readyNodes;
+    std::atomic<int> m_readyHead{0};
+    std::atomic<int> m_readyTail{0};
+    std::mutex m_scheduleExceptionMutex;
+    std::exception_ptr m_scheduleException;
+
+    // Whether renders run the flat plan instead of juce::AudioProcessorGraph:
+    // the executor is "flat", the engine is a clone, or a feature needs it.
+    bool usesFlatPlan() const
+    {
+        return m_useFlatPlan || m_isClone || m_skipSilence || m_nodeCacheMaxBytes > 0 ||
+               m_renderCache != nullptr;
+    }
+
+    // Build m_schedule from m_stringDag and return the width of the widest
+    // topological level, or 0 if the DAG can't be scheduled by RenderEngine
+    // (for example, because it has a cycle). Must be called after connectGraph.
+    int buildSchedule();
+    // Assign each scheduled node a buffer from m_scheduleBuffers. A serial
+    // schedule can reuse a buffer as soon as everything reading it comes
+    // earlier in m_scheduleOrder.
+    void planScheduleBuffers(bool isSerial);
+    void pushReadyNode(int nodeIndex);
+    void processScheduledBlock(int numSamples, bool automate);
+    void processScheduledNode(int nodeIndex, int numSamples, bool automate);
+
+    struct CachedNodeOutput
+    {
+        std::uint64_t key;
+        std::shared_ptr<juce::AudioSampleBuffer> audio;
+    };
+    // Most recently used first.
+    std::list<CachedNodeOutput> m_nodeCache;
+    std::unordered_map<std::uint64_t, std::list<CachedNodeOutput>::iterator> m_nodeCacheIndex;
+    size_t m_nodeCacheBytes = 0;
+    size_t m_nodeCacheMaxBytes = 0;
+    int m_numNodeCacheHits = 0;
+    // Nodes are skipped on the thread pool's workers too.
+    std::atomic<int64_t> m_numSkippedBlocks{0};
+    // The sample of the render where the cached outputs begin.
+    int64_t m_nodeCacheStartSample = 0;
+
+    int m_numNodeCacheSamples = 0;
+
+    std::unique_ptr<RenderCache> m_renderCache;
+    // The render cache key for a render of `numSamples` samples, if the render
+    // can be cached. Must be called after beginRender.
+    bool getRenderCacheKey(int64_t numSamples, std::uint64_t& key);
+
+    // Find each scheduled node's cache key. `numSamples` is the length of the
+    // render from `startSample`.
+    void hashScheduledNodes(int64_t startSample, int64_t numSamples);
+    // Look up the nodes in the node cache and decide which ones have to be
+    // processed.
+    void planNodeCache();
+    void captureScheduledOutput(ScheduledNode& node, const juce::AudioSampleBuffer& buffer,
+                                int numSamples);
+    // Store the outputs captured by a render that reached its end.
+    void storeNodeCache();
+    void trimNodeCache();
+    // Update the node's silence skipping state for the current block and
+    // return whether the block can be skipped.
+    bool canSkipScheduledNode(ScheduledNode& node, int numSamples);
+};
+
+// The iterator returned by RenderEngine.render_stream. Each call to next()
+// processes just enough blocks to fill one chunk and returns that chunk of the
+// last processor's output. The graph and playhead keep their state between
+// chunks, so the chunks concatenated are identical to the output of render(),
+// while the last processor only ever holds about one chunk of audio.
+class RenderStream
+{
+  public:
+    RenderStream(RenderEngine& engine, ProcessorBase* lastProcessor, int64_t numSamples,
+                 int chunkSamples);
+    ~RenderStream();
+
+    // Throws nb::stop_iteration after the last chunk.
+    nb::ndarray<nb::numpy, float> next();
+
+    int64_t getNumSamples() const { return m_numSamples; }
+    int64_t getPosition() const { return m_position; }
+
+  private:
+    void finish(bool sendNoteOffs);
+
+    RenderEngine& m_engine;
+    ProcessorBase* m_lastProcessor;
+    std::uint64_t m_generation;
+    int64_t m_numSamples;
+    int m_chunkSamples;
+    // Samples returned so far, and samples processed by the graph so far. The
+    // graph works in whole blocks, so it can be up to one block ahead.
+    int64_t m_position = 0;
+    int64_t m_numProcessed = 0;
+    bool m_finished = false;
 };
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small persistent pool used by RenderEngine to process independent branches
+// of the graph concurrently. The threads are created once and sleep between
+// jobs, so dispatching a job every audio block doesn't pay for thread creation.
+//
+// `run` executes the same job on every worker and on the calling thread, and
+// returns once all of them have returned. The job itself is responsible for
+// dividing work between the threads (see RenderEngine::processScheduledBlock).
+class RenderThreadPool
+{
+  public:
+    // `numThreads` includes the calling thread, so a pool of N threads spawns
+    // N-1 workers.
+    explicit RenderThreadPool(int numThreads)
+    {
+        for (int i = 1; i < numThreads; i++)
+        {
+            m_workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~RenderThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldExit = true;
+        }
+        m_wakeCondition.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    int getNumThreads() const { return (int)m_workers.size() + 1; }
+
+    void run(const std::function<void()>& job)
+    {
+        if (m_workers.empty())
+        {
+            job();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_numActiveWorkers = m_workers.size();
+            m_generation++;
+        }
+        m_wakeCondition.notify_all();
+
+        job();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] { return m_numActiveWorkers == 0; });
+        m_job = nullptr;
+    }
+
+  private:
+    void workerLoop()
+    {
+        std::uint64_t seenGeneration = 0;
+
+        while (true)
+        {
+            const std::function<void()>* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeCondition.wait(
+                    lock, [&] { return m_shouldExit || m_generation != seenGeneration; });
+                if (m_shouldExit)
+                {
+                    return;
+                }
+                seenGeneration = m_generation;
+                job = m_job;
+            }
+
+            (*job)();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_numActiveWorkers == 0)
+                {
+                    m_doneCondition.notify_one();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+    const std::function<void()>* m_job = nullptr;
+    size_t m_numActiveWorkers = 0;
+    std::uint64_t m_generation = 0;
+    bool m_shouldExit = false;
+};
@@ -55,6 +55,13 @@ class ReverbProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "ReverbProcessor"; };
 
+    bool isSilentWithoutInput() override { return true; }
+
+    bool hashConfiguration(ConfigurationHasher&) override { return true; }
+    // Covers the delay before the longest comb filter starts to sound. After
+    // that, the decaying reverb is audible until it's actually silent.
+    double getTailLengthSeconds() const override { return 0.1; }
+
     void setRoomSize(float roomSize) { setAutomationVal("room_size", roomSize); }
     float getRoomSize() const { return getAutomationAtZero("room_size"); }
 
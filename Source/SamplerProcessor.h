@@ -15,7 +15,7 @@ class SamplerProcessor : public ProcessorBase
         : ProcessorBase{newUniqueName}, mySampleRate{sr}
     {
         // Store original data before upsampling
-        myOriginalSampleData = inputData;
+        myOriginalSampleData = std::make_shared<SampleData>(inputData);
 
         createParameterLayout();
         sampler.setNonRealtime(true);
@@ -23,6 +23,18 @@ class SamplerProcessor : public ProcessorBase
         setMainBusInputsAndOutputs(0, inputData.size());
     }
 
+    // Play the same sample as `other` without copying its original data. The
+    // sampler still makes its own upsampled copy.
+    SamplerProcessor(std::string newUniqueName, const SamplerProcessor& other)
+        : ProcessorBase{newUniqueName}, mySampleRate{other.mySampleRate},
+          myOriginalSampleData{other.myOriginalSampleData}
+    {
+        createParameterLayout();
+        sampler.setNonRealtime(true);
+        sampler.setSample(*myOriginalSampleData, mySampleRate);
+        setMainBusInputsAndOutputs(0, (int)myOriginalSampleData->size());
+    }
+
     SamplerProcessor(std::string newUniqueName, nb::ndarray<float> input, double sr, int blocksize)
         : ProcessorBase{newUniqueName}, mySampleRate{sr}
     {
@@ -58,12 +70,12 @@ class SamplerProcessor : public ProcessorBase
     {
         sampler.reset();
 
-        myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec);
+        myMidiIteratorSec = MidiBufferCursor(myMidiBufferSec, getRenderStartSample());
 
         myMidiEventsDoRemainSec =
             myMidiIteratorSec.getNextEvent(myMidiMessageSec, myMidiMessagePositionSec);
 
-        myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN);
+        myMidiIteratorQN = MidiBufferCursor(myMidiBufferQN, getRenderStartPulse());
 
         myMidiEventsDoRemainQN =
             myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
@@ -86,10 +98,10 @@ class SamplerProcessor : public ProcessorBase
         midiBuffer.clear();
         myRenderMidiBuffer.clear();
 
-        {
-            auto start = *posInfo->getTimeInSamples();
-            auto end = start + buffer.getNumSamples();
+        auto start = *posInfo->getTimeInSamples();
+        auto end = start + buffer.getNumSamples();
 
+        {
             myIsMessageBetweenSec =
                 myMidiMessagePositionSec >= start && myMidiMessagePositionSec < end;
             while (myIsMessageBetweenSec && myMidiEventsDoRemainSec)
@@ -113,20 +125,14 @@ class SamplerProcessor : public ProcessorBase
         }
 
         {
-            auto pulseStart = std::floor(*posInfo->getPpqPosition() * PPQN);
-            auto pulseEnd = pulseStart + buffer.getNumSamples() * (*posInfo->getBpm() * PPQN) /
-                                             (mySampleRate * 60.);
-
-            myIsMessageBetweenQN =
-                myMidiMessagePositionQN >= pulseStart && myMidiMessagePositionQN < pulseEnd;
+            // The tempo map gives the exact sample of each event in beats.
+            auto eventSample = getSampleAtPulse(myMidiMessagePositionQN);
+            myIsMessageBetweenQN = eventSample < end;
             while (myIsMessageBetweenQN && myMidiEventsDoRemainQN)
             {
                 // steps for saving midi to file output
                 auto messageCopy = MidiMessage(myMidiMessageQN);
-                messageCopy.setTimeStamp(
-                    (*posInfo->getTimeInSeconds() +
-                     (myMidiMessagePositionQN - pulseStart) * (60. / (*posInfo->getBpm()) / PPQN)) *
-                    2400.);
+                messageCopy.setTimeStamp(eventSample * (2400. / mySampleRate));
                 if (!(messageCopy.isEndOfTrackMetaEvent() || messageCopy.isTempoMetaEvent()))
                 {
                     myRecordedMidiSequence.addEvent(messageCopy);
@@ -134,12 +140,11 @@ class SamplerProcessor : public ProcessorBase
 
                 // steps for playing MIDI
                 myRenderMidiBuffer.addEvent(myMidiMessageQN,
-                                            int((myMidiMessagePositionQN - pulseStart) * 60. *
-                                                mySampleRate / (PPQN * *posInfo->getBpm())));
+                                            int(std::max<int64_t>(0, eventSample - start)));
                 myMidiEventsDoRemainQN =
                     myMidiIteratorQN.getNextEvent(myMidiMessageQN, myMidiMessagePositionQN);
-                myIsMessageBetweenQN =
-                    myMidiMessagePositionQN >= pulseStart && myMidiMessagePositionQN < pulseEnd;
+                eventSample = getSampleAtPulse(myMidiMessagePositionQN);
+                myIsMessageBetweenQN = eventSample < end;
             }
         }
 
@@ -150,18 +155,21 @@ class SamplerProcessor : public ProcessorBase
 
     const juce::String getName() const override { return "SamplerProcessor"; }
 
+    bool isSilentWithoutInput() override { return true; }
+
     nb::ndarray<nb::numpy, float> getData()
     {
         // Return the original non-upsampled data for serialization
-        if (myOriginalSampleData.empty())
+        if (!myOriginalSampleData || myOriginalSampleData->empty())
         {
             // Return empty array if no sample loaded
             size_t shape[2] = {0, 0};
             return nb::ndarray<nb::numpy, float>(nullptr, 2, shape);
         }
 
-        int num_channels = (int)myOriginalSampleData.size();
-        int num_samples = (int)myOriginalSampleData[0].size();
+        const auto& originalData = *myOriginalSampleData;
+        int num_channels = (int)originalData.size();
+        int num_samples = (int)originalData[0].size();
 
         // Allocate output array
         size_t shape[2] = {(size_t)num_channels, (size_t)num_samples};
@@ -176,7 +184,7 @@ class SamplerProcessor : public ProcessorBase
         {
             for (int sample = 0; sample < num_samples; sample++)
             {
-                array_data[chan * num_samples + sample] = myOriginalSampleData[chan][sample];
+                array_data[chan * num_samples + sample] = originalData[chan][sample];
             }
         }
 
@@ -209,10 +217,10 @@ class SamplerProcessor : public ProcessorBase
             }
         }
 
-        // Store original data before upsampling
-        myOriginalSampleData = data;
-
         sampler.setSample(data, mySampleRate);
+
+        // Store original data before upsampling
+        myOriginalSampleData = std::make_shared<SampleData>(std::move(data));
     }
 
     int getNumMidiEvents()
@@ -287,8 +295,11 @@ class SamplerProcessor : public ProcessorBase
         myMidiBufferQN.clear();
     }
 
+    juce::MidiBuffer* getMidiBufferSec() override { return &myMidiBufferSec; }
+    juce::MidiBuffer* getMidiBufferQN() override { return &myMidiBufferQN; }
+
     bool addMidiNote(uint8 midiNote, uint8 midiVelocity, const double noteStart,
-                     const double noteLength, bool isBeats)
+                     const double noteLength, bool isBeats) override
     {
         if (midiNote > 255)
             midiNote = 255;
@@ -497,8 +508,11 @@ class SamplerProcessor : public ProcessorBase
 
     SamplerAudioProcessor sampler;
 
-    // Store original non-upsampled sample data for serialization
-    std::vector<std::vector<float>> myOriginalSampleData;
+    using SampleData = std::vector<std::vector<float>>;
+
+    // Store original non-upsampled sample data for serialization. Clones
+    // share it.
+    std::shared_ptr<SampleData> myOriginalSampleData;
 
     MidiBuffer myMidiBufferQN;
     MidiBuffer myMidiBufferSec;
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Converts between positions in beats (quarter notes) and in seconds or samples
+// for the tempo set with RenderEngine::setBPM or setBPMwithPPQN.
+//
+// The tempo is a list of BPM values with `ppqn` values per quarter note. Each
+// value either holds until the next one (a step) or, with `ramp`, changes
+// linearly in beats towards the next one. The last value holds forever. The
+// time at the start of every value is accumulated once when the map is built,
+// so a conversion is a direct lookup (beats to time) or a binary search (time
+// to beats) instead of stepping through the timeline, and the result doesn't
+// depend on the buffer size.
+class TempoMap
+{
+  public:
+    explicit TempoMap(double bpm = 120.) : m_bpm(1, bpm), m_startSeconds(1, 0.) {}
+
+    TempoMap(const float* bpm, size_t numValues, std::uint32_t ppqn, bool ramp)
+        : m_bpm(bpm, bpm + numValues), m_ppqn(ppqn), m_ramp(ramp && numValues > 1)
+    {
+        m_startSeconds.resize(m_bpm.size());
+        double seconds = 0.;
+        for (size_t i = 0; i < m_bpm.size(); i++)
+        {
+            m_startSeconds[i] = seconds;
+            if (i + 1 < m_bpm.size())
+            {
+                seconds += getSegmentSeconds(i, 1. / m_ppqn);
+            }
+        }
+    }
+
+    bool isRamp() const { return m_ramp; }
+    bool isConstant() const { return m_bpm.size() == 1; }
+
+    double getBpmAtBeat(double beats) const
+    {
+        const size_t i = getSegment(beats);
+        if (!m_ramp || i + 1 >= m_bpm.size())
+        {
+            return m_bpm[i];
+        }
+        const double fraction = (beats - getSegmentStartBeat(i)) * m_ppqn;
+        return m_bpm[i] + (m_bpm[i + 1] - m_bpm[i]) * fraction;
+    }
+
+    double getSecondsAtBeat(double beats) const
+    {
+        if (beats <= 0.)
+        {
+            return beats * 60. / m_bpm[0];
+        }
+        const size_t i = getSegment(beats);
+        return m_startSeconds[i] + getSegmentSeconds(i, beats - getSegmentStartBeat(i));
+    }
+
+    double getBeatAtSeconds(double seconds) const
+    {
+        if (seconds <= 0.)
+        {
+            return seconds * m_bpm[0] / 60.;
+        }
+
+        // The last segment that starts at or before `seconds`.
+        const auto it = std::upper_bound(m_startSeconds.begin(), m_startSeconds.end(), seconds);
+        const size_t i = (size_t)(it - m_startSeconds.begin()) - 1;
+        const double elapsed = seconds - m_startSeconds[i];
+
+        const double slope = getSegmentSlope(i);
+        if (slope == 0.)
+        {
+            return getSegmentStartBeat(i) + elapsed * m_bpm[i] / 60.;
+        }
+        // The inverse of getSegmentSeconds for a linear ramp.
+        return getSegmentStartBeat(i) + m_bpm[i] * std::expm1(elapsed * slope / 60.) / slope;
+    }
+
+    double getSampleAtBeat(double beats, double sampleRate) const
+    {
+        return getSecondsAtBeat(beats) * sampleRate;
+    }
+
+    double getBeatAtSample(double sample, double sampleRate) const
+    {
+        return getBeatAtSeconds(sample / sampleRate);
+    }
+
+    // The first beat after `beats` and before `maxBeats` at which a step
+    // changes the tempo, or infinity. Ramps change the tempo continuously and
+    // don't have steps.
+    double getNextStepBeat(double beats, double maxBeats) const
+    {
+        if (m_ramp)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        const size_t i = getSegment(beats);
+        for (size_t j = i + 1; j < m_bpm.size() && getSegmentStartBeat(j) < maxBeats; j++)
+        {
+            if (m_bpm[j] != m_bpm[i])
+            {
+                return getSegmentStartBeat(j);
+            }
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+
+  private:
+    size_t getSegment(double beats) const
+    {
+        if (beats <= 0.)
+        {
+            return 0;
+        }
+        return std::min(m_bpm.size() - 1, (size_t)(beats * m_ppqn));
+    }
+
+    double getSegmentStartBeat(size_t i) const { return double(i) / m_ppqn; }
+
+    // The change in BPM per beat within segment `i`.
+    double getSegmentSlope(size_t i) const
+    {
+        if (!m_ramp || i + 1 >= m_bpm.size())
+        {
+            return 0.;
+        }
+        return (m_bpm[i + 1] - m_bpm[i]) * m_ppqn;
+    }
+
+    // The seconds it takes to play `beats` beats from the start of segment `i`.
+    double getSegmentSeconds(size_t i, double beats) const
+    {
+        const double slope = getSegmentSlope(i);
+        if (slope == 0.)
+        {
+            return beats * 60. / m_bpm[i];
+        }
+        // The integral of 60 / (bpm + slope * b) over [0, beats].
+        return 60. / slope * std::log1p(slope * beats / m_bpm[i]);
+    }
+
+    std::vector<double> m_bpm;
+    std::vector<double> m_startSeconds;
+    std::uint32_t m_ppqn = 1;
+    bool m_ramp = false;
+};
@@ -74,7 +74,12 @@ NB_MODULE(dawdreamer, m)
                      "Whether recording of this processor's automation is enabled.")
         .def("get_audio", &ProcessorBase::getAudioFrames,
              "Get the audio data of the processor after a render, assuming "
-             "recording was enabled.")
+             "recording was enabled. The array shares memory with the "
+             "recording instead of copying it, and later renders don't "
+             "modify it.")
+        .def("detach_audio", &ProcessorBase::detachAudioFrames,
+             "Like `get_audio`, but the processor also releases its reference to "
+             "the recording, so the next render records into a new buffer.")
         .def("get_name", &ProcessorBase::getUniqueName,
              "Get the user-defined name of a processor instance.")
         .doc() = R"pbdoc(
@@ -315,6 +320,15 @@ but the filter mode cannot under automation.";
              nb::call_guard<nb::gil_scoped_release>(), "Save the state to a file.")
         .def("load_state", &PluginProcessorWrapper::loadStateInformation, arg("filepath"),
              nb::call_guard<nb::gil_scoped_release>(), "Load the state from a file.")
+        .def("snapshot_state", &PluginProcessorWrapper::snapshotState,
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Keep the plugin's state in memory and return a handle for `restore_state`. "
+             "Identical states of the same plugin share one snapshot and handle.")
+        .def("restore_state", &PluginProcessorWrapper::restoreState, arg("handle"),
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Restore a state from `snapshot_state`, which may have been taken by another "
+             "processor of the same plugin. Unlike `load_state`, it doesn't read a file or "
+             "create an editor window.")
         .def("open_editor", &PluginProcessorWrapper::openEditor,
              "Open the UI editor for the plugin.")
         .def("load_preset", &PluginProcessorWrapper::loadPreset, arg("filepath"),
@@ -345,7 +359,8 @@ but the filter mode cannot under automation.";
              "[DEPRECATED: Use `get_parameters_description`]. Get a list of "
              "dictionaries describing the plugin's parameters.")
         .def("get_parameters_description", &PluginProcessorWrapper::getPluginParametersDescription,
-             "Get a list of dictionaries describing the plugin's parameters.")
+             "Get a list of dictionaries describing the plugin's parameters. Everything except "
+             "the current values is cached for each plugin after the first call.")
         .def("get_parameter_range", &PluginProcessorWrapper::getParameterValueRange, arg("index"),
              arg("search_steps") = 1000, arg("convert") = true,
              R"pbdoc(
@@ -364,7 +379,14 @@ but the filter mode cannot under automation.";
     -------
     dict
         A dictionary holding information about the parameter range.
+
+    The texts are cached for each plugin and `search_steps`, so later calls (also by other processors of the same plugin) don't probe the plugin again.
 )pbdoc")
+        .def("cache_parameter_ranges", &PluginProcessorWrapper::cacheParameterRanges,
+             arg("search_steps") = 1000, nb::kw_only(), arg("num_threads") = 1,
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Probe the range of every parameter ahead of `get_parameter_range`, on "
+             "`num_threads` copies of the plugin at once (0 for one per CPU core).")
         //"Return a list of tuples of the form ((domain1, domain2), text) "
         //"where 0 <= domain1 < domain2 <= 1. and text is a Python str for "
         //"the value in that range.")
@@ -377,6 +399,8 @@ but the filter mode cannot under automation.";
         .def_prop_ro("n_midi_events", &PluginProcessorWrapper::getNumMidiEvents,
                      "The number of MIDI events stored in the buffer. \
 Note that note-ons and note-offs are counted separately.")
+        .def_prop_ro("isolated", &PluginProcessorWrapper::isIsolated,
+                     "Whether the plugin runs in a helper process (see `make_plugin_processor`).")
         .def("load_midi", &PluginProcessorWrapper::loadMidi, arg("filepath"), kw_only(),
              arg("clear_previous") = true, arg("beats") = false, arg("all_events") = true,
              load_midi_description)
@@ -387,6 +411,31 @@ Note that note-ons and note-offs are counted separately.")
         .def("save_midi", &PluginProcessorWrapper::saveMIDI, arg("filepath"), save_midi_description)
         .def("__getstate__", &PluginProcessorWrapper::getPickleState)
         .def("__setstate__", &PluginProcessorWrapper::setPickleState)
+        .def_static("set_scan_cache_dir", &PluginProcessor::setScanCacheDirectory, arg("path"),
+                    "Plugin files are scanned the first time they're loaded, and later "
+                    "`make_plugin_processor` calls reuse the result until the file is modified. "
+                    "Set a directory to also save the results there, so that new processes skip "
+                    "scanning too. An empty string (the default) only caches in memory.")
+        .def_static("get_scan_cache_dir", &PluginProcessor::getScanCacheDirectory,
+                    "Get the directory set with `set_scan_cache_dir`.")
+        .def_static("clear_scan_cache", &PluginProcessor::clearScanCache,
+                    "Forget every plugin scan, including those saved in the cache directory, so "
+                    "plugins are scanned again when they're next loaded.")
+        .def_static("clear_state_snapshots", &PluginProcessor::clearStateSnapshots,
+                    "Free every snapshot taken with `snapshot_state`. Their handles can't be "
+                    "restored afterwards.")
+        .def_static("save_parameter_cache", &PluginProcessor::saveParameterCache, arg("path"),
+                    "Save the cached parameter descriptions and ranges of every plugin to a file.")
+        .def_static("load_parameter_cache", &PluginProcessor::loadParameterCache, arg("path"),
+                    "Load parameter descriptions and ranges saved with `save_parameter_cache`.")
+        .def_static("clear_parameter_cache", &PluginProcessor::clearParameterCache,
+                    "Forget the cached parameter descriptions and ranges of every plugin.")
+        .def_static("_set_isolated_host_command", &PluginProcessor::setIsolatedHostCommand,
+                    arg("command"),
+                    "Set by the dawdreamer package when it's imported. Don't call this directly.")
+        .def_static("_run_isolated_host", &PluginProcessor::runIsolatedHost, arg("pipe_name"),
+                    nb::call_guard<nb::gil_scoped_release>(),
+                    "Used by the helper process of an isolated plugin. Don't call this directly.")
         .doc() =
         "A Plugin Processor can load VST \".dll\" and \".vst3\" files on Windows. It can load \".vst\", \".vst3\", and \".component\" files on macOS. The files can be for either instruments \
 or effects. Some plugins such as ones that do sidechain compression can accept two inputs when loading a graph.";
@@ -445,7 +494,17 @@ Unlike a VST, the parameters don't need to be between 0 and 1. For example, you
 
     faust.def(
              "createLibContext", []() { createLibContext(); }, "Create a libfaust context.")
-        .def("destroyLibContext", []() { destroyLibContext(); }, "Destroy a libfaust context.");
+        .def("destroyLibContext", []() { destroyLibContext(); }, "Destroy a libfaust context.")
+        .def("set_factory_cache_dir", &FaustProcessor::setFactoryCacheDirectory, arg("path"),
+             "FaustProcessors compiled from the same code with the same options share one "
+             "compiled factory. Set a directory to also save non-polyphonic factories there as "
+             "LLVM bitcode, so that new processes reuse them instead of compiling. An empty "
+             "string (the default) only caches in memory.")
+        .def("get_factory_cache_dir", &FaustProcessor::getFactoryCacheDirectory,
+             "Get the directory set with `set_factory_cache_dir`.")
+        .def("clear_factory_cache", &FaustProcessor::clearFactoryCache,
+             "Delete the cached Faust factories that no processor is using. Files in the "
+             "cache directory are kept.");
 
     nb::class_<DawDreamerFaustLibContext>(
         faust, "FaustContext", "A libfaust context to be used with Python's \"with\" syntax.")
@@ -466,29 +525,205 @@ Unlike a VST, the parameters don't need to be between 0 and 1. For example, you
 
     nb::rv_policy returnPolicy = nb::rv_policy::reference;
 
+    nb::class_<RenderStream>(m, "RenderStream",
+                             "An iterator over chunks of a render, returned by "
+                             "`RenderEngine.render_stream`.")
+        .def("__iter__", [](RenderStream& self) -> RenderStream& { return self; },
+             nb::rv_policy::reference)
+        .def("__next__", &RenderStream::next)
+        .def_prop_ro("num_samples", &RenderStream::getNumSamples,
+                     "The total number of samples the stream will yield.")
+        .def_prop_ro("position", &RenderStream::getPosition,
+                     "The number of samples yielded so far.");
+
     nb::class_<RenderEngine>(m, "RenderEngine",
                              "A Render Engine loads and runs a graph of audio processors.")
         .def(nb::init<double, int>(), arg("sample_rate"), arg("block_size"))
-        .def("render", &RenderEngine::render, arg("duration"), kw_only(), arg("beats") = false,
-             nb::call_guard<nb::gil_scoped_release>(),
-             "Render the most recently loaded graph. By default, when "
-             "`beats` is "
-             "False, duration is measured in seconds, otherwise beats. "
-             "The GIL is released during rendering, so multiple engines can "
-             "render concurrently on Python threads.")
+        .def(
+            "render",
+            [](RenderEngine& engine, double duration, bool beats, double start, double preroll,
+               std::optional<std::string> tail, float tailThresholdDb, double maxTail)
+            {
+                if (tail && *tail != "auto")
+                {
+                    throw std::runtime_error("tail must be None or \"auto\".");
+                }
+                return engine.render(duration, beats, start, preroll, tail.has_value(),
+                                     tailThresholdDb, maxTail);
+            },
+            arg("duration"), kw_only(), arg("beats") = false, arg("start") = 0.,
+            arg("preroll") = 0., arg("tail") = nb::none(), arg("tail_threshold_db") = -90.f,
+            arg("max_tail") = 10., nb::call_guard<nb::gil_scoped_release>(),
+            "Render the most recently loaded graph. By default, when "
+            "`beats` is "
+            "False, duration is measured in seconds, otherwise beats. "
+            "`start` (in the same unit) renders and records only the window from `start` "
+            "on, after processing `preroll` seconds before it to warm up effects. Notes held "
+            "at the start are chased. "
+            "With `tail=\"auto\"`, rendering continues past `duration` until the output has "
+            "stayed below `tail_threshold_db` for 100 ms and the processors' reported tails have "
+            "passed, for at most `max_tail` seconds, and the recordings are trimmed to where the "
+            "output last rose above the threshold. "
+            "The GIL is released during rendering, so multiple engines can "
+            "render concurrently on Python threads.")
+        .def("render_stream", &RenderEngine::renderStream, arg("duration"),
+             arg("chunk_samples"), kw_only(), arg("beats") = false, nb::rv_policy::take_ownership,
+             nb::keep_alive<0, 1>(),
+             "Render the most recently loaded graph in chunks. Returns an iterator that yields "
+             "the last processor's audio as (channels, samples) arrays of `chunk_samples` "
+             "samples each (the final chunk may be shorter). Each chunk is rendered when it's "
+             "requested, with the GIL released, so memory use stays bounded and downstream "
+             "work can overlap rendering. Starting another render on the engine ends the "
+             "stream.")
+        .def("render_into", &RenderEngine::renderInto, arg("out").noconvert(), arg("duration"),
+             kw_only(), arg("beats") = false,
+             "Render the most recently loaded graph and write the last processor's audio "
+             "directly into `out`, a writable, C-contiguous float32 numpy array shaped "
+             "(channels, samples) with at least as many samples as the render. Samples past "
+             "the end of the render are left untouched. Nothing is allocated for the output, "
+             "so reusing the same array (or one backed by shared memory) across renders "
+             "avoids memory churn. Afterward, `get_audio()` returns an empty array. Returns "
+             "the number of samples written. The GIL is released during rendering.")
+        .def("render_batch", &RenderEngine::renderBatch, arg("variants"), arg("duration"),
+             kw_only(), arg("beats") = false, arg("num_workers") = 1,
+             "Render the most recently loaded graph once per variant and return the audio of "
+             "the last processor as an array of shape (variants, channels, samples). Each "
+             "variant is a dict mapping processor names to a dict with optional "
+             "\"parameters\" and \"midi_notes\" keys. \"parameters\" maps a parameter name "
+             "or index to a float, a numpy array of audio-rate automation, or a tuple of "
+             "(array, ppqn). \"midi_notes\" is a list of (note, velocity, start_time, "
+             "duration[, beats]) tuples that replaces the processor's MIDI for that variant. "
+             "Overrides only apply to their own variant, and the processors are restored when "
+             "the batch finishes. With `num_workers` above 1 (0 for one per CPU core), "
+             "variants render in parallel on clones of this engine (see `clone`). The GIL is "
+             "released while the variants render.")
+        .def_prop_rw("num_threads", &RenderEngine::getNumThreads, &RenderEngine::setNumThreads,
+                     "The number of threads used to process independent branches of the graph "
+                     "during `render`. The default of 1 renders on the calling thread. Setting it "
+                     "to 0 uses one thread per CPU core.")
+        .def_prop_rw("automation_block_size", &RenderEngine::getAutomationBlockSize,
+                     &RenderEngine::setAutomationBlockSize,
+                     "The number of samples between automation updates inside each block. "
+                     "Filter, compressor and plugin processors and non-polyphonic Faust "
+                     "processors split their blocks so that audio-rate automation is applied "
+                     "this often, without lowering the engine's buffer size. They always split "
+                     "where automation steps to a new value. The default of 0 only splits there. "
+                     "Set it to 1 for sample-accurate automation.")
+        .def_prop_rw("executor", &RenderEngine::getExecutor, &RenderEngine::setExecutor,
+                     "How the graph is executed during `render`. \"graph\" (the default) uses "
+                     "JUCE's AudioProcessorGraph. \"flat\" compiles the graph into a "
+                     "topologically ordered list of processors that share a small pool of "
+                     "block-sized buffers, and only processes processors in the loaded graph. "
+                     "It combines with `num_threads`. \"graph\" can only render on the thread "
+                     "that first used DawDreamer, so clones always render with \"flat\".")
+        .def_prop_rw("skip_silence", &RenderEngine::getSkipSilence,
+                     &RenderEngine::setSkipSilence,
+                     "Skip processing effects and MIDI instruments while they're silent: their "
+                     "inputs are silent, they have no MIDI notes playing, their tail has passed "
+                     "and their last output was below -120 dBFS. Skipped blocks output zeros. "
+                     "This speeds up sparse renders and uses the \"flat\" executor. Of the "
+                     "plugins, only audio effects that don't take MIDI are skipped.")
+        .def_prop_ro("skipped_blocks", &RenderEngine::getNumSkippedBlocks,
+                     "The number of blocks, summed over all processors, that the last render "
+                     "didn't process because of `skip_silence`.")
+        .def_prop_rw("adaptive_blocks", &RenderEngine::getAdaptiveBlocks,
+                     &RenderEngine::setAdaptiveBlocks,
+                     "Split each block wherever an automated parameter, the tempo or a MIDI "
+                     "event changes, so that changes take effect on the exact sample as with a "
+                     "buffer size of 1. Stretches without changes are still processed a whole "
+                     "block at a time. Automation that changes at every sample, such as a ramp, "
+                     "only splits a block where it steps to a value that it then holds.")
+        .def_prop_ro("sub_blocks", &RenderEngine::getNumSubBlocks,
+                     "The number of blocks the last render processed, counting each sub-block "
+                     "of `adaptive_blocks` separately.")
+        .def_prop_rw("node_cache_mb", &RenderEngine::getNodeCacheSize,
+                     &RenderEngine::setNodeCacheSize,
+                     "Megabytes of memory for reusing the outputs of processors between renders "
+                     "(0, the default, disables it). A processor whose parameters, automation, "
+                     "MIDI, settings and inputs are unchanged since a cached render isn't "
+                     "processed again: its output is copied from the cache, and processors that "
+                     "only feed it are skipped. The least recently used outputs are dropped "
+                     "first. Renders with `tail=\"auto\"` don't use the cache. This uses the "
+                     "\"flat\" executor.")
+        .def_prop_ro("node_cache_hits", &RenderEngine::getNumNodeCacheHits,
+                     "The number of processors whose output the last render copied from the "
+                     "node cache.")
+        .def("clear_node_cache", &RenderEngine::clearNodeCache,
+             "Drop every output kept by the node cache.")
+        .def(
+            "set_render_cache",
+            [](RenderEngine& engine, std::optional<std::string> directory, double maxSizeMb)
+            { engine.setRenderCache(directory.value_or(""), maxSizeMb); },
+            arg("directory").none(), arg("max_size_mb") = 4096.,
+            "Keep the output of renders in `directory` (None disables it) and skip renders "
+            "whose output is already there. Processes can share the directory. A render is "
+            "identified by a hash of the graph: every processor's parameters, automation, "
+            "MIDI and settings (including a plugin's state and file), plus the sample rate, "
+            "block size, tempo and rendered window. The least recently used renders are "
+            "deleted to keep the directory under `max_size_mb`. Renders that record processors "
+            "other than the last, record automation, or use `tail=\"auto\"` aren't cached. "
+            "This uses the \"flat\" executor.")
+        .def(
+            "get_render_cache_stats",
+            [](RenderEngine& engine)
+            {
+                nb::dict stats;
+                auto* cache = engine.getRenderCache();
+                stats["directory"] = cache ? nb::cast(cache->getDirectory()) : nb::none();
+                stats["hits"] = cache ? cache->getNumHits() : 0;
+                stats["misses"] = cache ? cache->getNumMisses() : 0;
+                stats["size_mb"] = cache ? cache->getSizeBytes() / (1024. * 1024.) : 0.;
+                return stats;
+            },
+            "Return a dict with the render cache's `directory`, the number of `hits` and "
+            "`misses` since it was set, and its approximate size in megabytes (`size_mb`).")
+        .def(
+            "clone",
+            [](RenderEngine& engine, int numClones)
+            {
+                if (numClones < 1)
+                {
+                    throw std::runtime_error("The number of clones must be at least 1.");
+                }
+                nb::list clones;
+                for (int i = 0; i < numClones; i++)
+                {
+                    clones.append(nb::cast(engine.clone(), nb::rv_policy::take_ownership));
+                }
+                return clones;
+            },
+            arg("num_clones") = 1,
+            "Return a list of `num_clones` new engines with the same settings, tempo, processors "
+            "and graph, e.g. one for each thread rendering in parallel. Automation, playback "
+            "audio and compiled Faust code are shared with this engine instead of copied, so "
+            "clones are cheap to make. Each clone has its own processors (get them with "
+            "`get_processor`), DSP state and plugin instances, and changing one engine's "
+            "settings, automation or audio doesn't affect the others. Plugins are loaded again "
+            "and given the original's state.")
         .def("set_bpm", &RenderEngine::setBPM, arg("bpm"),
              "Set the beats-per-minute of the engine as a constant rate.")
-        .def("set_bpm", &RenderEngine::setBPMwithPPQN, arg("bpm"), arg("ppqn"),
+        .def("set_bpm", &RenderEngine::setBPMwithPPQN, arg("bpm"), arg("ppqn"), kw_only(),
+             arg("ramp") = false,
              "Set the beats-per-minute of the engine using a 1D numpy "
              "array and "
              "a constant PPQN. If the values in the array suddenly "
              "change every "
-             "PPQN samples, the tempo change will occur \"on-the-beat.\"")
+             "PPQN samples, the tempo change will occur \"on-the-beat.\" "
+             "With `ramp=True`, the tempo changes linearly from each value to the next "
+             "one instead of in steps.")
         .def("get_audio", &RenderEngine::getAudioFrames,
-             "Get the most recently rendered audio as a numpy array.")
+             "Get the most recently rendered audio as a numpy array. After a render "
+             "loaded from the render cache, the array is a read-only view of the "
+             "cached file.")
         .def("get_audio", &RenderEngine::getAudioFramesForName, arg("name"),
              "Get the most recently rendered audio for a specific "
              "processor.")
+        .def("detach_audio", &RenderEngine::detachAudioFrames,
+             "Like `get_audio`, but the engine releases its reference to the "
+             "recording, so the next render records into a new buffer.")
+        .def("detach_audio", &RenderEngine::detachAudioFramesForName, arg("name"),
+             "Like `get_audio` for a specific processor, but the processor "
+             "releases its reference to the recording.")
         .def("remove_processor", &RenderEngine::removeProcessor, arg("name"),
              "Remove a processor based on its unique name. Existing "
              "Python "
@@ -500,8 +735,11 @@ Unlike a VST, the parameters don't need to be between 0 and 1. For example, you
         .def("make_oscillator_processor", &RenderEngine::makeOscillatorProcessor, arg("name"),
              arg("frequency"), "Make an Oscillator Processor", returnPolicy)
         .def("make_plugin_processor", &RenderEngine::makePluginProcessor, arg("name"),
-             arg("plugin_path"), nb::call_guard<nb::gil_scoped_release>(),
-             "Make a Plugin Processor", returnPolicy)
+             arg("plugin_path"), kw_only(), arg("isolated") = false,
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Make a Plugin Processor. With `isolated`, the plugin runs in a helper process, so "
+             "a crash in the plugin raises an exception instead of ending this one.",
+             returnPolicy)
         .def("make_sampler_processor", &RenderEngine::makeSamplerProcessor, arg("name"),
              arg("data"),
              "Make a Sampler Processor with audio data to be used as the "
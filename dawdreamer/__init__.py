@@ -1,3 +1,6 @@
+import os as _os
+import sys as _sys
+
 from .dawdreamer import *
 
 # Version is written to _version.py by setup.py during installation
@@ -5,3 +8,8 @@ try:
     from ._version import __version__
 except ImportError:
     __version__ = "unknown"
+
+# Isolated plugins are hosted by a helper process running this package's
+# _isolated_host.py with the same interpreter.
+_isolated_host = _os.path.join(_os.path.dirname(_os.path.abspath(__file__)), "_isolated_host.py")
+PluginProcessor._set_isolated_host_command([_sys.executable, _isolated_host])
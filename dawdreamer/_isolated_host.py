@@ -0,0 +1,16 @@
+"""The helper process of an isolated plugin (see ``make_plugin_processor``).
+
+``PluginProcessor`` starts it as ``python _isolated_host.py <pipe name>``.
+"""
+
+import os
+import sys
+
+if __name__ == "__main__":
+    # Run as a script, this file's directory comes first on sys.path, which
+    # would import the extension module on its own instead of the package.
+    sys.path[0] = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+    import dawdreamer
+
+    dawdreamer.PluginProcessor._run_isolated_host(sys.argv[1])
@@ -60,6 +60,28 @@ def load_audio_file(file_path: str, duration=None, offset=0) -> np.ndarray:
     return sig.astype(np.float32)
 
 
+def load_disco_stem(stem: str, duration=None) -> np.ndarray:
+    """Load a stem ("bass", "drums", "other" or "vocals") of the Music Delta disco song."""
+    return load_audio_file(ASSETS / "Music Delta - Disco" / f"{stem}.wav", duration=duration)
+
+
+def make_drums_filter_engine(duration: float, buffer_size=128):
+    """Make a RenderEngine that plays the disco drums through a 1 kHz low-pass filter.
+
+    Args:
+        duration: Seconds of drums to load.
+        buffer_size: The engine's block size.
+
+    Returns:
+        The engine, its playback processor ("drums") and its filter ("filter").
+    """
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    playback = engine.make_playback_processor("drums", load_disco_stem("drums", duration))
+    filter_processor = engine.make_filter_processor("filter", "low", 1000.0, 0.7, 1.0)
+    engine.load_graph([(playback, []), (filter_processor, ["drums"])])
+    return engine, playback, filter_processor
+
+
 def render(engine, file_path=None, duration=5.0):
     assert engine.render(duration)
 
@@ -0,0 +1,87 @@
+"""
+Compare RenderEngine's executors ("graph" and "flat") on a wide graph (many
+parallel branches into one mixer) and a deep graph (one long chain of effects).
+
+    python benchmark_executor.py --width 64 --depth 64 --duration 10
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import dawdreamer as daw
+
+SAMPLE_RATE = 44100
+
+
+def load_wide_graph(engine, width, duration):
+    rng = np.random.default_rng(0)
+    graph = []
+    branches = []
+    for i in range(width):
+        audio = rng.uniform(-0.5, 0.5, (2, int(duration * SAMPLE_RATE))).astype(np.float32)
+        graph.append((engine.make_playback_processor(f"source{i}", audio), []))
+        freq = 200.0 + 8000.0 * i / width
+        graph.append((engine.make_filter_processor(f"filter{i}", "low", freq), [f"source{i}"]))
+        branches.append(f"filter{i}")
+    graph.append((engine.make_add_processor("mixer", [1.0 / width] * width), branches))
+    engine.load_graph(graph)
+
+
+def load_deep_graph(engine, depth, duration):
+    rng = np.random.default_rng(0)
+    audio = rng.uniform(-0.5, 0.5, (2, int(duration * SAMPLE_RATE))).astype(np.float32)
+    graph = [(engine.make_playback_processor("source", audio), [])]
+    previous = "source"
+    for i in range(depth):
+        name = f"filter{i}"
+        graph.append((engine.make_filter_processor(name, "high", 20.0 + i), [previous]))
+        previous = name
+    engine.load_graph(graph)
+
+
+def benchmark(load_graph, size, args, executor, num_threads):
+    engine = daw.RenderEngine(SAMPLE_RATE, args.buffer_size)
+    engine.executor = executor
+    engine.num_threads = num_threads
+    load_graph(engine, size, args.duration)
+
+    # The first render connects and prepares the graph.
+    engine.render(args.duration)
+
+    times = []
+    for _ in range(args.repeats):
+        start = time.perf_counter()
+        engine.render(args.duration)
+        times.append(time.perf_counter() - start)
+    return min(times), engine.get_audio()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--width", type=int, default=64)
+    parser.add_argument("--depth", type=int, default=64)
+    parser.add_argument("--duration", type=float, default=10.0)
+    parser.add_argument("--buffer-size", type=int, default=512)
+    parser.add_argument("--repeats", type=int, default=3)
+    parser.add_argument("--threads", type=int, default=4)
+    args = parser.parse_args()
+
+    for name, load_graph, size in [
+        ("wide", load_wide_graph, args.width),
+        ("deep", load_deep_graph, args.depth),
+    ]:
+        baseline, expected = benchmark(load_graph, size, args, "graph", 1)
+        print(f"{name} ({size} nodes), graph: {baseline:.3f} s")
+        for executor, num_threads in [("flat", 1), ("graph", args.threads), ("flat", args.threads)]:
+            elapsed, audio = benchmark(load_graph, size, args, executor, num_threads)
+            assert np.allclose(audio, expected, atol=1e-5)
+            print(
+                f"{name} ({size} nodes), {executor} with {num_threads} threads: {elapsed:.3f} s "
+                f"({baseline / elapsed:.2f}x)"
+            )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,116 @@
+from dawdreamer_utils import *
+
+DURATION = 4.0
+PPQN = 960
+
+
+def _render_steps(buffer_size, adaptive_blocks):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    engine.adaptive_blocks = adaptive_blocks
+
+    # The tempo alternates between 97 and 150 BPM every three quarter notes.
+    bpm = np.where((np.arange(64) // 3) % 2, 150.0, 97.0).astype(np.float32)
+    engine.set_bpm(bpm, ppqn=4)
+
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+
+    # Audio-rate automation that jumps every 1000 samples.
+    num_samples = int(DURATION * SAMPLE_RATE)
+    low = engine.make_filter_processor("low", "low", 1000.0, 0.7, 1.0)
+    low.set_automation("freq", np.where((np.arange(num_samples) // 1000) % 2, 3000.0, 200.0))
+
+    # Automation in beats that jumps every 300 pulses.
+    high = engine.make_filter_processor("high", "high", 1000.0, 0.7, 1.0)
+    steps = np.where((np.arange(16 * PPQN) // 300) % 2, 5000.0, 400.0)
+    high.set_automation("freq", steps, ppqn=PPQN)
+
+    engine.load_graph([(playback, []), (low, ["drums"]), (high, ["low"])])
+    engine.render(DURATION)
+    return engine.get_audio()
+
+
+def test_adaptive_blocks_match_small_buffer():
+    expected = _render_steps(1, False)
+    audio = _render_steps(512, True)
+
+    assert np.mean(np.abs(expected)) > 0.001
+    assert np.allclose(audio, expected, atol=1e-5)
+
+    # Filters also split their own blocks where their automation steps, so
+    # without it the steps still take effect on the exact sample.
+    coarse = _render_steps(512, False)
+    assert np.allclose(coarse, expected, atol=1e-5)
+
+
+def _render_notes(buffer_size, adaptive_blocks):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    engine.adaptive_blocks = adaptive_blocks
+    engine.set_bpm(120.0)
+
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    for i, note in enumerate([60, 64, 67, 72]):
+        faust_processor.add_midi_note(note, 100, 0.1 + 0.37 * i, 0.3)
+        faust_processor.add_midi_note(note + 12, 90, 0.55 + 1.13 * i, 0.2, beats=True)
+
+    engine.load_graph([(faust_processor, [])])
+    engine.render(DURATION)
+    return engine.get_audio()
+
+
+def test_adaptive_blocks_midi():
+    expected = _render_notes(1, False)
+    audio = _render_notes(512, True)
+
+    assert np.mean(np.abs(expected)) > 0.001
+    assert np.allclose(audio, expected, atol=1e-4)
+
+
+def test_adaptive_blocks_property():
+    engine = daw.RenderEngine(SAMPLE_RATE, 128)
+    assert not engine.adaptive_blocks
+
+    engine.adaptive_blocks = True
+    assert engine.adaptive_blocks
+
+
+def _render_ramp(automation, adaptive_blocks, automation_block_size=0):
+    engine = daw.RenderEngine(SAMPLE_RATE, 512)
+    engine.adaptive_blocks = adaptive_blocks
+    engine.automation_block_size = automation_block_size
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+    low = engine.make_filter_processor("low", "low", 1000.0, 0.7, 1.0)
+    low.set_automation("freq", automation)
+    engine.load_graph([(playback, []), (low, ["drums"])])
+    engine.render(DURATION)
+    return engine.get_audio(), engine.sub_blocks
+
+
+def test_adaptive_blocks_ramp():
+    num_samples = int(DURATION * SAMPLE_RATE)
+    # The ramp is longer than the render, so it doesn't end within it.
+    ramp = np.linspace(200.0, 5000.0, 2 * num_samples, dtype=np.float32)
+    expected, num_blocks = _render_ramp(ramp, False)
+    assert num_blocks == -(-num_samples // 512)
+
+    # A ramp changes at every sample, but it has no steps to split at.
+    audio, sub_blocks = _render_ramp(ramp, True)
+    assert sub_blocks == num_blocks
+    assert np.allclose(audio, expected)
+
+    # A ramp that levels off splits the block where it ends.
+    ramp[SAMPLE_RATE:] = ramp[SAMPLE_RATE]
+    _, sub_blocks = _render_ramp(ramp, True)
+    assert sub_blocks == num_blocks + 1
+
+    # Steps split blocks, unless the processor already follows its automation
+    # within the block.
+    steps = np.where((np.arange(num_samples) // 1000) % 2, 3000.0, 200.0)
+    _, sub_blocks = _render_ramp(steps, True)
+    assert sub_blocks > num_blocks + 100
+    _, sub_blocks = _render_ramp(steps, True, automation_block_size=1)
+    assert sub_blocks == num_blocks
@@ -0,0 +1,117 @@
+from dawdreamer_utils import *
+
+DURATION = 1.0
+
+
+def _render(buffer_size, automation_block_size, processor_type):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    engine.automation_block_size = automation_block_size
+
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+
+    num_samples = int(DURATION * SAMPLE_RATE)
+    sweep = make_sine(3.0, DURATION)[:num_samples]
+
+    if processor_type == "filter":
+        processor = engine.make_filter_processor("effect", "low", 1000.0, 0.7, 1.0)
+        processor.set_automation("freq", 1500.0 + 1200.0 * sweep)
+    elif processor_type == "compressor":
+        processor = engine.make_compressor_processor("effect", -20.0, 4.0, 2.0, 50.0)
+        processor.set_automation("threshold", -20.0 + 15.0 * sweep)
+    else:
+        processor = engine.make_faust_processor("effect")
+        processor.set_dsp_string("""
+            declare name "Filter";
+            import("stdfaust.lib");
+            cutoff = hslider("cutoff", 1000., 20., 20000., .001);
+            process = fi.lowpass(2, cutoff), fi.lowpass(2, cutoff);
+            """)
+        processor.set_automation("/Filter/cutoff", 1500.0 + 1200.0 * sweep)
+
+    processor.record_automation = True
+
+    engine.load_graph([(playback, []), (processor, ["drums"])])
+    engine.render(DURATION)
+
+    return engine.get_audio(), processor.get_automation()
+
+
+@pytest.mark.parametrize("processor_type", ["filter", "compressor", "faust"])
+def test_automation_block_size_matches_small_buffer(processor_type):
+    expected, expected_automation = _render(1, 0, processor_type)
+    audio, automation = _render(256, 1, processor_type)
+
+    assert np.allclose(audio, expected, atol=1e-5)
+    for name, values in expected_automation.items():
+        assert np.allclose(automation[name], values)
+
+    # Without it, automation only changes once per block.
+    coarse, _ = _render(256, 0, processor_type)
+    assert not np.allclose(coarse, expected, atol=1e-5)
+
+
+def test_automation_block_size_records_sub_blocks():
+    _, automation = _render(256, 32, "filter")
+    freq = automation["freq"].reshape(-1)
+
+    # One value per sub-block, and different values across a block.
+    assert np.all(freq[:32] == freq[0])
+    assert freq[32] != freq[0]
+
+
+def _render_steps(buffer_size):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    playback = engine.make_playback_processor("drums", load_disco_stem("drums", DURATION))
+    low = engine.make_filter_processor("low", "low", 1000.0, 0.7, 1.0)
+    num_samples = int(DURATION * SAMPLE_RATE)
+    low.set_automation("freq", np.where((np.arange(num_samples) // 1000) % 2, 3000.0, 200.0))
+    low.record_automation = True
+    engine.load_graph([(playback, []), (low, ["drums"])])
+    engine.render(DURATION)
+    return engine.get_audio(), low.get_automation()["freq"].reshape(-1)
+
+
+def test_automation_steps_split_blocks():
+    # Automation that steps is applied on the exact sample without an
+    # automation block size.
+    expected, expected_freq = _render_steps(1)
+    audio, freq = _render_steps(512)
+    assert np.allclose(audio, expected, atol=1e-5)
+    assert np.array_equal(freq, expected_freq)
+    assert freq[999] == 200.0 and freq[1000] == 3000.0
+
+
+def _render_plugin(plugin_path, buffer_size, automation_block_size):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    engine.automation_block_size = automation_block_size
+
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+
+    num_samples = int(DURATION * SAMPLE_RATE)
+    effect = engine.make_plugin_processor("effect", plugin_path)
+    effect.set_automation(0, 0.5 + 0.4 * make_sine(3.0, DURATION)[:num_samples])
+
+    engine.load_graph([(playback, []), (effect, ["drums"])])
+    engine.render(DURATION)
+    return engine.get_audio()
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_automation_block_size_plugin(plugin_path):
+    # Sub-blocks of 32 samples behave like a buffer size of 32.
+    expected = _render_plugin(plugin_path, 32, 0)
+    audio = _render_plugin(plugin_path, 512, 32)
+    assert np.allclose(audio, expected, atol=1e-4)
+
+
+def test_automation_block_size_validation():
+    engine = daw.RenderEngine(SAMPLE_RATE, 128)
+    assert engine.automation_block_size == 0
+
+    engine.automation_block_size = 16
+    assert engine.automation_block_size == 16
+
+    with pytest.raises(Exception):
+        engine.automation_block_size = -1
@@ -195,6 +195,49 @@ def test_automation_record_faust():
     )
 
 
+def test_automation_record_after_recompile():
+    """Automation is recorded for the new parameters after the DSP is recompiled."""
+
+    DURATION = 1.0
+    BUFFER_SIZE = 128
+
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.record_automation = True
+    faust_processor.set_dsp_string("""
+        declare name "First";
+        import("stdfaust.lib");
+        freq = hslider("freq", 1000., 20., 20000., .001);
+        process = no.noise : _*.1 : fi.lowpass(10, freq) <: si.bus(2);
+        """)
+    faust_processor.set_automation("/First/freq", np.linspace(100.0, 1000.0, 1000, dtype=np.float32))
+    engine.load_graph([(faust_processor, [])])
+    engine.render(DURATION)
+    assert list(faust_processor.get_automation().keys()) == ["/First/freq"]
+
+    faust_processor.set_dsp_string("""
+        declare name "Second";
+        import("stdfaust.lib");
+        cutoff = hslider("cutoff", 1000., 20., 20000., .001);
+        gain = hslider("gain", 0.5, 0., 1., .001);
+        process = no.noise : _*gain : fi.lowpass(10, cutoff) <: si.bus(2);
+        """)
+    gain = np.linspace(0.0, 1.0, int(DURATION * SAMPLE_RATE), dtype=np.float32)
+    faust_processor.set_automation("/Second/gain", gain)
+    engine.load_graph([(faust_processor, [])])
+    engine.render(DURATION)
+
+    all_automation = faust_processor.get_automation()
+    assert sorted(all_automation.keys()) == ["/Second/cutoff", "/Second/gain"]
+    assert np.allclose(all_automation["/Second/cutoff"], 1000.0)
+
+    # Automation is sampled once per block.
+    recorded = all_automation["/Second/gain"].reshape(-1)
+    block_starts = np.arange(0, len(gain), BUFFER_SIZE)
+    assert np.allclose(recorded[block_starts], gain[block_starts])
+
+
 def test_automation_record_plugin():
     """The purpose of this test is to use these functions:
     * `processor.record_automation = True`
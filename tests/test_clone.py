@@ -0,0 +1,148 @@
+from concurrent.futures import ThreadPoolExecutor
+
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 512
+DURATION = 4.0
+
+
+def _make_engine():
+    engine, playback, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    engine.set_bpm(np.linspace(90.0, 150.0, 9, dtype=np.float32), ppqn=1, ramp=True)
+
+    num_samples = int(DURATION * SAMPLE_RATE)
+    filter_processor.set_automation("freq", np.linspace(300.0, 5000.0, num_samples))
+    filter_processor.record = True
+
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp_string("""
+        declare name "Gain";
+        gain = hslider("gain", 0.5, 0., 1., .01);
+        process = *(gain), *(gain);
+        """)
+    faust_processor.compile()
+    faust_processor.set_parameter("/Gain/gain", 0.8)
+
+    delay = engine.make_delay_processor("delay", "linear", 120.0, 0.3)
+
+    engine.load_graph(
+        [
+            (playback, []),
+            (filter_processor, ["drums"]),
+            (faust_processor, ["filter"]),
+            (delay, ["faust"]),
+        ]
+    )
+    return engine
+
+
+def test_clone_renders_the_same():
+    engine = _make_engine()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+    assert np.mean(np.abs(expected)) > 0.001
+
+    clones = engine.clone(2)
+    assert len(clones) == 2
+    for clone in clones:
+        assert clone.get_processor("filter") is not None
+        clone.render(DURATION)
+        assert np.allclose(clone.get_audio(), expected, atol=1e-6)
+        assert np.allclose(clone.get_audio("filter"), engine.get_audio("filter"), atol=1e-6)
+
+
+def test_clones_are_independent():
+    engine = _make_engine()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    (clone,) = engine.clone()
+    clone.get_processor("filter").set_automation("freq", np.array([200.0]))
+    clone.get_processor("faust").set_parameter("/Gain/gain", 0.1)
+    clone.render(DURATION)
+    assert not np.allclose(clone.get_audio(), expected, atol=1e-3)
+
+    # The original keeps its own automation and parameters.
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+    # And the clone outlives it.
+    del engine
+    clone.render(DURATION)
+    assert clone.get_audio().shape == expected.shape
+
+
+def test_clones_render_in_parallel():
+    engine = _make_engine()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    def render(clone):
+        clone.render(DURATION)
+        return clone.get_audio()
+
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        outputs = list(pool.map(render, engine.clone(4)))
+
+    for audio in outputs:
+        assert np.allclose(audio, expected, atol=1e-6)
+
+
+def test_graph_executor_on_another_thread():
+    engine = _make_engine()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+    (clone,) = engine.clone(1)
+    assert clone.executor == "graph"
+
+    with ThreadPoolExecutor(max_workers=1) as pool:
+        # JUCE's graph only renders on the thread that first used DawDreamer.
+        with pytest.raises(Exception, match="executor"):
+            pool.submit(engine.render, DURATION).result()
+
+        # Clones use the flat plan wherever they render.
+        pool.submit(clone.render, DURATION).result()
+        assert np.allclose(clone.get_audio(), expected, atol=1e-6)
+
+        engine.executor = "flat"
+        pool.submit(engine.render, DURATION).result()
+        assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+
+def test_clone_sampler_and_warp():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.set_bpm(120.0)
+
+    audio = load_disco_stem("drums", DURATION)
+    warp = engine.make_playbackwarp_processor("drums", audio)
+    assert warp.set_clip_file(abspath(ASSETS / "Music Delta - Disco" / "drums.wav.asd"))
+    warp.set_clip_positions([[0.0, 2.0, 0.0], [4.0, 6.0, 1.0]])
+    warp.transpose = 2.0
+
+    sampler = engine.make_sampler_processor(
+        "sampler", load_audio_file(ASSETS / "60988__folktelemetry__crash-fast-14.wav")
+    )
+    sampler.add_midi_note(60, 100, 0.5, 1.0)
+
+    add = engine.make_add_processor("add", [1.0, 1.0])
+    engine.load_graph([(warp, []), (sampler, []), (add, ["drums", "sampler"])])
+    engine.render(DURATION)
+    expected = engine.get_audio()
+    assert np.mean(np.abs(expected)) > 0.001
+
+    (clone,) = engine.clone()
+    clone.render(DURATION)
+    assert np.allclose(clone.get_audio(), expected, atol=1e-6)
+
+    # The clone shares the audio, but new data on the original doesn't reach it.
+    warp.set_data(np.zeros_like(audio))
+    clone.render(DURATION)
+    assert np.allclose(clone.get_audio(), expected, atol=1e-6)
+
+
+def test_clone_validation():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    assert len(engine.clone()) == 1
+
+    with pytest.raises(Exception):
+        engine.clone(0)
@@ -0,0 +1,78 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 256
+DURATION = 3.0
+
+
+def _load_wide_and_deep_graph(engine):
+    graph = []
+    branches = []
+    for stem in ["bass", "drums", "other", "vocals"]:
+        audio = load_audio_file(ASSETS / "Music Delta - Disco" / f"{stem}.wav", duration=DURATION)
+        graph.append((engine.make_playback_processor(stem, audio), []))
+        previous = stem
+        for i, freq in enumerate([6000.0, 3000.0, 1500.0]):
+            name = f"{stem}_filter{i}"
+            graph.append((engine.make_filter_processor(name, "low", freq, 0.7, 1.0), [previous]))
+            previous = name
+        branches.append(previous)
+
+    graph.append((engine.make_add_processor("mixer", [0.25] * len(branches)), branches))
+    graph.append((engine.make_compressor_processor("compressor", -20.0, 4.0, 2.0, 50.0), ["mixer"]))
+    engine.load_graph(graph)
+
+
+def _render(executor: str, num_threads: int = 1):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.executor = executor
+    engine.num_threads = num_threads
+    _load_wide_and_deep_graph(engine)
+
+    sweep = np.linspace(500.0, 5000.0, int(DURATION * SAMPLE_RATE), dtype=np.float32)
+    engine.get_processor("drums_filter1").set_automation("freq", sweep)
+    engine.get_processor("bass_filter0").record = True
+
+    engine.render(DURATION)
+    return engine.get_audio(), engine.get_audio("bass_filter0")
+
+
+@pytest.mark.parametrize("num_threads", [1, 4])
+def test_flat_executor_matches_graph(num_threads):
+    expected, expected_bass = _render("graph")
+    audio, bass = _render("flat", num_threads)
+
+    assert np.mean(np.abs(expected)) > 0.001
+    assert np.allclose(audio, expected, atol=1e-6)
+    assert np.allclose(bass, expected_bass, atol=1e-6)
+
+
+def test_flat_executor_rerender():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.executor = "flat"
+    assert engine.executor == "flat"
+    _load_wide_and_deep_graph(engine)
+
+    engine.render(DURATION)
+    first = engine.get_audio()
+
+    # Processors left out of the graph aren't processed.
+    drums = engine.get_processor("drums")
+    drums_filter = engine.get_processor("drums_filter0")
+    engine.load_graph([(drums, []), (drums_filter, ["drums"])])
+    engine.render(DURATION)
+    engine.executor = "graph"
+    engine.render(DURATION)
+    graph_audio = engine.get_audio()
+    engine.executor = "flat"
+    engine.render(DURATION)
+
+    assert not np.allclose(first, engine.get_audio())
+    assert np.allclose(engine.get_audio(), graph_audio, atol=1e-6)
+
+
+def test_executor_validation():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    assert engine.executor == "graph"
+
+    with pytest.raises(Exception):
+        engine.executor = "fast"
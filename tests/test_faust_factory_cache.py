@@ -0,0 +1,120 @@
+import os
+
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 1.0
+
+DSP_CODE = """
+declare name "Tone";
+cutoff = hslider("cutoff", 2000., 20., 20000., .001);
+process = os.osc(440.) * .25 : fi.lowpass(2, cutoff) <: _, _;
+"""
+
+
+def _render(engine, num_processors, code=DSP_CODE, num_voices=0):
+    graph = []
+    for i in range(num_processors):
+        faust_processor = engine.make_faust_processor(f"faust_{i}")
+        faust_processor.num_voices = num_voices
+        faust_processor.set_dsp_string(code)
+        faust_processor.compile()
+        graph.append((faust_processor, []))
+
+    add = engine.make_add_processor("add", [1.0] * num_processors)
+    graph.append((add, [f"faust_{i}" for i in range(num_processors)]))
+
+    engine.load_graph(graph)
+    engine.render(DURATION)
+    return engine.get_audio()
+
+
+def test_identical_processors_share_a_factory():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    single = _render(engine, 1)
+
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    many = _render(engine, 8)
+
+    assert np.mean(np.abs(single)) > 0.01
+    assert np.allclose(many, single * 8, atol=1e-4)
+
+    # Each processor still has its own parameters.
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    a = engine.make_faust_processor("a")
+    b = engine.make_faust_processor("b")
+    for faust_processor in [a, b]:
+        faust_processor.set_dsp_string(DSP_CODE)
+        faust_processor.compile()
+    a.set_parameter("/Tone/cutoff", 100.0)
+    assert b.get_parameter("/Tone/cutoff") == pytest.approx(2000.0)
+
+
+def test_different_options_compile_separately():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp_string(DSP_CODE)
+    faust_processor.compile()
+    assert faust_processor.get_num_output_channels() == 2
+
+    faust_processor.set_dsp_string(DSP_CODE.replace("<: _, _", ""))
+    faust_processor.compile()
+    assert faust_processor.get_num_output_channels() == 1
+
+
+def test_factory_cache_dir(tmp_path):
+    daw.faust.set_factory_cache_dir(str(tmp_path))
+    try:
+        assert daw.faust.get_factory_cache_dir() == str(tmp_path)
+
+        code = DSP_CODE.replace("440.", "523.25")
+
+        engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+        expected = _render(engine, 1, code=code)
+        del engine
+
+        assert len(list(tmp_path.glob("*.bc"))) == 1
+
+        # With nothing left in memory, the factory is read back from disk.
+        daw.faust.clear_factory_cache()
+        engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+        audio = _render(engine, 1, code=code)
+
+        assert np.allclose(audio, expected)
+    finally:
+        daw.faust.set_factory_cache_dir("")
+
+
+def test_changed_library_recompiles(tmp_path):
+    library_dir = tmp_path / "libraries"
+    library_dir.mkdir()
+    library = library_dir / "gain.lib"
+    code = 'import("gain.lib");\nprocess = os.osc(440.) * gain <: _, _;'
+
+    def render():
+        engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+        faust_processor = engine.make_faust_processor("faust")
+        faust_processor.faust_libraries_paths = [str(library_dir)]
+        faust_processor.set_dsp_string(code)
+        faust_processor.compile()
+        engine.load_graph([(faust_processor, [])])
+        engine.render(DURATION)
+        return engine.get_audio()
+
+    daw.faust.set_factory_cache_dir(str(tmp_path / "cache"))
+    try:
+        library.write_text("gain = .25;")
+        quiet = render()
+
+        # The code is unchanged, so only the library tells the caches apart.
+        library.write_text("gain = .5;")
+        os.utime(library, (library.stat().st_atime, library.stat().st_mtime + 10))
+        assert np.allclose(render(), quiet * 2, atol=1e-4)
+
+        # The bitcode saved for the old library isn't read back either.
+        daw.faust.clear_factory_cache()
+        library.write_text("gain = .125;")
+        os.utime(library, (library.stat().st_atime, library.stat().st_mtime + 20))
+        assert np.allclose(render(), quiet / 2, atol=1e-4)
+    finally:
+        daw.faust.set_factory_cache_dir("")
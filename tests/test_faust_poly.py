@@ -178,3 +178,16 @@ def test_faust_sine(midi_path: str, bpm_automation: bool, beats: bool, buffer_si
 
     audio = engine.get_audio()
     assert np.mean(np.abs(audio)) > 0.0001
+
+
+@pytest.mark.parametrize("buffer_size", [64, 512])
+def test_faust_poly_buffer_size(buffer_size):
+    """Notes start and stop on the same sample no matter how large the blocks are."""
+
+    audio1 = _test_faust_poly(OUTPUT / "test_faust_poly_bs_1.wav", buffer_size=1)
+    audio2 = _test_faust_poly(
+        OUTPUT / f"test_faust_poly_bs_{buffer_size}.wav", buffer_size=buffer_size
+    )
+
+    assert np.mean(np.abs(audio1)) > 0.001
+    assert np.allclose(audio1, audio2, atol=1e-6)
@@ -0,0 +1,60 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def _make_engine():
+    engine, playback, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    playback.record = True
+    return engine, playback, filter_processor
+
+
+def test_get_audio_is_not_modified_by_later_renders():
+    engine, playback, filter_processor = _make_engine()
+
+    engine.render(DURATION)
+    first = engine.get_audio()
+    first_copy = first.copy()
+
+    # get_audio doesn't copy, so repeated calls see the same memory.
+    assert np.shares_memory(first, engine.get_audio())
+
+    filter_processor.frequency = 200.0
+    engine.render(DURATION)
+    second = engine.get_audio()
+
+    assert np.array_equal(first, first_copy)
+    assert not np.shares_memory(first, second)
+    assert not np.allclose(first, second)
+
+
+def test_get_audio_outlives_processor():
+    engine, playback, filter_processor = _make_engine()
+    engine.render(DURATION)
+
+    audio = playback.get_audio()
+    expected = audio.copy()
+    del engine, playback, filter_processor
+
+    assert np.array_equal(audio, expected)
+
+
+def test_detach_audio():
+    engine, playback, filter_processor = _make_engine()
+    engine.render(DURATION)
+
+    expected = engine.get_audio().copy()
+    detached = engine.detach_audio()
+
+    assert np.array_equal(detached, expected)
+    assert engine.get_audio().shape == (2, 0)
+
+    drums = engine.detach_audio("drums")
+    assert drums.shape == (2, int(DURATION * SAMPLE_RATE))
+    assert playback.get_audio().shape == (2, 0)
+
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected)
+    assert not np.shares_memory(engine.get_audio(), detached)
+    assert np.array_equal(detached, expected)
@@ -0,0 +1,118 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def _make_processors(engine):
+    engine.make_playback_processor("drums", load_disco_stem("drums", DURATION))
+    engine.make_filter_processor("low", "low", 500.0)
+    engine.make_filter_processor("high", "high", 2000.0)
+    engine.make_compressor_processor("compressor", -20.0, 4.0, 2.0, 50.0)
+
+
+GRAPH_LOW = [("drums", []), ("low", ["drums"]), ("compressor", ["low"])]
+GRAPH_HIGH = [("drums", []), ("high", ["drums"]), ("compressor", ["high"])]
+
+
+def _load(engine, graph):
+    engine.load_graph([(engine.get_processor(name), inputs) for name, inputs in graph])
+
+
+def _render_fresh(graph):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    _make_processors(engine)
+    _load(engine, graph)
+    engine.render(DURATION)
+    return engine.get_audio()
+
+
+def test_swapping_an_effect_matches_a_fresh_graph():
+    expected_low = _render_fresh(GRAPH_LOW)
+    expected_high = _render_fresh(GRAPH_HIGH)
+    assert not np.allclose(expected_low, expected_high)
+
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    _make_processors(engine)
+
+    for graph, expected in [
+        (GRAPH_LOW, expected_low),
+        (GRAPH_HIGH, expected_high),
+        (GRAPH_HIGH, expected_high),
+        (GRAPH_LOW, expected_low),
+    ]:
+        _load(engine, graph)
+        engine.render(DURATION)
+        assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+
+def test_replacing_a_processor_with_the_same_name():
+    expected = _render_fresh(GRAPH_HIGH)
+
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    _make_processors(engine)
+    _load(engine, GRAPH_HIGH)
+    engine.render(DURATION)
+
+    # Replacing "high" removes the old node, so the graph must be rewired to
+    # the new one even though the names in the DAG are the same.
+    engine.make_filter_processor("high", "high", 2000.0)
+    _load(engine, GRAPH_HIGH)
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+
+def test_adding_a_processor_to_the_graph():
+    graph = [("drums", []), ("low", ["drums"]), ("high", ["low"]), ("compressor", ["high"])]
+    expected = _render_fresh(graph)
+
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    _make_processors(engine)
+    _load(engine, GRAPH_LOW)
+    engine.render(DURATION)
+
+    _load(engine, graph)
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+
+def test_recompiling_the_last_processor_with_more_outputs():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    audio = load_disco_stem("drums", DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp_string("process = _, _;")
+    engine.load_graph([(playback, []), (faust_processor, ["drums"])])
+    engine.render(DURATION)
+    assert engine.get_audio().shape[0] == 2
+
+    # The edges stay the same, but the JUCE graph must be prepared again for
+    # the new number of outputs.
+    faust_processor.set_dsp_string("process = _, _ <: _, _, _, _;")
+    faust_processor.compile()
+    engine.render(DURATION)
+    output = engine.get_audio()
+    assert output.shape[0] == 4
+    assert np.allclose(output[:2], audio[:, : output.shape[1]], atol=1e-6)
+    assert np.allclose(output[2:], output[:2])
+
+
+def test_removed_processor_is_not_processed():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    _make_processors(engine)
+    low = engine.get_processor("low")
+    low.record = True
+    _load(engine, GRAPH_LOW)
+    engine.render(DURATION)
+    recorded = engine.get_audio("low").copy()
+    assert np.abs(recorded).max() > 0.01
+
+    # Processing "low" without its input would record silence over its audio.
+    _load(engine, GRAPH_HIGH)
+    engine.render(DURATION)
+    assert np.array_equal(engine.get_audio("low"), recorded)
+
+    # Bringing it back prepares and connects it again.
+    _load(engine, GRAPH_LOW)
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio("low"), recorded, atol=1e-6)
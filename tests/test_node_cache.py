@@ -0,0 +1,98 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def _make_engine(node_cache_mb):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.node_cache_mb = node_cache_mb
+
+    graph = []
+    branches = []
+    for stem in ["bass", "drums"]:
+        audio = load_disco_stem(stem, DURATION)
+        graph.append((engine.make_playback_processor(stem, audio), []))
+        graph.append((engine.make_filter_processor(f"{stem}_filter", "low", 2000.0), [stem]))
+        branches.append(f"{stem}_filter")
+
+    graph.append((engine.make_add_processor("mixer", [0.5, 0.5]), branches))
+    graph.append((engine.make_filter_processor("output", "high", 100.0), ["mixer"]))
+    engine.load_graph(graph)
+    return engine
+
+
+def test_node_cache_matches_uncached_render():
+    engine = _make_engine(64.0)
+    reference = _make_engine(0.0)
+
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 0
+    reference.render(DURATION)
+    assert np.array_equal(engine.get_audio(), reference.get_audio())
+
+    # Nothing changed, so the output comes straight from the cache.
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 1
+    assert np.array_equal(engine.get_audio(), reference.get_audio())
+
+    # Only the processors after the change are processed again.
+    for e in [engine, reference]:
+        e.get_processor("output").frequency = 500.0
+        e.render(DURATION)
+    assert engine.node_cache_hits == 1
+    assert np.array_equal(engine.get_audio(), reference.get_audio())
+
+    for e in [engine, reference]:
+        e.get_processor("drums_filter").set_automation(
+            "freq", np.linspace(200.0, 8000.0, int(DURATION * SAMPLE_RATE), dtype=np.float32)
+        )
+        e.render(DURATION)
+    # The bass filter and the drums playback.
+    assert engine.node_cache_hits == 2
+    assert np.array_equal(engine.get_audio(), reference.get_audio())
+    assert np.mean(np.abs(engine.get_audio())) > 0.001
+
+
+def test_node_cache_records_cached_processors():
+    engine = _make_engine(64.0)
+    engine.get_processor("bass_filter").record = True
+
+    engine.render(DURATION)
+    expected = engine.get_audio("bass_filter").copy()
+
+    engine.get_processor("output").frequency = 500.0
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 2
+    assert np.array_equal(engine.get_audio("bass_filter"), expected)
+
+
+def test_node_cache_render_settings():
+    engine = _make_engine(64.0)
+    engine.render(DURATION)
+
+    # A different duration or tempo can't reuse the outputs.
+    engine.render(DURATION / 2)
+    assert engine.node_cache_hits == 0
+    engine.set_bpm(140.0)
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 0
+
+
+def test_node_cache_size():
+    engine = _make_engine(0.1)
+    assert engine.node_cache_mb == pytest.approx(0.1)
+
+    # Each output needs about 1.3 MB, more than the cache holds.
+    engine.render(DURATION)
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 0
+
+    engine.node_cache_mb = 64.0
+    engine.render(DURATION)
+    engine.clear_node_cache()
+    engine.render(DURATION)
+    assert engine.node_cache_hits == 0
+
+    with pytest.raises(Exception):
+        engine.node_cache_mb = -1.0
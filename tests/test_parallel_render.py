@@ -0,0 +1,125 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 512
+DURATION = 5.0
+
+
+def _render_wide_graph(num_threads: int):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.num_threads = num_threads
+
+    stems = ["bass", "drums", "other", "vocals"]
+
+    graph = []
+    for stem in stems:
+        audio = load_audio_file(ASSETS / "Music Delta - Disco" / f"{stem}.wav", duration=DURATION)
+        playback = engine.make_playback_processor(stem, audio)
+        filter_processor = engine.make_filter_processor(f"{stem}_filter", "low", 2000.0, 0.7, 1.0)
+        freq = np.linspace(500.0, 5000.0, int(DURATION * SAMPLE_RATE), dtype=np.float32)
+        filter_processor.set_automation("freq", freq)
+        filter_processor.record = True
+        graph += [(playback, []), (filter_processor, [stem])]
+
+    mixer = engine.make_add_processor("mixer", [0.25] * len(stems))
+    compressor = engine.make_compressor_processor("compressor", -20.0, 4.0, 2.0, 50.0)
+    graph += [(mixer, [f"{stem}_filter" for stem in stems]), (compressor, ["mixer"])]
+
+    engine.load_graph(graph)
+    engine.render(DURATION)
+
+    return engine.get_audio(), engine.get_audio("drums_filter")
+
+
+@pytest.mark.parametrize("num_threads", [2, 4, 0])
+def test_parallel_render_matches_serial(num_threads):
+    serial, serial_drums = _render_wide_graph(1)
+    parallel, parallel_drums = _render_wide_graph(num_threads)
+
+    assert np.mean(np.abs(serial)) > 0.01
+    assert serial.shape == parallel.shape
+    assert np.allclose(serial, parallel, atol=1e-6)
+    assert np.allclose(serial_drums, parallel_drums, atol=1e-6)
+
+
+def test_parallel_render_chain():
+    """A graph with no independent branches renders the same with any number of threads."""
+
+    outputs = []
+    for num_threads in [1, 4]:
+        engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+        engine.num_threads = num_threads
+        audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+        playback = engine.make_playback_processor("drums", audio)
+        filter_processor = engine.make_filter_processor("filter", "high", 1000.0)
+        engine.load_graph([(playback, []), (filter_processor, ["drums"])])
+        engine.render(DURATION)
+        outputs.append(engine.get_audio())
+
+    assert np.allclose(outputs[0], outputs[1], atol=1e-6)
+
+
+def _render_deep_graph(num_threads: int):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.num_threads = num_threads
+
+    graph = []
+    branches = []
+    for stem in ["bass", "drums", "other"]:
+        audio = load_audio_file(ASSETS / "Music Delta - Disco" / f"{stem}.wav", duration=DURATION)
+        graph.append((engine.make_playback_processor(stem, audio), []))
+        previous = stem
+        for i, freq in enumerate([4000.0, 2000.0, 1000.0, 500.0]):
+            name = f"{stem}_filter{i}"
+            graph.append((engine.make_filter_processor(name, "low", freq, 0.7, 1.0), [previous]))
+            previous = name
+        branches.append(previous)
+
+    mixer = engine.make_add_processor("mixer", [0.5] * len(branches))
+    graph.append((mixer, branches))
+
+    engine.load_graph(graph)
+    engine.render(DURATION)
+
+    return engine.get_audio()
+
+
+@pytest.mark.parametrize("num_threads", [2, 4])
+def test_parallel_render_deep_graph(num_threads):
+    """Intermediate processors share scratch buffers without changing the output."""
+
+    serial = _render_deep_graph(1)
+    parallel = _render_deep_graph(num_threads)
+
+    assert np.mean(np.abs(serial)) > 0.001
+    assert np.allclose(serial, parallel, atol=1e-6)
+
+
+def test_record_disabled_after_render():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    playback = engine.make_playback_processor("drums", audio)
+    filter_processor = engine.make_filter_processor("filter", "high", 1000.0)
+    engine.load_graph([(playback, []), (filter_processor, ["drums"])])
+
+    playback.record = True
+    engine.render(DURATION)
+    recorded = playback.get_audio()
+    expected = recorded.copy()
+    assert recorded.shape == (2, int(DURATION * SAMPLE_RATE))
+
+    playback.record = False
+    engine.render(DURATION)
+    assert playback.get_audio().shape == (2, 0)
+    # Arrays returned earlier still own their audio.
+    assert np.array_equal(recorded, expected)
+
+
+def test_num_threads_validation():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    assert engine.num_threads == 1
+
+    engine.num_threads = 0
+    assert engine.num_threads >= 1
+
+    with pytest.raises(Exception):
+        engine.num_threads = -1
@@ -0,0 +1,80 @@
+import os
+import pickle
+import signal
+import subprocess
+
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 512
+DURATION = 3.0
+
+
+def _render_effect(plugin_path, isolated):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    data = load_audio_file(ASSETS / "575854__yellowtree__d-b-funk-loop.wav", DURATION + 0.1)
+    playback_processor = engine.make_playback_processor("playback", data)
+    effect = engine.make_plugin_processor("effect", plugin_path, isolated=isolated)
+    engine.load_graph([(playback_processor, []), (effect, ["playback"])])
+    engine.render(DURATION)
+    return engine, effect
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_isolated_plugin_renders_the_same(plugin_path):
+    _, expected = _render_effect(plugin_path, False)
+    engine, effect = _render_effect(plugin_path, True)
+
+    assert effect.get_num_input_channels() == expected.get_num_input_channels()
+    assert effect.get_num_output_channels() == expected.get_num_output_channels()
+    assert effect.get_parameters_description() == expected.get_parameters_description()
+
+    audio = engine.get_audio()
+    assert np.mean(np.abs(audio)) > 0.01
+    assert np.allclose(audio, expected.get_audio(), atol=1e-5)
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_isolated_plugin_parameters_and_state(plugin_path, tmp_path):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    effect = engine.make_plugin_processor("effect", plugin_path, isolated=True)
+
+    val = effect.get_parameter(0)
+    effect.set_parameter(0, 1.0 - val)
+    assert np.isclose(effect.get_parameter(0), 1.0 - val)
+    assert isinstance(effect.get_parameter_text(0), str)
+
+    state_path = str(tmp_path / "state")
+    effect.save_state(state_path)
+    other = engine.make_plugin_processor("other", plugin_path, isolated=True)
+    other.load_state(state_path)
+    assert np.isclose(other.get_parameter(0), 1.0 - val)
+
+    engine.load_graph([(effect, [])])
+    restored = pickle.loads(pickle.dumps(engine)).get_processor("effect")
+    assert restored.isolated
+    assert np.isclose(restored.get_parameter(0), 1.0 - val)
+
+    with pytest.raises(Exception):
+        effect.open_editor()
+
+
+def _isolated_helper_pids():
+    ps = subprocess.run(["ps", "-eo", "pid=,ppid=,args="], capture_output=True, text=True)
+    pids = set()
+    for line in ps.stdout.splitlines():
+        fields = line.split(None, 2)
+        if len(fields) == 3 and int(fields[1]) == os.getpid() and "_isolated_host.py" in fields[2]:
+            pids.add(int(fields[0]))
+    return pids
+
+
+@pytest.mark.skipif(platform.system() == "Windows", reason="Finds the helper process with ps.")
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_isolated_plugin_helper_killed(plugin_path):
+    before = _isolated_helper_pids()
+    engine, _ = _render_effect(plugin_path, True)
+    (pid,) = _isolated_helper_pids() - before
+
+    os.kill(pid, signal.SIGKILL)
+    with pytest.raises(Exception):
+        engine.render(DURATION)
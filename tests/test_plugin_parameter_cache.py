@@ -0,0 +1,107 @@
+import os
+import shutil
+import xml.etree.ElementTree as ET
+
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 512
+SEARCH_STEPS = 100
+
+
+@pytest.fixture(autouse=True)
+def clear_parameter_cache():
+    daw.PluginProcessor.clear_parameter_cache()
+    yield
+    daw.PluginProcessor.clear_parameter_cache()
+
+
+def _get_ranges(effect, convert=False):
+    num_params = effect.get_plugin_parameter_size()
+    return [effect.get_parameter_range(i, SEARCH_STEPS, convert) for i in range(num_params)]
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_parameter_cache_matches_probing(plugin_path):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    effect = engine.make_plugin_processor("effect", plugin_path)
+
+    description = effect.get_parameters_description()
+    expected = _get_ranges(effect)
+    expected_converted = _get_ranges(effect, True)
+
+    # A second processor of the same plugin reads the cached tables.
+    other = engine.make_plugin_processor("other", plugin_path)
+    assert other.get_parameters_description() == description
+    assert _get_ranges(other) == expected
+    assert _get_ranges(other, True) == expected_converted
+
+    # The current values still come from the plugin.
+    other.set_parameter(0, 1.0 - other.get_parameter(0))
+    assert other.get_parameters_description()[0]["currentValText"] == other.get_parameter_text(0)
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_cache_parameter_ranges_threads(plugin_path):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    effect = engine.make_plugin_processor("effect", plugin_path)
+    value = effect.get_parameter(0)
+    expected = _get_ranges(effect)
+
+    daw.PluginProcessor.clear_parameter_cache()
+    effect.cache_parameter_ranges(SEARCH_STEPS, num_threads=2)
+    assert _get_ranges(effect) == expected
+    assert np.isclose(effect.get_parameter(0), value)
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_parameter_cache_save_load(plugin_path, tmp_path):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    effect = engine.make_plugin_processor("effect", plugin_path)
+    effect.cache_parameter_ranges(SEARCH_STEPS)
+    description = effect.get_parameters_description()
+    expected = _get_ranges(effect)
+
+    cache_path = str(tmp_path / "parameter_cache.xml")
+    daw.PluginProcessor.save_parameter_cache(cache_path)
+    daw.PluginProcessor.clear_parameter_cache()
+    daw.PluginProcessor.load_parameter_cache(cache_path)
+
+    assert effect.get_parameters_description() == description
+    assert _get_ranges(effect) == expected
+
+
+@pytest.mark.parametrize(
+    "plugin_path", [path for path in ALL_PLUGIN_EFFECTS if os.path.isdir(path)]
+)
+def test_parameter_cache_rebuilt_bundle(plugin_path, tmp_path):
+    # A bundle's directory doesn't change when the binary inside is rebuilt.
+    bundle = tmp_path / Path(plugin_path).name
+    shutil.copytree(plugin_path, bundle, symlinks=True)
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.make_plugin_processor("effect", str(bundle)).get_parameters_description()
+
+    cache_path = tmp_path / "parameter_cache.xml"
+
+    def get_keys():
+        daw.PluginProcessor.save_parameter_cache(str(cache_path))
+        return {table.get("key") for table in ET.parse(cache_path).getroot()}
+
+    keys = get_keys()
+    assert len(keys) == 1
+
+    binary = max(
+        (Path(root) / name for root, _, names in os.walk(bundle) for name in names),
+        key=lambda path: path.stat().st_size,
+    )
+    mtime = binary.stat().st_mtime + 10
+    os.utime(binary, (mtime, mtime))
+
+    engine.make_plugin_processor("rebuilt", str(bundle)).get_parameters_description()
+    assert len(get_keys() - keys) == 1
+
+
+def test_load_parameter_cache_invalid(tmp_path):
+    cache_path = tmp_path / "parameter_cache.xml"
+    cache_path.write_text("not a parameter cache")
+    with pytest.raises(Exception):
+        daw.PluginProcessor.load_parameter_cache(str(cache_path))
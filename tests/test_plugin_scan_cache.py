@@ -0,0 +1,37 @@
+from dawdreamer_utils import *
+
+
+@pytest.fixture
+def scan_cache_dir(tmp_path):
+    daw.PluginProcessor.set_scan_cache_dir(str(tmp_path))
+    yield tmp_path
+    daw.PluginProcessor.set_scan_cache_dir("")
+    daw.PluginProcessor.clear_scan_cache()
+
+
+def test_scan_cache_dir_property(scan_cache_dir):
+    assert daw.PluginProcessor.get_scan_cache_dir() == str(scan_cache_dir)
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_scan_cache_reuses_scans(scan_cache_dir, plugin_path):
+    daw.PluginProcessor.clear_scan_cache()
+    cache_file = scan_cache_dir / "plugin_scan_cache.xml"
+
+    engine = daw.RenderEngine(SAMPLE_RATE, 512)
+    first = engine.make_plugin_processor("first", plugin_path)
+    assert cache_file.exists()
+    assert basename(plugin_path) in cache_file.read_text()
+
+    # Later processors, including ones in other engines, load from the cache
+    # and behave the same.
+    second = engine.make_plugin_processor("second", plugin_path)
+    other = daw.RenderEngine(SAMPLE_RATE, 512).make_plugin_processor("other", plugin_path)
+    for processor in [second, other]:
+        assert processor.get_num_output_channels() == first.get_num_output_channels()
+        assert processor.get_plugin_parameter_size() == first.get_plugin_parameter_size()
+
+    daw.PluginProcessor.clear_scan_cache()
+    assert not cache_file.exists()
+    engine.make_plugin_processor("third", plugin_path)
+    assert cache_file.exists()
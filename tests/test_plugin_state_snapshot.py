@@ -0,0 +1,59 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 512
+DURATION = 1.0
+
+
+@pytest.fixture(autouse=True)
+def clear_snapshots():
+    yield
+    daw.PluginProcessor.clear_state_snapshots()
+
+
+def _make_engine(plugin_path):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    data = load_audio_file(ASSETS / "575854__yellowtree__d-b-funk-loop.wav", DURATION + 0.1)
+    playback_processor = engine.make_playback_processor("playback", data)
+    effect = engine.make_plugin_processor("effect", plugin_path)
+    engine.load_graph([(playback_processor, []), (effect, ["playback"])])
+    return engine, effect
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_snapshot_restores_state(plugin_path):
+    engine, effect = _make_engine(plugin_path)
+
+    effect.set_parameter(0, 0.2)
+    first = effect.snapshot_state()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    effect.set_parameter(0, 0.8)
+    second = effect.snapshot_state()
+    assert second != first
+
+    # The same state gets the same handle.
+    assert effect.snapshot_state() == second
+
+    effect.restore_state(first)
+    assert np.isclose(effect.get_parameter(0), 0.2)
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-5)
+
+    # Snapshots can be restored in other processors of the same plugin.
+    other_engine, other = _make_engine(plugin_path)
+    other.restore_state(second)
+    assert np.isclose(other.get_parameter(0), 0.8)
+
+
+@pytest.mark.parametrize("plugin_path", ALL_PLUGIN_EFFECTS)
+def test_snapshot_validation(plugin_path):
+    _, effect = _make_engine(plugin_path)
+    handle = effect.snapshot_state()
+
+    with pytest.raises(Exception):
+        effect.restore_state(handle + 1000)
+
+    daw.PluginProcessor.clear_state_snapshots()
+    with pytest.raises(Exception):
+        effect.restore_state(handle)
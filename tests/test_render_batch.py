@@ -0,0 +1,123 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def test_render_batch_matches_individual_renders():
+    num_samples = int(DURATION * SAMPLE_RATE)
+    sweep = np.linspace(200.0, 8000.0, num_samples, dtype=np.float32)
+
+    variants = [
+        {},
+        {"filter": {"parameters": {"freq": 300.0}}},
+        {"filter": {"parameters": {"freq": sweep, "q": 2.0}}},
+        {"filter": {"parameters": {0: 5000.0}}},
+    ]
+
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    batch = engine.render_batch(variants, DURATION)
+
+    assert batch.shape == (len(variants), 2, num_samples)
+
+    expected = []
+    for freq, q in [(1000.0, 0.7), (300.0, 0.7), (sweep, 2.0), (5000.0, 0.7)]:
+        engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+        if isinstance(freq, np.ndarray):
+            filter_processor.set_automation("freq", freq)
+        else:
+            filter_processor.frequency = freq
+        filter_processor.q = q
+        engine.render(DURATION)
+        expected.append(engine.get_audio())
+
+    for i, audio in enumerate(expected):
+        assert np.allclose(batch[i], audio, atol=1e-6)
+
+    # Variants are different from each other.
+    assert not np.allclose(batch[1], batch[3])
+
+
+def test_render_batch_restores_processors():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+
+    engine.render(DURATION)
+    before = engine.get_audio()
+
+    engine.render_batch([{"filter": {"parameters": {"freq": 200.0}}}], DURATION)
+
+    assert filter_processor.frequency == pytest.approx(1000.0)
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), before, atol=1e-6)
+
+
+def test_render_batch_midi_notes():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    faust_processor.add_midi_note(60, 100, 0.0, 0.5)
+    engine.load_graph([(faust_processor, [])])
+
+    notes = [(64, 100, 0.25, 0.5), (67, 1, 1.0, 0.5, True)]
+    batch = engine.render_batch([{}, {"faust": {"midi_notes": notes}}], DURATION)
+
+    # The original MIDI is back in place after the batch.
+    assert faust_processor.n_midi_events == 2
+    engine.render(DURATION)
+    assert np.allclose(batch[0], engine.get_audio(), atol=1e-6)
+
+    faust_processor.clear_midi()
+    faust_processor.add_midi_note(64, 100, 0.25, 0.5)
+    faust_processor.add_midi_note(67, 1, 1.0, 0.5, beats=True)
+    engine.render(DURATION)
+    assert np.allclose(batch[1], engine.get_audio(), atol=1e-6)
+    assert not np.allclose(batch[0], batch[1])
+
+
+def test_render_batch_errors():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+
+    with pytest.raises(Exception):
+        engine.render_batch([{"missing": {"parameters": {"freq": 1.0}}}], DURATION)
+
+    with pytest.raises(Exception):
+        engine.render_batch([{"filter": {"parameters": {"nonexistent": 1.0}}}], DURATION)
+
+    with pytest.raises(Exception):
+        engine.render_batch([{"filter": {"unknown_key": {}}}], DURATION)
+
+    with pytest.raises(Exception):
+        engine.render_batch([{"filter": {"midi_notes": [(60, 100, 0.0, 1.0)]}}], DURATION)
+
+    with pytest.raises(Exception):
+        engine.render_batch([{"filter": {"parameters": {"freq": np.ones((2, 10))}}}], DURATION)
+
+
+def test_render_batch_strided_automation():
+    num_samples = int(DURATION * SAMPLE_RATE)
+    sweep = np.linspace(200.0, 8000.0, 2 * num_samples, dtype=np.float32)
+
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    batch = engine.render_batch([{"filter": {"parameters": {"freq": sweep[::2]}}}], DURATION)
+    expected = engine.render_batch(
+        [{"filter": {"parameters": {"freq": np.ascontiguousarray(sweep[::2])}}}], DURATION
+    )
+    assert np.allclose(batch, expected, atol=1e-6)
+
+
+@pytest.mark.parametrize("num_workers", [2, 0])
+def test_render_batch_workers(num_workers):
+    num_samples = int(DURATION * SAMPLE_RATE)
+    sweep = np.linspace(200.0, 8000.0, num_samples, dtype=np.float32)
+    variants = [{"filter": {"parameters": {"freq": freq}}} for freq in [300.0, 2000.0, 5000.0]]
+    variants.append({"filter": {"parameters": {"freq": sweep}}})
+    variants.append({})
+
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    expected = engine.render_batch(variants, DURATION)
+    batch = engine.render_batch(variants, DURATION, num_workers=num_workers)
+
+    assert np.allclose(batch, expected, atol=1e-6)
+    assert filter_processor.frequency == pytest.approx(1000.0)
@@ -0,0 +1,83 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def _make_engine(cache_dir, max_size_mb=64.0):
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    engine.set_render_cache(str(cache_dir), max_size_mb=max_size_mb)
+    return engine, filter_processor
+
+
+def test_render_cache_shared_between_engines(tmp_path):
+    engine, _ = _make_engine(tmp_path)
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    stats = engine.get_render_cache_stats()
+    assert stats["hits"] == 0 and stats["misses"] == 1
+    assert stats["size_mb"] > 0
+    assert len(list(tmp_path.glob("*.ddrender"))) == 1
+
+    # A new engine (as in another process) finds the render.
+    engine, _ = _make_engine(tmp_path)
+    engine.render(DURATION)
+    assert engine.get_render_cache_stats()["hits"] == 1
+    assert np.array_equal(engine.get_audio(), expected)
+
+
+def test_render_cache_hit_is_read_only_view(tmp_path):
+    engine, _ = _make_engine(tmp_path)
+    engine.render(DURATION)
+    expected = engine.get_audio().copy()
+
+    # The hit maps the file instead of copying it.
+    engine.render(DURATION)
+    audio = engine.get_audio()
+    assert engine.get_render_cache_stats()["hits"] == 1
+    assert not audio.flags.writeable
+    with pytest.raises(ValueError):
+        audio[0, 0] = 1.0
+
+    # The view stays valid after the next render, which records into new memory.
+    engine.set_render_cache(None)
+    engine.render(DURATION)
+    assert engine.get_audio().flags.writeable
+    assert np.array_equal(audio, expected)
+
+
+def test_render_cache_misses_on_changes(tmp_path):
+    engine, filter_processor = _make_engine(tmp_path)
+    engine.render(DURATION)
+
+    filter_processor.frequency = 500.0
+    engine.render(DURATION)
+    engine.render(DURATION / 2)
+    engine.render(DURATION / 2, start=0.5)
+    assert engine.get_render_cache_stats()["misses"] == 4
+
+    filter_processor.frequency = 1000.0
+    engine.render(DURATION)
+    assert engine.get_render_cache_stats()["hits"] == 1
+
+    # Other recordings can't be restored from the cache, so they bypass it.
+    filter_processor.record_automation = True
+    engine.render(DURATION)
+    stats = engine.get_render_cache_stats()
+    assert stats["hits"] == 1 and stats["misses"] == 4
+
+
+def test_render_cache_eviction(tmp_path):
+    engine, filter_processor = _make_engine(tmp_path, max_size_mb=2.0)
+
+    # Each render is about 0.7 MB.
+    for freq in [200.0, 400.0, 800.0, 1600.0]:
+        filter_processor.frequency = freq
+        engine.render(DURATION)
+
+    assert len(list(tmp_path.glob("*.ddrender"))) == 2
+    assert engine.get_render_cache_stats()["size_mb"] <= 2.0
+
+    engine.set_render_cache(None)
+    assert engine.get_render_cache_stats()["directory"] is None
@@ -0,0 +1,63 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def test_render_into_matches_render():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    num_samples = int(DURATION * SAMPLE_RATE)
+    out = np.full((2, num_samples + 100), 7.0, dtype=np.float32)
+
+    written = engine.render_into(out, DURATION)
+
+    assert written == num_samples
+    assert np.allclose(out[:, :num_samples], expected, atol=1e-6)
+    # Samples past the render are left alone.
+    assert np.all(out[:, num_samples:] == 7.0)
+    # The engine doesn't keep a reference to the caller's array.
+    assert engine.get_audio().shape == (2, 0)
+
+
+def test_render_into_reuses_array():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    out = np.zeros((2, int(DURATION * SAMPLE_RATE)), dtype=np.float32)
+
+    engine.render_into(out, DURATION)
+    first = out.copy()
+
+    filter_processor.frequency = 200.0
+    engine.render_into(out, DURATION)
+
+    assert not np.allclose(first, out)
+
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), out, atol=1e-6)
+
+
+def test_render_into_errors():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    num_samples = int(DURATION * SAMPLE_RATE)
+
+    # Too short
+    with pytest.raises(Exception):
+        engine.render_into(np.zeros((2, num_samples - 1), dtype=np.float32), DURATION)
+
+    # Wrong number of channels
+    with pytest.raises(Exception):
+        engine.render_into(np.zeros((1, num_samples), dtype=np.float32), DURATION)
+
+    # Not C-contiguous
+    with pytest.raises(Exception):
+        engine.render_into(np.zeros((num_samples, 2), dtype=np.float32).T, DURATION)
+
+    # Wrong dtype would need a copy, so it's rejected instead of silently ignored.
+    with pytest.raises(Exception):
+        engine.render_into(np.zeros((2, num_samples), dtype=np.float64), DURATION)
+
+    # The engine still renders normally after the errors.
+    engine.render(DURATION)
+    assert engine.get_audio().shape == (2, num_samples)
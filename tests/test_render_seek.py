@@ -0,0 +1,74 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 4.0
+
+
+def _make_filter_engine():
+    engine, _, filter_processor = make_drums_filter_engine(DURATION, BUFFER_SIZE)
+    freq = np.linspace(200.0, 8000.0, int(DURATION * SAMPLE_RATE), dtype=np.float32)
+    filter_processor.set_automation("freq", freq)
+    return engine
+
+
+@pytest.mark.parametrize("start", [2.0, 1.2345])
+def test_render_seek_matches_full_render(start):
+    engine = _make_filter_engine()
+    engine.render(DURATION)
+    full = engine.get_audio()
+
+    engine.render(1.0, start=start, preroll=0.5)
+    audio = engine.get_audio()
+
+    offset = int(start * SAMPLE_RATE)
+    assert audio.shape == (2, SAMPLE_RATE)
+    assert np.mean(np.abs(audio)) > 0.001
+    assert np.allclose(audio, full[:, offset : offset + SAMPLE_RATE], atol=1e-5)
+
+
+def test_render_seek_beats():
+    engine = _make_filter_engine()
+    engine.set_bpm(100.0)
+    engine.render(DURATION)
+    full = engine.get_audio()
+
+    # At 100 BPM, 4 beats is 2.4 seconds.
+    engine.render(2.0, beats=True, start=4.0, preroll=0.5)
+    audio = engine.get_audio()
+
+    offset = round(2.4 * SAMPLE_RATE)
+    assert audio.shape[1] == round(1.2 * SAMPLE_RATE)
+    assert np.allclose(audio, full[:, offset : offset + audio.shape[1]], atol=1e-5)
+
+
+def test_render_seek_chases_notes():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    faust_processor.add_midi_note(60, 100, 0.0, 3.0)
+    engine.load_graph([(faust_processor, [])])
+
+    engine.render(DURATION)
+    full = engine.get_audio()
+
+    # The note started before the window, but it still sounds inside it.
+    engine.render(1.0, start=1.0)
+    assert np.mean(np.abs(engine.get_audio())) > 0.001
+
+    # A pre-roll that reaches back to the note-on renders exactly what the
+    # full render did.
+    engine.render(1.0, start=1.0, preroll=1.0)
+    audio = engine.get_audio()
+    assert np.allclose(audio, full[:, SAMPLE_RATE : 2 * SAMPLE_RATE], atol=1e-6)
+
+
+def test_render_seek_errors():
+    engine = _make_filter_engine()
+
+    with pytest.raises(Exception):
+        engine.render(1.0, start=-1.0)
+
+    with pytest.raises(Exception):
+        engine.render(1.0, start=1.0, preroll=-0.5)
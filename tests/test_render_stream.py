@@ -0,0 +1,69 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 2.0
+
+
+def _make_engine(num_threads=1):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.num_threads = num_threads
+    stems = ["bass", "drums"]
+    graph = []
+    for stem in stems:
+        audio = load_disco_stem(stem, DURATION)
+        graph.append((engine.make_playback_processor(stem, audio), []))
+    graph.append((engine.make_add_processor("mixer", [0.5, 0.5]), stems))
+    compressor = engine.make_compressor_processor("compressor", -20.0, 4.0, 2.0, 50.0)
+    graph.append((compressor, ["mixer"]))
+    engine.load_graph(graph)
+    return engine
+
+
+@pytest.mark.parametrize("chunk_samples", [BUFFER_SIZE, 1000, 4410, 77, 10 * SAMPLE_RATE])
+@pytest.mark.parametrize("num_threads", [1, 2])
+def test_render_stream_matches_render(chunk_samples, num_threads):
+    engine = _make_engine(num_threads)
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    stream = engine.render_stream(DURATION, chunk_samples)
+    assert stream.num_samples == expected.shape[1]
+
+    chunks = list(stream)
+    assert all(chunk.shape[1] == chunk_samples for chunk in chunks[:-1])
+    assert 0 < chunks[-1].shape[1] <= chunk_samples
+    assert stream.position == stream.num_samples
+
+    streamed = np.concatenate(chunks, axis=1)
+    assert streamed.shape == expected.shape
+    assert np.allclose(streamed, expected, atol=1e-6)
+
+
+def test_render_stream_abandoned():
+    engine = _make_engine()
+    engine.render(DURATION)
+    expected = engine.get_audio()
+
+    stream = engine.render_stream(DURATION, 1000)
+    next(stream)
+    next(stream)
+
+    # Starting another render ends the stream.
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+    with pytest.raises(Exception):
+        next(stream)
+
+    # A stream that's dropped early doesn't affect later renders.
+    stream = engine.render_stream(DURATION, 1000)
+    next(stream)
+    del stream
+    engine.render(DURATION)
+    assert np.allclose(engine.get_audio(), expected, atol=1e-6)
+
+
+def test_render_stream_invalid_chunk_size():
+    engine = _make_engine()
+    with pytest.raises(Exception):
+        engine.render_stream(DURATION, 0)
@@ -0,0 +1,94 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 128
+DURATION = 0.5
+
+
+def _make_engine():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+
+    # A short burst of noise followed by silence.
+    rng = np.random.default_rng(0)
+    audio = np.zeros((2, SAMPLE_RATE), dtype=np.float32)
+    audio[:, : SAMPLE_RATE // 10] = rng.uniform(-0.5, 0.5, (2, SAMPLE_RATE // 10))
+
+    playback = engine.make_playback_processor("playback", audio)
+    reverb = engine.make_reverb_processor("reverb")
+    reverb.room_size = 0.7
+    reverb.wet_level = 0.33
+    reverb.dry_level = 0.4
+    reverb.damping = 0.5
+    reverb.width = 1.0
+    reverb.record = True
+    engine.load_graph([(playback, []), (reverb, ["playback"])])
+    return engine
+
+
+def test_render_tail_auto():
+    engine = _make_engine()
+    engine.render(5.0)
+    full = engine.get_audio()
+
+    engine.render(DURATION, tail="auto", tail_threshold_db=-60.0)
+    audio = engine.get_audio()
+    num_samples = audio.shape[1]
+
+    # The reverb keeps going after the requested duration, and the render
+    # stops once it has faded below the threshold.
+    assert int(DURATION * SAMPLE_RATE) < num_samples < full.shape[1]
+    assert np.allclose(audio, full[:, :num_samples], atol=1e-6)
+    assert np.max(np.abs(full[:, num_samples:])) <= 10 ** (-60.0 / 20)
+    assert np.max(np.abs(audio[:, -1])) > 10 ** (-60.0 / 20)
+
+    # Every recording is trimmed to the same length.
+    assert engine.get_audio("reverb").shape == audio.shape
+
+
+def test_render_tail_max_tail():
+    engine = _make_engine()
+    engine.render(DURATION, tail="auto", max_tail=0.0)
+    assert engine.get_audio().shape == (2, int(DURATION * SAMPLE_RATE))
+
+    engine.render(DURATION, tail="auto", tail_threshold_db=-200.0, max_tail=0.25)
+    assert engine.get_audio().shape[1] <= int((DURATION + 0.25) * SAMPLE_RATE)
+
+    # Without a tail, the render is the requested length.
+    engine.render(DURATION)
+    assert engine.get_audio().shape == (2, int(DURATION * SAMPLE_RATE))
+
+
+def test_render_tail_errors():
+    engine = _make_engine()
+
+    with pytest.raises(Exception):
+        engine.render(DURATION, tail="forever")
+
+    with pytest.raises(Exception):
+        engine.render(DURATION, tail="auto", max_tail=-1.0)
+
+
+def test_render_tail_releases_midi():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    # A note held past the end of the render and one that starts after it.
+    faust_processor.add_midi_note(60, 100, 0.1, 10.0)
+    faust_processor.add_midi_note(67, 100, 1.0, 0.5)
+    engine.load_graph([(faust_processor, [])])
+
+    engine.render(DURATION, tail="auto", tail_threshold_db=-60.0, max_tail=5.0)
+    audio = engine.get_audio()
+    num_samples = audio.shape[1]
+
+    # The held note is released at the end of the render, and the later
+    # note never plays, so the tail is just the release.
+    assert int(DURATION * SAMPLE_RATE) < num_samples < SAMPLE_RATE
+    assert np.max(np.abs(audio[:, : int(DURATION * SAMPLE_RATE)])) > 0.01
+
+    # The MIDI is unchanged afterward, so a normal render holds the note.
+    assert faust_processor.n_midi_events == 4
+    engine.render(2.0)
+    held = engine.get_audio()[:, int(0.8 * SAMPLE_RATE) : int(0.9 * SAMPLE_RATE)]
+    assert np.max(np.abs(held)) > 0.01
@@ -0,0 +1,108 @@
+from dawdreamer_utils import *
+
+BUFFER_SIZE = 256
+DURATION = 8.0
+
+
+def _sparse_audio():
+    # Half a second of drums every two seconds, silence in between.
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "drums.wav", duration=DURATION)
+    num_samples = audio.shape[1]
+    mask = (np.arange(num_samples) % (2 * SAMPLE_RATE)) < SAMPLE_RATE // 2
+    return (audio * mask).astype(np.float32)
+
+
+def _render_effect_chain(skip_silence: bool, num_threads: int = 1):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.skip_silence = skip_silence
+    engine.num_threads = num_threads
+
+    graph = [(engine.make_playback_processor("drums", _sparse_audio()), [])]
+    previous = "drums"
+    for i, freq in enumerate([8000.0, 4000.0, 2000.0]):
+        name = f"filter{i}"
+        graph.append((engine.make_filter_processor(name, "low", freq, 0.7, 1.0), [previous]))
+        previous = name
+    compressor = engine.make_compressor_processor("compressor", -20.0, 4.0, 2.0, 50.0)
+    graph.append((compressor, [previous]))
+
+    engine.load_graph(graph)
+    engine.render(DURATION)
+    return engine.get_audio(), engine.skipped_blocks
+
+
+@pytest.mark.parametrize("num_threads", [1, 4])
+def test_skip_silence_effect_chain(num_threads):
+    expected, _ = _render_effect_chain(False)
+    audio, skipped_blocks = _render_effect_chain(True, num_threads)
+
+    assert np.mean(np.abs(expected)) > 0.001
+    assert np.allclose(audio, expected, atol=1e-5)
+
+    # Workers count the skipped blocks together.
+    assert skipped_blocks > 0
+    assert skipped_blocks == _render_effect_chain(True)[1]
+
+
+def _render_sparse_notes(skip_silence: bool):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.skip_silence = skip_silence
+    engine.set_bpm(100.0)
+
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    faust_processor.add_midi_note(60, 100, 1.0, 0.5)
+    faust_processor.add_midi_note(64, 100, 5.25, 0.25)
+    faust_processor.add_midi_note(67, 100, 4.0, 1.0, beats=True)
+
+    filter_processor = engine.make_filter_processor("filter", "low", 2000.0, 0.7, 1.0)
+    engine.load_graph([(faust_processor, []), (filter_processor, ["faust"])])
+    engine.render(DURATION)
+    return engine.get_audio(), engine.skipped_blocks
+
+
+def test_skip_silence_sparse_notes():
+    expected, skipped_blocks = _render_sparse_notes(False)
+    assert skipped_blocks == 0
+    audio, skipped_blocks = _render_sparse_notes(True)
+
+    assert np.mean(np.abs(expected)) > 0.0001
+    assert np.allclose(audio, expected, atol=1e-5)
+
+    # Both processors are silent for most of the render.
+    num_blocks = int(DURATION * SAMPLE_RATE) // BUFFER_SIZE
+    assert skipped_blocks > num_blocks
+
+
+def _render_drone(skip_silence: bool):
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    engine.skip_silence = skip_silence
+
+    # An effect that also makes sound with silent input.
+    silence = np.zeros((2, int(DURATION * SAMPLE_RATE)), dtype=np.float32)
+    playback = engine.make_playback_processor("silence", silence)
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp_string(
+        'import("stdfaust.lib"); process = par(i, 2, +(os.osc(440.) * .25));'
+    )
+    engine.load_graph([(playback, []), (faust_processor, ["silence"])])
+    engine.render(DURATION)
+    return engine.get_audio(), engine.skipped_blocks
+
+
+def test_skip_silence_keeps_processors_that_make_sound():
+    expected, _ = _render_drone(False)
+    audio, skipped_blocks = _render_drone(True)
+
+    assert np.mean(np.abs(expected)) > 0.01
+    assert np.allclose(audio, expected, atol=1e-5)
+    assert skipped_blocks == 0
+
+
+def test_skip_silence_property():
+    engine = daw.RenderEngine(SAMPLE_RATE, BUFFER_SIZE)
+    assert not engine.skip_silence
+    engine.skip_silence = True
+    assert engine.skip_silence
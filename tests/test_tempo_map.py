@@ -0,0 +1,65 @@
+from dawdreamer_utils import *
+
+PPQN = 4
+
+
+def _make_engine(buffer_size):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    audio = load_audio_file(ASSETS / "Music Delta - Disco" / "bass.wav", duration=10.0)
+    engine.load_graph([(engine.make_playback_processor("playback", audio), [])])
+    return engine
+
+
+@pytest.mark.parametrize("buffer_size", [1, 128, 1000])
+def test_render_length_in_beats(buffer_size):
+    engine = _make_engine(buffer_size)
+
+    # One beat at 120 BPM (0.5 seconds), then 60 BPM.
+    bpm = np.array([120.0] * PPQN + [60.0] * PPQN, dtype=np.float32)
+    engine.set_bpm(bpm, ppqn=PPQN)
+    engine.render(3.0, beats=True)
+    assert engine.get_audio().shape[1] == round(2.5 * SAMPLE_RATE)
+
+    # With a ramp, the tempo falls linearly from 120 to 60 BPM over the last
+    # quarter of the first beat, which takes 15 ln(2) / 60 seconds.
+    engine.set_bpm(np.array([120.0] * PPQN + [60.0], dtype=np.float32), ppqn=PPQN, ramp=True)
+    engine.render(2.0, beats=True)
+    seconds = 0.375 + 0.25 * np.log(2.0) + 1.0
+    assert engine.get_audio().shape[1] == round(seconds * SAMPLE_RATE)
+
+
+def _render_notes(buffer_size, ramp):
+    engine = daw.RenderEngine(SAMPLE_RATE, buffer_size)
+    bpm = 60.0 + 120.0 * np.abs(make_sine(0.5, 8.0, sr=PPQN))
+    engine.set_bpm(bpm.astype(np.float32), ppqn=PPQN, ramp=ramp)
+
+    faust_processor = engine.make_faust_processor("faust")
+    faust_processor.set_dsp(abspath(FAUST_DSP / "polyphonic.dsp"))
+    faust_processor.num_voices = 8
+    faust_processor.compile()
+    for i in range(6):
+        faust_processor.add_midi_note(60 + i, 100, 0.75 * i + 0.1, 0.5, beats=True)
+
+    engine.load_graph([(faust_processor, [])])
+    engine.render(5.0, beats=True)
+    return engine.get_audio()
+
+
+@pytest.mark.parametrize("ramp", [False, True])
+def test_beat_timing_independent_of_buffer_size(ramp):
+    expected = _render_notes(1, ramp)
+    audio = _render_notes(512, ramp)
+
+    assert np.mean(np.abs(expected)) > 0.001
+    assert audio.shape == expected.shape
+    assert np.allclose(audio, expected, atol=1e-5)
+
+
+def test_set_bpm_validation():
+    engine = daw.RenderEngine(SAMPLE_RATE, 128)
+
+    with pytest.raises(Exception):
+        engine.set_bpm(np.array([120.0, 0.0], dtype=np.float32), ppqn=PPQN)
+
+    with pytest.raises(Exception):
+        engine.set_bpm(np.array([], dtype=np.float32), ppqn=PPQN)